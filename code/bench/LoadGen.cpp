@@ -0,0 +1,618 @@
+/*
+ * webbench：基于 epoll 的 HTTP 压测工具
+ *
+ *   webbench [-H host] [-p port] [-c conns] [-t threads] [-d seconds] [-w warmupSeconds]
+ *            [-P depth] [-r rate] [-K] [-R resourcesDir] [-L loginPercent] [-i intervalUs]
+ *
+ *   -c  并发连接数（默认 64），均分到 -t 个线程（默认 2）
+ *   -P  每个连接的流水线深度（默认 1）
+ *   -r  开环模式的总请求速率（req/s）；0 为闭环模式（默认）
+ *   -K  短连接模式：每个请求新建连接
+ *   -R  请求分布取自该目录下的全部静态文件（默认 ../resources）
+ *   -L  登录 POST 所占百分比（默认 0；服务器用 -s 启动时不依赖 MySQL）
+ *   -i  闭环模式做协调遗漏（coordinated omission）修正时使用的期望间隔，默认取平均延迟
+ *
+ * 开环模式下延迟从“计划发送时间”开始计算，发送被积压的请求同样计入等待时间，
+ * 因此结果天然已修正协调遗漏；闭环模式额外输出按期望间隔补点后的分位数。
+ */
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../metrics/Metrics.h"
+
+namespace
+{
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        int port = 8080;
+        int conns = 64;
+        int threads = 2;
+        int duration = 10;
+        int warmup = 1;
+        int depth = 1;
+        double rate = 0;
+        bool keepAlive = true;
+        std::string resources = "../resources";
+        int loginPercent = 0;
+        uint64_t intervalUs = 0;
+    };
+
+    // 每个线程的统计结果
+    struct Result
+    {
+        Histogram latency;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        uint64_t bytes = 0;
+        uint64_t status[600] = {};
+    };
+
+    uint64_t NowNs()
+    {
+        return Metrics::NowNs();
+    }
+
+    uint64_t NextRandom(uint64_t &state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // 预先构造好的请求报文集合
+    struct RequestMix
+    {
+        std::vector<std::string> gets;
+        std::string login;
+        int loginPercent = 0;
+
+        const std::string &Pick(uint64_t &rng) const
+        {
+            if (loginPercent > 0 && static_cast<int>(NextRandom(rng) % 100) < loginPercent)
+            {
+                return login;
+            }
+            return gets[NextRandom(rng) % gets.size()];
+        }
+    };
+
+    RequestMix BuildMix(const Options &opt)
+    {
+        RequestMix mix;
+        std::string conn = opt.keepAlive ? "keep-alive" : "close";
+        std::vector<std::string> paths = {"/"};
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(opt.resources, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            std::string name = it->path().filename().string();
+            if (it->is_regular_file() && !name.empty() && name[0] != '.')
+            {
+                paths.push_back("/" + std::filesystem::relative(it->path(), opt.resources).generic_string());
+            }
+        }
+        for (auto &path : paths)
+        {
+            mix.gets.push_back("GET " + path + " HTTP/1.1\r\nHost: " + opt.host +
+                               "\r\nConnection: " + conn + "\r\n\r\n");
+        }
+        std::string body = "username=webbench&password=webbench";
+        mix.login = "POST /login.html HTTP/1.1\r\nHost: " + opt.host + "\r\nConnection: " + conn +
+                    "\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\n\r\n" + body;
+        mix.loginPercent = opt.loginPercent;
+        return mix;
+    }
+
+    int Connect(const sockaddr_in &addr, bool nonblock)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | (nonblock ? SOCK_NONBLOCK : 0), 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // 登录前先注册压测账号（已存在时注册失败也无妨）
+    void RegisterBenchUser(const sockaddr_in &addr, const Options &opt)
+    {
+        int fd = Connect(addr, false);
+        if (fd < 0)
+        {
+            return;
+        }
+        std::string body = "username=webbench&password=webbench";
+        std::string req = "POST /register.html HTTP/1.1\r\nHost: " + opt.host +
+                          "\r\nConnection: close\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+                          "Content-Length: " +
+                          std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (write(fd, req.data(), req.size()) == static_cast<ssize_t>(req.size()))
+        {
+            char buf[4096];
+            while (read(fd, buf, sizeof(buf)) > 0)
+            {
+            }
+        }
+        close(fd);
+    }
+
+    class Worker
+    {
+    public:
+        Worker(const Options &opt, const RequestMix &mix, const sockaddr_in &addr, int conns, uint64_t seed)
+            : opt_(opt), mix_(mix), addr_(addr), conns_(conns), rng_(seed | 1) {}
+
+        void Run(uint64_t startNs, uint64_t warmupEndNs, uint64_t endNs);
+        Result &GetResult() { return result_; }
+
+    private:
+        struct Conn
+        {
+            int fd = -1;
+            bool connected = false;
+            std::string out;
+            size_t outOff = 0;
+            std::string in;
+            std::deque<uint64_t> inflight; // 每个在途请求的起始时间
+            std::deque<uint64_t> due;      // 开环模式：已到计划时间但尚未发送的请求
+            uint64_t nextDue = 0;          // 开环模式：下一个请求的计划时间
+        };
+
+        void Open_(size_t idx);
+        void Reset_(size_t idx, bool error);
+        void Fill_(size_t idx, uint64_t now);
+        void Flush_(size_t idx);
+        void Read_(size_t idx);
+
+        const Options &opt_;
+        const RequestMix &mix_;
+        sockaddr_in addr_;
+        int epfd_ = -1;
+        std::vector<Conn> conns_;
+        uint64_t rng_;
+        uint64_t intervalNs_ = 0;
+        uint64_t warmupEndNs_ = 0;
+        Result result_;
+    };
+
+    void Worker::Open_(size_t idx)
+    {
+        Conn &c = conns_[idx];
+        c.fd = Connect(addr_, true);
+        c.connected = false;
+        c.out.clear();
+        c.outOff = 0;
+        c.in.clear();
+        if (c.fd < 0)
+        {
+            ++result_.errors;
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u64 = idx;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    void Worker::Reset_(size_t idx, bool error)
+    {
+        Conn &c = conns_[idx];
+        if (error)
+        {
+            result_.errors += c.inflight.size();
+        }
+        // 开环模式下未完成的请求重新排队，保留其计划时间
+        if (intervalNs_ > 0)
+        {
+            c.due.insert(c.due.begin(), c.inflight.begin(), c.inflight.end());
+        }
+        c.inflight.clear();
+        if (c.fd >= 0)
+        {
+            close(c.fd);
+        }
+        Open_(idx);
+    }
+
+    void Worker::Fill_(size_t idx, uint64_t now)
+    {
+        Conn &c = conns_[idx];
+        if (intervalNs_ > 0)
+        {
+            while (c.nextDue <= now)
+            {
+                c.due.push_back(c.nextDue);
+                c.nextDue += intervalNs_;
+            }
+        }
+        if (!c.connected)
+        {
+            return;
+        }
+        size_t depth = opt_.keepAlive ? opt_.depth : 1;
+        while (c.inflight.size() < depth)
+        {
+            if (intervalNs_ > 0)
+            {
+                if (c.due.empty())
+                {
+                    break;
+                }
+                c.inflight.push_back(c.due.front());
+                c.due.pop_front();
+            }
+            else
+            {
+                c.inflight.push_back(now);
+            }
+            c.out += mix_.Pick(rng_);
+        }
+        Flush_(idx);
+    }
+
+    void Worker::Flush_(size_t idx)
+    {
+        Conn &c = conns_[idx];
+        while (c.outOff < c.out.size())
+        {
+            ssize_t n = write(c.fd, c.out.data() + c.outOff, c.out.size() - c.outOff);
+            if (n < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    Reset_(idx, true);
+                }
+                return;
+            }
+            c.outOff += n;
+        }
+        c.out.clear();
+        c.outOff = 0;
+    }
+
+    void Worker::Read_(size_t idx)
+    {
+        Conn &c = conns_[idx];
+        char buf[65536];
+        bool peerClosed = false;
+        while (true)
+        {
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n > 0)
+            {
+                c.in.append(buf, n);
+                result_.bytes += n;
+                continue;
+            }
+            if (n == 0)
+            {
+                peerClosed = true;
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                peerClosed = true;
+            }
+            break;
+        }
+
+        // 解析所有完整的响应
+        bool closeConn = false;
+        size_t pos = 0;
+        while (!c.inflight.empty())
+        {
+            size_t hdrEnd = c.in.find("\r\n\r\n", pos);
+            if (hdrEnd == std::string::npos)
+            {
+                break;
+            }
+            std::string_view head(c.in.data() + pos, hdrEnd - pos);
+            int status = 0;
+            if (head.size() > 12 && head.compare(0, 5, "HTTP/") == 0)
+            {
+                status = atoi(head.data() + 9);
+            }
+            size_t clPos = head.find("Content-Length:");
+            if (clPos == std::string_view::npos)
+            {
+                closeConn = true; // 不支持无长度的响应
+                break;
+            }
+            size_t bodyLen = strtoul(head.data() + clPos + 15, nullptr, 10);
+            size_t total = hdrEnd + 4 + bodyLen;
+            if (c.in.size() < total)
+            {
+                break;
+            }
+
+            uint64_t now = NowNs();
+            uint64_t start = c.inflight.front();
+            c.inflight.pop_front();
+            if (start >= warmupEndNs_)
+            {
+                result_.latency.Record(now - start);
+                ++result_.requests;
+                if (status >= 100 && status < 600)
+                {
+                    ++result_.status[status];
+                }
+            }
+            pos = total;
+            if (head.find("Connection: close") != std::string_view::npos)
+            {
+                closeConn = true;
+                break;
+            }
+        }
+        c.in.erase(0, pos);
+
+        if (closeConn || peerClosed)
+        {
+            Reset_(idx, peerClosed && !c.inflight.empty());
+        }
+    }
+
+    void Worker::Run(uint64_t startNs, uint64_t warmupEndNs, uint64_t endNs)
+    {
+        warmupEndNs_ = warmupEndNs;
+        epfd_ = epoll_create1(0);
+        if (opt_.rate > 0)
+        {
+            double perConn = opt_.rate / opt_.conns;
+            intervalNs_ = static_cast<uint64_t>(1e9 / perConn);
+        }
+        for (size_t i = 0; i < conns_.size(); ++i)
+        {
+            // 错开各连接的首个计划时间，避免同一时刻集中发送
+            conns_[i].nextDue = startNs + (intervalNs_ > 0 ? NextRandom(rng_) % intervalNs_ : 0);
+            Open_(i);
+        }
+
+        std::vector<epoll_event> events(conns_.size() + 1);
+        while (true)
+        {
+            uint64_t now = NowNs();
+            if (now >= endNs)
+            {
+                break;
+            }
+            for (size_t i = 0; i < conns_.size(); ++i)
+            {
+                if (conns_[i].fd >= 0)
+                {
+                    Fill_(i, now);
+                }
+                else
+                {
+                    Open_(i);
+                }
+            }
+
+            int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), 1);
+            for (int i = 0; i < n; ++i)
+            {
+                size_t idx = events[i].data.u64;
+                Conn &c = conns_[idx];
+                if (c.fd < 0)
+                {
+                    continue;
+                }
+                if (!c.connected && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+                {
+                    int err = 0;
+                    socklen_t len = sizeof(err);
+                    getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                    if (err != 0)
+                    {
+                        Reset_(idx, true);
+                        continue;
+                    }
+                    c.connected = true;
+                }
+                if (events[i].events & EPOLLIN)
+                {
+                    Read_(idx);
+                }
+                if (c.fd >= 0 && (events[i].events & EPOLLOUT) && c.connected)
+                {
+                    Flush_(idx);
+                }
+            }
+        }
+
+        for (auto &c : conns_)
+        {
+            if (c.fd >= 0)
+            {
+                close(c.fd);
+            }
+        }
+        close(epfd_);
+    }
+
+    void Usage(const char *prog)
+    {
+        fprintf(stderr,
+                "usage: %s [-H host] [-p port] [-c conns] [-t threads] [-d seconds] [-w warmup]\n"
+                "          [-P depth] [-r rate] [-K] [-R resourcesDir] [-L loginPercent] [-i intervalUs]\n",
+                prog);
+    }
+
+    void PrintLatency(const char *label, const std::vector<uint64_t> &buckets, uint64_t count)
+    {
+        printf("  %-10s p50 %9.3fms  p90 %9.3fms  p99 %9.3fms  p999 %9.3fms  max %9.3fms\n", label,
+               Histogram::Quantile(buckets, count, 0.5) / 1e6, Histogram::Quantile(buckets, count, 0.9) / 1e6,
+               Histogram::Quantile(buckets, count, 0.99) / 1e6, Histogram::Quantile(buckets, count, 0.999) / 1e6,
+               Histogram::Quantile(buckets, count, 1.0) / 1e6);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "H:p:c:t:d:w:P:r:KR:L:i:h")) != -1)
+    {
+        switch (ch)
+        {
+        case 'H': opt.host = optarg; break;
+        case 'p': opt.port = atoi(optarg); break;
+        case 'c': opt.conns = std::max(1, atoi(optarg)); break;
+        case 't': opt.threads = std::max(1, atoi(optarg)); break;
+        case 'd': opt.duration = std::max(1, atoi(optarg)); break;
+        case 'w': opt.warmup = std::max(0, atoi(optarg)); break;
+        case 'P': opt.depth = std::max(1, atoi(optarg)); break;
+        case 'r': opt.rate = atof(optarg); break;
+        case 'K': opt.keepAlive = false; break;
+        case 'R': opt.resources = optarg; break;
+        case 'L': opt.loginPercent = std::clamp(atoi(optarg), 0, 100); break;
+        case 'i': opt.intervalUs = strtoull(optarg, nullptr, 10); break;
+        default:
+            Usage(argv[0]);
+            return ch == 'h' ? 0 : 1;
+        }
+    }
+    opt.threads = std::min(opt.threads, opt.conns);
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "invalid IPv4 address: %s\n", opt.host.c_str());
+        return 1;
+    }
+
+    RequestMix mix = BuildMix(opt);
+    if (opt.loginPercent > 0)
+    {
+        RegisterBenchUser(addr, opt);
+    }
+
+    printf("Running %ds test @ %s:%d (%d threads, %d connections, depth %d, %s, %s, %zu paths, %d%% login)\n",
+           opt.duration, opt.host.c_str(), opt.port, opt.threads, opt.conns, opt.keepAlive ? opt.depth : 1,
+           opt.keepAlive ? "keep-alive" : "short connections",
+           opt.rate > 0 ? "open-loop" : "closed-loop", mix.gets.size(), opt.loginPercent);
+    if (opt.rate > 0)
+    {
+        printf("  target rate %.0f req/s\n", opt.rate);
+    }
+
+    uint64_t start = NowNs();
+    uint64_t warmupEnd = start + opt.warmup * 1000000000ull;
+    uint64_t end = warmupEnd + opt.duration * 1000000000ull;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opt.threads; ++i)
+    {
+        int conns = opt.conns / opt.threads + (i < opt.conns % opt.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(opt, mix, addr, conns, start + i * 7919));
+    }
+    for (auto &w : workers)
+    {
+        threads.emplace_back([&w, start, warmupEnd, end]()
+                             { w->Run(start, warmupEnd, end); });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0, sum = 0, requests = 0, errors = 0, bytes = 0;
+    uint64_t status[600] = {};
+    for (auto &w : workers)
+    {
+        Result &r = w->GetResult();
+        r.latency.AddTo(buckets, count, sum);
+        requests += r.requests;
+        errors += r.errors;
+        bytes += r.bytes;
+        for (int s = 0; s < 600; ++s)
+        {
+            status[s] += r.status[s];
+        }
+    }
+    buckets.resize(Histogram::BUCKETS, 0);
+
+    uint64_t non2xx = 0;
+    for (int s = 0; s < 600; ++s)
+    {
+        if (s < 200 || s >= 300)
+        {
+            non2xx += status[s];
+        }
+    }
+    double seconds = opt.duration;
+    printf("  requests   %lu (errors %lu, non-2xx %lu)\n", requests, errors, non2xx);
+    printf("  rps        %.1f\n", requests / seconds);
+    printf("  transfer   %.2f MB/s\n", bytes / seconds / (1 << 20));
+    PrintLatency(opt.rate > 0 ? "latency*" : "latency", buckets, count);
+
+    if (opt.rate <= 0 && count > 0)
+    {
+        // 闭环修正：每个超过期望间隔的样本，补上在它阻塞期间本应发出的请求的延迟
+        uint64_t interval = opt.intervalUs > 0 ? opt.intervalUs * 1000 : sum / count;
+        std::vector<uint64_t> corrected = buckets;
+        uint64_t correctedCount = count;
+        for (int i = 0; i < Histogram::BUCKETS && interval > 0; ++i)
+        {
+            if (buckets[i] == 0)
+            {
+                continue;
+            }
+            uint64_t value = Histogram::BucketUpper(i);
+            for (uint64_t missing = value > interval ? value - interval : 0; missing >= interval; missing -= interval)
+            {
+                corrected[Histogram::BucketOf(missing)] += buckets[i];
+                correctedCount += buckets[i];
+            }
+        }
+        PrintLatency("corrected", corrected, correctedCount);
+        printf("  (corrected with expected interval %.3fms)\n", interval / 1e6);
+    }
+    else if (opt.rate > 0)
+    {
+        printf("  (* measured from scheduled send time, coordinated omission corrected)\n");
+    }
+
+    printf("  status    ");
+    for (int s = 0; s < 600; ++s)
+    {
+        if (status[s] > 0)
+        {
+            printf(" %d=%lu", s, status[s]);
+        }
+    }
+    printf("\n");
+    return errors > 0 && requests == 0 ? 1 : 0;
+}
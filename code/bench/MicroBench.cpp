@@ -0,0 +1,480 @@
+/*
+ * microbench：热点组件的微基准
+ *
+ *   microbench [--filter substr] [--min-time seconds] [--json out.json] [--compare base.json]
+ *              [--resources dir]
+ *
+ * 覆盖 Buffer、HttpRequest::parse、HttpResponse::MakeResponse 与 ThreadPool 任务派发。
+ * JSON 输出沿用 Google Benchmark 的字段（name/iterations/real_time/time_unit/...），
+ * 可以直接用其 compare.py 对比，也可以用 --compare 与上一次的结果对比。
+ */
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../buffer/Buffer.h"
+#include "../http/HttpRequest.h"
+#include "../http/HttpResponse.h"
+#include "../metrics/Metrics.h"
+#include "../pool/ThreadPool.h"
+
+namespace
+{
+    // 单个基准的运行上下文：函数体执行 iterations 次，可附带额外的计数
+    struct State
+    {
+        uint64_t iterations = 0;
+        uint64_t bytesPerIteration = 0;
+        std::map<std::string, double> counters;
+    };
+
+    struct Benchmark
+    {
+        std::string name;
+        std::function<void(State &)> fn;
+    };
+
+    struct Report
+    {
+        std::string name;
+        uint64_t iterations;
+        double nsPerOp;
+        double bytesPerSecond;
+        std::map<std::string, double> counters;
+    };
+
+    std::vector<Benchmark> &Registry()
+    {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char *name, std::function<void(State &)> fn) { Registry().push_back({name, std::move(fn)}); }
+    };
+
+#define BENCHMARK(id, name) \
+    static void id(State &state); \
+    static Registrar id##_registrar(name, id); \
+    static void id(State &state)
+
+    // 阻止编译器把结果优化掉
+    template <typename T>
+    inline void DoNotOptimize(T const &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    std::string g_resources = "../resources";
+
+    // 逐步放大迭代次数，直到单次运行超过 minTime
+    Report Run(const Benchmark &bench, double minTime)
+    {
+        uint64_t iterations = 1;
+        while (true)
+        {
+            State state;
+            state.iterations = iterations;
+            uint64_t start = Metrics::NowNs();
+            bench.fn(state);
+            uint64_t elapsed = Metrics::NowNs() - start;
+            if (elapsed >= minTime * 1e9 || iterations >= (1ull << 34))
+            {
+                Report r{bench.name, iterations, static_cast<double>(elapsed) / iterations, 0, state.counters};
+                if (state.bytesPerIteration > 0)
+                {
+                    r.bytesPerSecond = state.bytesPerIteration * iterations / (elapsed / 1e9);
+                }
+                return r;
+            }
+            double scale = elapsed > 0 ? minTime * 1.4e9 / elapsed : 100;
+            iterations = std::max<uint64_t>(iterations + 1, iterations * std::min(scale, 100.0));
+        }
+    }
+
+    // ---------------- Buffer ----------------
+
+    BENCHMARK(BufferAppendRetrieve, "Buffer/append_retrieve_64B")
+    {
+        Buffer buff;
+        char chunk[64];
+        memset(chunk, 'a', sizeof(chunk));
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            buff.append(chunk, sizeof(chunk));
+            std::string out = buff.retrieve(sizeof(chunk));
+            DoNotOptimize(out);
+        }
+        state.bytesPerIteration = sizeof(chunk);
+    }
+
+    BENCHMARK(BufferAppendSkip, "Buffer/append_skip_64B")
+    {
+        Buffer buff;
+        char chunk[64];
+        memset(chunk, 'a', sizeof(chunk));
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            buff.append(chunk, sizeof(chunk));
+            buff.skip(sizeof(chunk));
+        }
+        DoNotOptimize(buff.readableBytes());
+        state.bytesPerIteration = sizeof(chunk);
+    }
+
+    BENCHMARK(BufferAppendGrow, "Buffer/append_grow_16KB")
+    {
+        std::string chunk(16 << 10, 'b');
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            Buffer buff;
+            for (int j = 0; j < 4; ++j)
+            {
+                buff.append(chunk);
+            }
+            DoNotOptimize(buff.readableBytes());
+        }
+        state.bytesPerIteration = chunk.size() * 4;
+    }
+
+    BENCHMARK(BufferReadFd, "Buffer/ReadFd_4KB")
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        std::string payload(4096, 'c');
+        Buffer buff;
+        int err = 0;
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            if (write(fds[1], payload.data(), payload.size()) < 0)
+            {
+                break;
+            }
+            buff.ReadFd(fds[0], &err);
+            buff.clear();
+        }
+        close(fds[0]);
+        close(fds[1]);
+        state.bytesPerIteration = payload.size();
+    }
+
+    // ---------------- HttpRequest ----------------
+
+    const std::string SMALL_GET =
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+
+    const std::string BROWSER_GET =
+        "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+        "Host: www.example.com:8080\r\n"
+        "Connection: keep-alive\r\n"
+        "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+        "sec-ch-ua-mobile: ?0\r\n"
+        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/124.0.0.0 Safari/537.36\r\n"
+        "sec-ch-ua-platform: \"Windows\"\r\n"
+        "Accept: text/css,*/*;q=0.1\r\n"
+        "Sec-Fetch-Site: same-origin\r\n"
+        "Sec-Fetch-Mode: no-cors\r\n"
+        "Sec-Fetch-Dest: style\r\n"
+        "Referer: http://www.example.com:8080/index.html\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+        "Cookie: _ga=GA1.1.1234567890.1700000000; session=abcdef0123456789abcdef0123456789\r\n"
+        "If-Modified-Since: Tue, 01 Oct 2024 08:00:00 GMT\r\n"
+        "\r\n";
+
+    const std::string URLENCODED_POST =
+        "POST /submit.html HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Connection: keep-alive\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "Content-Length: 62\r\n"
+        "\r\n"
+        "username=%E5%BC%A0%E4%B8%89&password=p%40ss+word&remember=on12";
+
+    void ParseLoop(State &state, const std::string &raw)
+    {
+        HttpRequest request;
+        Buffer buff;
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            request.Init();
+            buff.append(raw);
+            bool ok = request.parse(buff);
+            DoNotOptimize(ok);
+        }
+        state.bytesPerIteration = raw.size();
+    }
+
+    BENCHMARK(ParseSmallGet, "HttpRequest/parse_small_get")
+    {
+        ParseLoop(state, SMALL_GET);
+    }
+
+    BENCHMARK(ParseBrowserGet, "HttpRequest/parse_browser_get")
+    {
+        ParseLoop(state, BROWSER_GET);
+    }
+
+    BENCHMARK(ParseUrlencodedPost, "HttpRequest/parse_urlencoded_post")
+    {
+        ParseLoop(state, URLENCODED_POST);
+    }
+
+    // ---------------- HttpResponse ----------------
+
+    BENCHMARK(ResponseFile, "HttpResponse/MakeResponse_file")
+    {
+        HttpResponse response;
+        Buffer buff;
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            response.Init(g_resources, "/index.html", true, 200);
+            buff.clear();
+            response.MakeResponse(buff);
+            DoNotOptimize(buff.readableBytes());
+        }
+    }
+
+    BENCHMARK(ResponseNotFound, "HttpResponse/MakeResponse_404")
+    {
+        HttpResponse response;
+        Buffer buff;
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            response.Init(g_resources, "/no-such-file.html", true, 200);
+            buff.clear();
+            response.MakeResponse(buff);
+            DoNotOptimize(buff.readableBytes());
+        }
+    }
+
+    BENCHMARK(ResponseContent, "HttpResponse/MakeResponse_content_1KB")
+    {
+        HttpResponse response;
+        Buffer buff;
+        std::string body(1024, 'x');
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            response.InitContent("text/plain", body, true);
+            buff.clear();
+            response.MakeResponse(buff);
+            DoNotOptimize(buff.readableBytes());
+        }
+    }
+
+    // ---------------- ThreadPool ----------------
+
+    // 派发延迟：从入队到任务开始执行；每次等上一个任务执行完再投递，测的是空闲池的唤醒延迟
+    BENCHMARK(PoolDispatchLatency, "ThreadPool/addDetachedTask_dispatch_latency")
+    {
+        ThreadPool pool(4, 4);
+        Histogram latency;
+        std::atomic<uint64_t> done{0};
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            uint64_t enqueued = Metrics::NowNs();
+            std::atomic<uint64_t> started{0};
+            pool.addDetachedTask([&started, &done]()
+                                 { started.store(Metrics::NowNs(), std::memory_order_release); done.fetch_add(1); });
+            uint64_t t;
+            while ((t = started.load(std::memory_order_acquire)) == 0)
+            {
+                std::this_thread::yield(); // 单核机器上让出 CPU 给工作线程
+            }
+            latency.Record(t - enqueued);
+        }
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0, sum = 0;
+        latency.AddTo(buckets, count, sum);
+        state.counters["p50_ns"] = Histogram::Quantile(buckets, count, 0.5);
+        state.counters["p99_ns"] = Histogram::Quantile(buckets, count, 0.99);
+    }
+
+    // 吞吐：连续投递空任务直到全部执行完
+    BENCHMARK(PoolDetachedThroughput, "ThreadPool/addDetachedTask_throughput")
+    {
+        ThreadPool pool(4, 4);
+        std::atomic<uint64_t> done{0};
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            pool.addDetachedTask([&done]()
+                                 { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (done.load() < state.iterations)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    BENCHMARK(PoolFutureThroughput, "ThreadPool/addTask_future_throughput")
+    {
+        ThreadPool pool(4, 4);
+        std::atomic<uint64_t> done{0};
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            pool.addTask([&done]()
+                         { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (done.load() < state.iterations)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // ---------------- 输出 ----------------
+
+    std::string JsonEscape(const std::string &s)
+    {
+        std::string out;
+        for (char ch : s)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                out += '\\';
+            }
+            out += ch;
+        }
+        return out;
+    }
+
+    void WriteJson(const std::string &path, const std::vector<Report> &reports)
+    {
+        std::ofstream out(path);
+        char date[64];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+        out << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n"
+            << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"library_build_type\": \"" <<
+#ifdef NDEBUG
+            "release"
+#else
+            "debug"
+#endif
+            << "\"\n  },\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < reports.size(); ++i)
+        {
+            const Report &r = reports[i];
+            out << "    {\n      \"name\": \"" << JsonEscape(r.name) << "\",\n"
+                << "      \"run_name\": \"" << JsonEscape(r.name) << "\",\n"
+                << "      \"run_type\": \"iteration\",\n"
+                << "      \"iterations\": " << r.iterations << ",\n"
+                << "      \"real_time\": " << r.nsPerOp << ",\n"
+                << "      \"cpu_time\": " << r.nsPerOp << ",\n"
+                << "      \"time_unit\": \"ns\"";
+            if (r.bytesPerSecond > 0)
+            {
+                out << ",\n      \"bytes_per_second\": " << r.bytesPerSecond;
+            }
+            for (auto &kv : r.counters)
+            {
+                out << ",\n      \"" << JsonEscape(kv.first) << "\": " << kv.second;
+            }
+            out << "\n    }" << (i + 1 < reports.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    // 从之前的 JSON 结果中读出 name -> real_time（只识别本程序写出的格式）
+    std::map<std::string, double> ReadBaseline(const std::string &path)
+    {
+        std::map<std::string, double> baseline;
+        std::ifstream in(path);
+        std::string line, name;
+        while (std::getline(in, line))
+        {
+            size_t pos;
+            if ((pos = line.find("\"name\": \"")) != std::string::npos)
+            {
+                name = line.substr(pos + 9, line.rfind('"') - pos - 9);
+            }
+            else if ((pos = line.find("\"real_time\": ")) != std::string::npos && !name.empty())
+            {
+                baseline[name] = atof(line.c_str() + pos + 13);
+            }
+        }
+        return baseline;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string filter, jsonPath, comparePath;
+    double minTime = 0.5;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]()
+        { return i + 1 < argc ? std::string(argv[++i]) : std::string(); };
+        if (arg == "--filter")
+            filter = next();
+        else if (arg == "--min-time")
+            minTime = atof(next().c_str());
+        else if (arg == "--json")
+            jsonPath = next();
+        else if (arg == "--compare")
+            comparePath = next();
+        else if (arg == "--resources")
+            g_resources = next();
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter substr] [--min-time seconds] [--json out.json] "
+                            "[--compare base.json] [--resources dir]\n",
+                    argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!comparePath.empty())
+    {
+        baseline = ReadBaseline(comparePath);
+    }
+
+    std::vector<Report> reports;
+    printf("%-48s %14s %14s %12s %s\n", "benchmark", "ns/op", "iterations", "MB/s", baseline.empty() ? "" : "vs base");
+    for (auto &bench : Registry())
+    {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        Report r = Run(bench, minTime);
+        printf("%-48s %14.1f %14lu %12.1f", r.name.c_str(), r.nsPerOp, r.iterations, r.bytesPerSecond / (1 << 20));
+        auto base = baseline.find(r.name);
+        if (base != baseline.end() && base->second > 0)
+        {
+            printf(" %+.1f%%", (r.nsPerOp - base->second) / base->second * 100);
+        }
+        for (auto &kv : r.counters)
+        {
+            printf(" %s=%.0f", kv.first.c_str(), kv.second);
+        }
+        printf("\n");
+        fflush(stdout);
+        reports.push_back(std::move(r));
+    }
+
+    if (!jsonPath.empty())
+    {
+        WriteJson(jsonPath, reports);
+    }
+    return 0;
+}
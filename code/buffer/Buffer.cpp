@@ -26,9 +26,9 @@ size_t Buffer::prependableBytes() const
 }
 
 // 将数据追加到缓冲区
-void Buffer::append(const std::string &data)
+void Buffer::append(std::string_view data)
 {
-    append(data.c_str(), data.size());
+    append(data.data(), data.size());
 }
 
 void Buffer::append(const char *data, size_t len)
@@ -43,11 +43,7 @@ std::string Buffer::retrieve(size_t len)
 {
     assert(len <= readableBytes());
     std::string result(peek(), len);
-    reader_index_ += len;
-    if (reader_index_ == writer_index_)
-    {
-        clear(); // 如果全部读取，重置缓冲区
-    }
+    skip(len);
     return result;
 }
 
@@ -57,6 +53,17 @@ std::string Buffer::retrieveAll()
     return retrieve(readableBytes());
 }
 
+// 丢弃指定长度的可读数据
+void Buffer::skip(size_t len)
+{
+    assert(len <= readableBytes());
+    reader_index_ += len;
+    if (reader_index_ == writer_index_)
+    {
+        clear(); // 如果全部读取，重置缓冲区
+    }
+}
+
 // 清空缓冲区
 void Buffer::clear()
 {
@@ -64,6 +71,16 @@ void Buffer::clear()
     writer_index_ = 0;
 }
 
+// 清空并缩小存储
+void Buffer::shrinkTo(size_t size)
+{
+    clear();
+    if (buffer_.size() > size)
+    {
+        std::vector<char>(size).swap(buffer_);
+    }
+}
+
 // 获取当前缓冲区可读数据的起始地址
 const char *Buffer::peek() const
 {
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cassert>
 #include <cstring> // for memcpy
 
@@ -21,7 +22,7 @@ public:
     size_t prependableBytes() const;
 
     // 将数据追加到缓冲区
-    void append(const std::string &data);
+    void append(std::string_view data);
     void append(const char *data, size_t len);
 
     // 从缓冲区中提取指定长度的数据
@@ -30,9 +31,18 @@ public:
     // 从缓冲区中提取所有数据
     std::string retrieveAll();
 
+    // 丢弃指定长度的可读数据（不产生拷贝）
+    void skip(size_t len);
+
     // 清空缓冲区
     void clear();
 
+    // 已分配的存储大小
+    size_t capacity() const { return buffer_.size(); }
+
+    // 清空缓冲区，并把存储缩小到 size（大请求撑大的 vector 不会自行收缩）
+    void shrinkTo(size_t size);
+
     // 获取当前缓冲区可读数据的起始地址
     const char *peek() const;
 
@@ -0,0 +1,164 @@
+/*
+ * assetpack：把静态资源目录打包成内嵌资源
+ *
+ *     assetpack <resources> <outDir>
+ *
+ * 生成两个文件：
+ *   assets.bin       所有资源（及其 gzip 版本）依次排列，每项按 64 字节对齐
+ *   AssetIndex.inc   按路径排序的 constexpr Asset 数组：路径、MIME 类型、ETag、各版本的偏移与长度
+ * 由 AssetBundle.cpp 以 .incbin 链接进只读段。内容没有变化时不改写输出，避免无谓的重新编译。
+ */
+#include "../http/MimeType.h"
+#include "../http/StaticFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr size_t ALIGN = 64; // 每项的起始对齐
+
+    struct Entry
+    {
+        std::string path;
+        std::string_view mime;
+        std::string etag, gzipEtag;
+        size_t offset = 0, size = 0;
+        size_t gzipOffset = 0, gzipSize = 0;
+    };
+
+    bool ReadFile(const fs::path &path, std::string &out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    // 内容不同时才写入，保持输出文件的修改时间
+    bool WriteIfChanged(const fs::path &path, const std::string &data)
+    {
+        std::string old;
+        if (ReadFile(path, old) && old == data)
+            return true;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        return static_cast<bool>(out);
+    }
+
+    void Append(std::string &blob, const std::string &data, size_t &offset)
+    {
+        blob.resize((blob.size() + ALIGN - 1) / ALIGN * ALIGN, '\0');
+        offset = blob.size();
+        blob += data;
+    }
+
+    // C++ 字符串字面量
+    std::string Quote(std::string_view s)
+    {
+        std::string out = "\"";
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <resources> <outDir>\n";
+        return 1;
+    }
+    fs::path root = argv[1];
+    fs::path outDir = argv[2];
+
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (!name.empty() && name[0] == '.')
+        {
+            if (it->is_directory())
+                it.disable_recursion_pending();
+            continue; // .DS_Store 等隐藏文件
+        }
+        if (it->is_regular_file())
+            files.push_back(it->path());
+    }
+    if (ec || files.empty())
+    {
+        std::cerr << "assetpack: no files under " << root << (ec ? ": " + ec.message() : "") << "\n";
+        return 1;
+    }
+
+    std::vector<Entry> entries;
+    std::string blob;
+    size_t gzipped = 0;
+    for (const fs::path &file : files)
+    {
+        std::string data;
+        if (!ReadFile(file, data))
+        {
+            std::cerr << "assetpack: cannot read " << file << "\n";
+            return 1;
+        }
+
+        Entry e;
+        e.path = "/" + fs::relative(file, root).generic_string();
+        e.mime = Mime::FromPath(e.path);
+        std::string hash = StaticContent::Hash(data);
+        e.etag = "\"" + hash + "\"";
+        e.size = data.size();
+        Append(blob, data, e.offset);
+
+        std::string gz;
+        if (Mime::Compressible(e.mime) && StaticContent::Gzip(data, gz))
+        {
+            e.gzipEtag = "\"" + hash + "-gz\"";
+            e.gzipSize = gz.size();
+            Append(blob, gz, e.gzipOffset);
+            ++gzipped;
+        }
+        entries.push_back(std::move(e));
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+              { return a.path < b.path; });
+
+    std::ostringstream index;
+    index << "// 由 assetpack 从 " << root.generic_string() << " 生成，请勿手动修改\n"
+          << "constexpr Asset ASSETS[] = {\n";
+    for (const Entry &e : entries)
+    {
+        index << "    {" << Quote(e.path) << ", " << Quote(e.mime) << ", " << Quote(e.etag) << ", "
+              << Quote(e.gzipEtag) << ", " << e.offset << ", " << e.size << ", " << e.gzipOffset << ", "
+              << e.gzipSize << "},\n";
+    }
+    index << "};\n";
+
+    fs::create_directories(outDir, ec);
+    if (!WriteIfChanged(outDir / "assets.bin", blob) || !WriteIfChanged(outDir / "AssetIndex.inc", index.str()))
+    {
+        std::cerr << "assetpack: cannot write to " << outDir << "\n";
+        return 1;
+    }
+    std::cout << "assetpack: " << entries.size() << " files (" << gzipped << " with gzip), " << blob.size()
+              << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "CoReactor.h"
+#include "../metrics/Metrics.h"
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+CoReactor::CoReactor(Epoll &epoller, ThreadPool &blockingPool)
+    : epoller_(epoller), pool_(blockingPool)
+{
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ == -1)
+    {
+        throw std::runtime_error("Failed to create eventfd");
+    }
+    epoller_.AddFd(wakeFd_, EPOLLIN);
+}
+
+CoReactor::~CoReactor()
+{
+    epoller_.DelFd(wakeFd_);
+    close(wakeFd_);
+}
+
+void CoReactor::Post(std::function<void()> fn)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(postMtx_);
+        wasEmpty = posted_.empty();
+        posted_.push_back(std::move(fn));
+    }
+    if (wasEmpty)
+    {
+        uint64_t one = 1;
+        (void)!write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+void CoReactor::Poll()
+{
+    {
+        // 先在锁内清零 eventfd 再取走队列：之后的 Post 看到空队列会重新写 eventfd，唤醒不会丢失；
+        // 若在交换之后才读，期间 Post 写入的唤醒会被这次 read 清掉，回调留在队列里无人处理
+        std::lock_guard<std::mutex> lock(postMtx_);
+        uint64_t count;
+        (void)!read(wakeFd_, &count, sizeof(count));
+        running_.swap(posted_);
+    }
+    if (!running_.empty())
+    {
+        for (auto &fn : running_)
+        {
+            fn();
+        }
+        running_.clear();
+    }
+
+    uint64_t now = Metrics::NowNs();
+    while (!timers_.empty() && timers_.top().deadlineNs <= now)
+    {
+        std::coroutine_handle<> h = timers_.top().handle;
+        timers_.pop();
+        h.resume();
+    }
+}
+
+int CoReactor::NextTimeoutMs() const
+{
+    if (timers_.empty())
+    {
+        return -1;
+    }
+    uint64_t now = Metrics::NowNs();
+    uint64_t deadline = timers_.top().deadlineNs;
+    return deadline <= now ? 0 : static_cast<int>((deadline - now + 999999) / 1000000);
+}
+
+void CoReactor::OnEvent(int fd, uint32_t events)
+{
+    auto it = waiters_.find(fd);
+    if (it == waiters_.end())
+    {
+        return;
+    }
+    Waiter waiter = it->second;
+    waiters_.erase(it);
+    *waiter.events = events;
+    waiter.handle.resume();
+}
+
+void CoReactor::Watch_(int fd, uint32_t interest, std::coroutine_handle<> h, uint32_t *events)
+{
+    // 连接此时处于 EPOLLONESHOT 的未激活状态，重新注册后事件只会交给这里
+    waiters_[fd] = Waiter{h, events};
+    epoller_.ModFd(fd, interest | EPOLLET | EPOLLONESHOT);
+}
+
+void CoReactor::AddTimer_(uint64_t ms, std::coroutine_handle<> h)
+{
+    timers_.push(Timer{Metrics::NowNs() + ms * 1000000, timerSeq_++, h});
+}
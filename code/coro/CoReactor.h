@@ -0,0 +1,151 @@
+#ifndef CO_REACTOR_H
+#define CO_REACTOR_H
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "Task.h"
+#include "../webserver/Epoll.h"
+#include "../pool/ThreadPool.h"
+
+/*
+ * 协程在 reactor 线程上的调度器
+ * 提供等待套接字可读/可写、定时器和把阻塞调用（如数据库查询）放到线程池执行的 awaitable。
+ * 协程只在 reactor 线程上恢复；其他线程通过 Post() 把回调交给 reactor，并用 eventfd 唤醒它。
+ */
+class CoReactor
+{
+public:
+    CoReactor(Epoll &epoller, ThreadPool &blockingPool);
+    ~CoReactor();
+
+    CoReactor(const CoReactor &) = delete;
+    CoReactor &operator=(const CoReactor &) = delete;
+
+    // 线程安全：在 reactor 线程上执行 fn
+    void Post(std::function<void()> fn);
+
+    // 以下只在 reactor 线程上调用
+    int WakeFd() const { return wakeFd_; }
+    void Poll();               // 执行投递的回调、触发到期的定时器
+    int NextTimeoutMs() const; // 距下一个定时器的毫秒数，没有定时器时返回 -1
+    bool Owns(int fd) const { return waiters_.count(fd) != 0; }
+    void OnEvent(int fd, uint32_t events);
+
+    // co_await Readable(fd) / Writable(fd)：返回 epoll 报告的事件
+    struct IoAwaiter
+    {
+        CoReactor &reactor;
+        int fd;
+        uint32_t interest;
+        uint32_t events = 0;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { reactor.Watch_(fd, interest, h, &events); }
+        uint32_t await_resume() const noexcept { return events; }
+    };
+    IoAwaiter Readable(int fd) { return IoAwaiter{*this, fd, EPOLLIN}; }
+    IoAwaiter Writable(int fd) { return IoAwaiter{*this, fd, EPOLLOUT}; }
+
+    // co_await Sleep(ms)
+    struct SleepAwaiter
+    {
+        CoReactor &reactor;
+        uint64_t ms;
+
+        bool await_ready() const noexcept { return ms == 0; }
+        void await_suspend(std::coroutine_handle<> h) { reactor.AddTimer_(ms, h); }
+        void await_resume() const noexcept {}
+    };
+    SleepAwaiter Sleep(uint64_t ms) { return SleepAwaiter{*this, ms}; }
+
+    // co_await Blocking(fn)：fn 在线程池中执行，完成后协程回到 reactor 线程继续，返回 fn 的结果
+    template <typename F>
+    struct BlockingAwaiter
+    {
+        using Result = std::invoke_result_t<F>;
+        using Stored = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+
+        CoReactor &reactor;
+        F fn;
+        std::optional<Stored> result;
+        std::exception_ptr exception;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            // 挂起期间 awaiter 存放在协程帧里，地址不变
+            reactor.pool_.addDetachedTask([this, h]()
+                                          {
+                                              try
+                                              {
+                                                  if constexpr (std::is_void_v<Result>)
+                                                  {
+                                                      fn();
+                                                      result.emplace(true);
+                                                  }
+                                                  else
+                                                  {
+                                                      result.emplace(fn());
+                                                  }
+                                              }
+                                              catch (...)
+                                              {
+                                                  exception = std::current_exception();
+                                              }
+                                              reactor.Post([h]()
+                                                           { h.resume(); }); });
+        }
+        Result await_resume()
+        {
+            if (exception)
+                std::rethrow_exception(exception);
+            if constexpr (!std::is_void_v<Result>)
+                return std::move(*result);
+        }
+    };
+    template <typename F>
+    BlockingAwaiter<std::decay_t<F>> Blocking(F &&fn) { return {*this, std::forward<F>(fn)}; }
+
+private:
+    struct Waiter
+    {
+        std::coroutine_handle<> handle;
+        uint32_t *events;
+    };
+
+    struct Timer
+    {
+        uint64_t deadlineNs;
+        uint64_t seq; // 同一时刻的定时器按加入顺序触发
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer &other) const
+        {
+            return deadlineNs != other.deadlineNs ? deadlineNs > other.deadlineNs : seq > other.seq;
+        }
+    };
+
+    void Watch_(int fd, uint32_t interest, std::coroutine_handle<> h, uint32_t *events);
+    void AddTimer_(uint64_t ms, std::coroutine_handle<> h);
+
+    Epoll &epoller_;
+    ThreadPool &pool_;
+    int wakeFd_;
+
+    std::unordered_map<int, Waiter> waiters_; // 只在 reactor 线程上访问
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t timerSeq_ = 0;
+
+    std::mutex postMtx_;
+    std::vector<std::function<void()>> posted_;
+    std::vector<std::function<void()>> running_; // Poll 时与 posted_ 交换，避免持锁执行回调
+};
+
+#endif // CO_REACTOR_H
@@ -0,0 +1,195 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <utility>
+
+/*
+ * 协程帧分配器
+ * 按 64 字节分级的线程本地空闲链表，帧在 reactor 线程上创建和销毁，稳态下不再调用 malloc。
+ * 超过最大级别的帧直接走全局 operator new。
+ */
+class FramePool
+{
+public:
+    static void *Allocate(size_t size)
+    {
+        size_t cls = (size + GRANULE - 1) / GRANULE;
+        if (cls >= CLASS_COUNT)
+        {
+            return ::operator new(size);
+        }
+        FreeNode *&head = Lists()[cls];
+        if (head != nullptr)
+        {
+            FreeNode *node = head;
+            head = node->next;
+            return node;
+        }
+        return ::operator new(cls * GRANULE);
+    }
+
+    static void Free(void *ptr, size_t size)
+    {
+        size_t cls = (size + GRANULE - 1) / GRANULE;
+        if (cls >= CLASS_COUNT)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+        FreeNode *node = static_cast<FreeNode *>(ptr);
+        node->next = Lists()[cls];
+        Lists()[cls] = node;
+    }
+
+private:
+    static constexpr size_t GRANULE = 64;
+    static constexpr size_t CLASS_COUNT = 32; // 最大 2KB
+
+    struct FreeNode
+    {
+        FreeNode *next;
+    };
+
+    // 线程退出时空闲块随进程回收，不做逐块释放
+    static FreeNode **Lists()
+    {
+        thread_local FreeNode *lists[CLASS_COUNT] = {};
+        return lists;
+    }
+};
+
+template <typename T>
+class Task;
+
+namespace detail
+{
+    // 协程结束时切回等待它的协程（对称转移，不增加调用栈深度）
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            auto &promise = h.promise();
+            if (promise.continuation)
+            {
+                return promise.continuation;
+            }
+            if (promise.detached)
+            {
+                h.destroy(); // 独立运行的协程没有等待者，自行销毁
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+        bool detached = false;
+
+        static void *operator new(size_t size) { return FramePool::Allocate(size); }
+        static void operator delete(void *ptr, size_t size) { FramePool::Free(ptr, size); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase
+    {
+        std::optional<T> value;
+        Task<T> get_return_object();
+        void return_value(T v) { value = std::move(v); }
+        T take()
+        {
+            if (exception)
+                std::rethrow_exception(exception);
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() {}
+        void take()
+        {
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+    };
+}
+
+/*
+ * 惰性启动的协程任务
+ * co_await 时才开始执行，结束后回到等待者；最外层任务用 Spawn() 独立运行。
+ */
+template <typename T = void>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle h) : handle_(h) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().take(); }
+
+    // 放弃所有权并开始执行；协程结束时自行销毁
+    friend void Spawn(Task<void> task);
+
+private:
+    Handle handle_;
+};
+
+namespace detail
+{
+    template <typename T>
+    Task<T> Promise<T>::get_return_object() { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+
+    inline Task<void> Promise<void>::get_return_object() { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+}
+
+inline void Spawn(Task<void> task)
+{
+    auto h = std::exchange(task.handle_, {});
+    h.promise().detached = true;
+    h.resume();
+}
+
+#endif // TASK_H
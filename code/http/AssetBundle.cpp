@@ -0,0 +1,129 @@
+#include "AssetBundle.h"
+#include "Log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef WEBSERVER_EMBED_ASSETS
+
+// 资源块：由 assetpack 生成的 assets.bin，整体放进只读段并按页对齐
+asm(".pushsection .rodata.webserver_assets, \"a\", @progbits\n"
+    ".balign 4096\n"
+    ".global webserver_assets_begin\n"
+    ".hidden webserver_assets_begin\n"
+    "webserver_assets_begin:\n"
+    ".incbin \"" WEBSERVER_ASSET_BLOB "\"\n"
+    ".global webserver_assets_end\n"
+    ".hidden webserver_assets_end\n"
+    "webserver_assets_end:\n"
+    ".popsection\n");
+
+extern "C" const char webserver_assets_begin[];
+extern "C" const char webserver_assets_end[];
+
+namespace
+{
+#include "AssetIndex.inc" // constexpr Asset ASSETS[]，按 path 排序
+
+    constexpr bool SORTED = []
+    {
+        for (size_t i = 1; i < std::size(ASSETS); ++i)
+        {
+            if (!(ASSETS[i - 1].path < ASSETS[i].path))
+                return false;
+        }
+        return true;
+    }();
+    static_assert(SORTED, "asset index must be sorted by path");
+
+    const Asset *Begin() { return ASSETS; }
+    const Asset *End() { return ASSETS + std::size(ASSETS); }
+    const char *Blob() { return webserver_assets_begin; }
+    size_t BlobSize() { return webserver_assets_end - webserver_assets_begin; }
+}
+
+#else
+
+namespace
+{
+    const Asset *Begin() { return nullptr; }
+    const Asset *End() { return nullptr; }
+    const char *Blob() { return nullptr; }
+    size_t BlobSize() { return 0; }
+}
+
+#endif // WEBSERVER_EMBED_ASSETS
+
+namespace
+{
+    // 索引项换成响应直接使用的视图，与 ASSETS 一一对应
+    const std::vector<StaticFile> &Files()
+    {
+        static const std::vector<StaticFile> files = []
+        {
+            std::vector<StaticFile> out;
+            out.reserve(End() - Begin());
+            for (const Asset *a = Begin(); a != End(); ++a)
+            {
+                StaticFile f;
+                f.path = a->path;
+                f.mime = a->mime;
+                f.etag = a->etag;
+                f.gzipEtag = a->gzipEtag;
+                f.data = std::string_view(Blob() + a->offset, a->size);
+                if (a->gzipSize > 0)
+                {
+                    f.gzip = std::string_view(Blob() + a->gzipOffset, a->gzipSize);
+                }
+                out.push_back(f);
+            }
+            return out;
+        }();
+        return files;
+    }
+}
+
+const StaticFile *AssetBundle::Find(std::string_view path)
+{
+    const Asset *it = std::lower_bound(Begin(), End(), path, [](const Asset &asset, std::string_view key)
+                                       { return asset.path < key; });
+    return it != End() && it->path == path ? &Files()[it - Begin()] : nullptr;
+}
+
+size_t AssetBundle::Count()
+{
+    return End() - Begin();
+}
+
+size_t AssetBundle::Bytes()
+{
+    return BlobSize();
+}
+
+size_t AssetBundle::Prefault(size_t lockBytes)
+{
+    Files(); // 同时建好查找表
+    if (BlobSize() == 0)
+        return 0;
+    const size_t page = sysconf(_SC_PAGESIZE);
+    char *begin = const_cast<char *>(Blob()); // 资源块按页对齐
+    size_t len = BlobSize();
+    madvise(begin, len, MADV_WILLNEED);
+    volatile char sink = 0;
+    for (size_t off = 0; off < len; off += page)
+    {
+        sink = sink + begin[off]; // 只读映射，读一次即建立页表项
+    }
+
+    size_t locked = std::min(len, lockBytes);
+    if (locked > 0 && mlock(begin, locked) != 0)
+    {
+        LOG_WARN("Asset bundle mlock of %zu bytes failed: %s", locked, strerror(errno));
+        locked = 0;
+    }
+    return locked;
+}
@@ -0,0 +1,43 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include "StaticFile.h"
+#include <cstddef>
+#include <string_view>
+
+// 内嵌资源索引的一项（assetpack 生成）；偏移相对于资源块起始处，没有预压缩版本时 gzipSize 为 0
+struct Asset
+{
+    std::string_view path; // 请求路径，例如 "/index.html"
+    std::string_view mime;
+    std::string_view etag;     // 强 ETag（含引号），按内容哈希生成
+    std::string_view gzipEtag; // gzip 版本的 ETag
+    size_t offset;
+    size_t size;
+    size_t gzipOffset;
+    size_t gzipSize;
+};
+
+/*
+ * 编译进可执行文件的静态资源
+ * 构建时 assetpack 把 resources/ 打成一个按页对齐的只读块（.rodata），并生成按路径排序的 constexpr 索引；
+ * 响应体直接指向这块内存，不打开、不 stat、不 mmap 任何文件，启动后即是热的。
+ * 以 -DEMBED_ASSETS=OFF 构建时索引为空，所有请求照旧从磁盘读取。
+ */
+class AssetBundle
+{
+public:
+    // 按请求路径查找，不存在时返回 nullptr
+    static const StaticFile *Find(std::string_view path);
+
+    static size_t Count();
+
+    // 资源块总字节数
+    static size_t Bytes();
+
+    // 启动预热：预读整个资源块，消除首次访问时的缺页；lockBytes > 0 时 mlock 前 lockBytes 字节
+    // 返回实际锁定的字节数
+    static size_t Prefault(size_t lockBytes);
+};
+
+#endif // ASSET_BUNDLE_H
@@ -0,0 +1,122 @@
+#include "CoContext.h"
+#include <charconv>
+
+Task<bool> CoContext::Respond(int code, const char *contentType, std::string body)
+{
+    if (responded_ || failed_)
+    {
+        co_return false;
+    }
+    responded_ = true;
+    conn_.state_->response.InitContent(contentType, std::move(body), conn_.state_->request.IsKeepAlive(), code);
+    conn_.PrepareWrite_();
+    co_return co_await Flush_();
+}
+
+Task<bool> CoContext::BeginStream(int code, const char *contentType)
+{
+    if (responded_ || failed_)
+    {
+        co_return false;
+    }
+    responded_ = true;
+    streaming_ = true;
+    conn_.state_->response.InitContent(contentType, std::string(), conn_.state_->request.IsKeepAlive(), code);
+    conn_.state_->response.SetChunked(true);
+    conn_.PrepareWrite_();
+    co_return co_await Flush_();
+}
+
+Task<bool> CoContext::Write(std::string_view chunk)
+{
+    if (!streaming_ || failed_)
+    {
+        co_return false;
+    }
+    if (chunk.empty())
+    {
+        co_return true; // 空块表示结束，不能在这里发送
+    }
+    char size[24];
+    auto res = std::to_chars(size, size + sizeof(size) - 2, chunk.size(), 16);
+    *res.ptr++ = '\r';
+    *res.ptr++ = '\n';
+    co_return co_await Send_(std::string_view(size, res.ptr - size)) &&
+        co_await Send_(chunk) &&
+        co_await Send_("\r\n");
+}
+
+Task<bool> CoContext::EndStream()
+{
+    if (!streaming_ || failed_)
+    {
+        co_return false;
+    }
+    streaming_ = false;
+    co_return co_await Send_("0\r\n\r\n");
+}
+
+Task<ssize_t> CoContext::Read()
+{
+    while (!failed_)
+    {
+        int err = 0;
+        ssize_t len = conn_.ReadOnce_(&err);
+        if (len >= 0)
+        {
+            co_return len;
+        }
+        if (err != EAGAIN && err != EWOULDBLOCK)
+        {
+            break;
+        }
+        uint32_t events = co_await reactor_.Readable(conn_.fd_);
+        if (events & EPOLLERR)
+        {
+            break;
+        }
+    }
+    failed_ = true;
+    co_return -1;
+}
+
+Task<bool> CoContext::Flush_()
+{
+    while (conn_.ToWriteBytes() > 0)
+    {
+        int err = 0;
+        if (conn_.write(&err) < 0 || (conn_.ToWriteBytes() > 0 && err != EAGAIN && err != EWOULDBLOCK))
+        {
+            failed_ = true;
+            co_return false;
+        }
+        if (conn_.ToWriteBytes() > 0 && (co_await reactor_.Writable(conn_.fd_) & (EPOLLERR | EPOLLHUP)))
+        {
+            failed_ = true;
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+Task<bool> CoContext::Send_(std::string_view data)
+{
+    while (!data.empty())
+    {
+        ssize_t len = conn_.Send_(data.data(), data.size());
+        if (len > 0)
+        {
+            CounterAdd(Metrics::Local().bytesSent, len);
+            data.remove_prefix(len);
+            continue;
+        }
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+            !(co_await reactor_.Writable(conn_.fd_) & (EPOLLERR | EPOLLHUP)))
+        {
+            continue;
+        }
+        failed_ = true;
+        co_return false;
+    }
+    co_return true;
+}
@@ -0,0 +1,67 @@
+#ifndef CO_CONTEXT_H
+#define CO_CONTEXT_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include "../coro/CoReactor.h"
+#include "../coro/Task.h"
+#include "HttpConn.h"
+
+/*
+ * 协程处理函数看到的请求上下文
+ * 处理函数在 reactor 线程上运行，通过 co_await 读写套接字、等待定时器或把数据库查询交给线程池，
+ * 期间不占用任何工作线程。上下文只在处理函数运行期间有效。
+ *
+ *     Router::Instance()->AddAsync(Router::GET, "/hello/:name", [](CoContext &ctx) -> Task<void> {
+ *         std::string name(ctx.Params().Get("name"));
+ *         co_await ctx.Sleep(10);
+ *         co_await ctx.Respond(200, "text/plain", "hello " + name);
+ *     });
+ */
+class CoContext
+{
+public:
+    CoContext(HttpConn &conn, CoReactor &reactor) : conn_(conn), reactor_(reactor) {}
+
+    const HttpRequest &Request() const { return conn_.state_->request; }
+    const RouteParams &Params() const { return conn_.state_->request.Params(); }
+
+    // 发送完整响应；contentType 须指向静态字符串。返回 false 表示连接已断开
+    Task<bool> Respond(int code, const char *contentType, std::string body);
+
+    // 以 chunked 编码分块发送响应体：BeginStream 写出头部，Write 写出一块，EndStream 写出结束块
+    // 处理函数返回时未调用 EndStream 的会自动补上
+    Task<bool> BeginStream(int code, const char *contentType);
+    Task<bool> Write(std::string_view chunk);
+    Task<bool> EndStream();
+
+    // 读取更多数据追加到连接的读缓冲区，没有数据时挂起等待；返回读到的字节数，0 表示对端已关闭
+    Task<ssize_t> Read();
+
+    // co_await ctx.Sleep(ms)
+    CoReactor::SleepAwaiter Sleep(uint64_t ms) { return reactor_.Sleep(ms); }
+
+    // co_await ctx.Db(fn)：fn 在阻塞线程池中执行，返回 fn 的结果
+    template <typename F>
+    auto Db(F &&fn) { return reactor_.Blocking(std::forward<F>(fn)); }
+
+    bool Responded() const { return responded_; }
+    bool Streaming() const { return streaming_; }
+    bool Failed() const { return failed_; }
+
+private:
+    // 写出连接上已准备好的响应头（及响应体）
+    Task<bool> Flush_();
+
+    // 直接写出一段数据，缓冲区满时等待可写
+    Task<bool> Send_(std::string_view data);
+
+    HttpConn &conn_;
+    CoReactor &reactor_;
+    bool responded_ = false;
+    bool streaming_ = false;
+    bool failed_ = false;
+};
+
+#endif // CO_CONTEXT_H
@@ -0,0 +1,72 @@
+#include "ConnState.h"
+
+namespace
+{
+    constexpr size_t BUFFER_INITIAL = 1024; // 与 Buffer 的默认初始大小一致
+}
+
+ConnStatePool *ConnStatePool::Instance()
+{
+    static ConnStatePool pool;
+    return &pool;
+}
+
+ConnStatePool::~ConnStatePool()
+{
+    for (ConnState *state : idle_)
+    {
+        delete state;
+    }
+}
+
+ConnState *ConnStatePool::Acquire()
+{
+    inUse_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!idle_.empty())
+        {
+            ConnState *state = idle_.back();
+            idle_.pop_back();
+            return state;
+        }
+    }
+    return new ConnState();
+}
+
+void ConnStatePool::Release(ConnState *state)
+{
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+
+    // 在锁外重置：释放请求内存区的溢出块、文件映射，缩回被撑大的缓冲区
+    state->request.Init();
+    state->response.Release();
+    state->trace.Reset();
+    state->readBuff.clear();
+    state->writeBuff.clear();
+    if (state->readBuff.capacity() > BUFFER_KEEP)
+        state->readBuff.shrinkTo(BUFFER_INITIAL);
+    if (state->writeBuff.capacity() > BUFFER_KEEP)
+        state->writeBuff.shrinkTo(BUFFER_INITIAL);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (idle_.size() < MAX_IDLE)
+        {
+            idle_.push_back(state);
+            return;
+        }
+    }
+    delete state;
+}
+
+size_t ConnStatePool::Idle() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return idle_.size();
+}
+
+size_t ConnStatePool::StateBytes()
+{
+    return sizeof(ConnState) + RequestArena::DEFAULT_BLOCK_SIZE + 2 * BUFFER_INITIAL;
+}
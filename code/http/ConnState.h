@@ -0,0 +1,66 @@
+#ifndef CONN_STATE_H
+#define CONN_STATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "../buffer/Buffer.h"
+#include "../trace/Trace.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+/*
+ * 连接上只有处理请求期间才需要的状态：读写缓冲区、请求与响应对象、追踪记录
+ * 连接从读到数据开始持有一份，响应写完且没有未解析的数据时归还 ConnStatePool，
+ * 空闲的长连接只剩 HttpConn 本身的几百字节。
+ */
+struct ConnState
+{
+    ConnState() { request.SetTrace(&trace); }
+
+    ConnState(const ConnState &) = delete;
+    ConnState &operator=(const ConnState &) = delete;
+
+    Buffer readBuff;       // 读缓冲区
+    Buffer writeBuff;      // 写缓冲区（响应头）
+    HttpRequest request;   // HTTP 请求对象
+    HttpResponse response; // HTTP 响应对象
+    RequestTrace trace;    // 当前请求的阶段打点
+};
+
+/*
+ * ConnState 的共享空闲表
+ * 同时在处理请求的连接数远小于连接总数，缓存的对象个数有上限。归还时丢弃大请求撑大的缓冲区，
+ * 释放响应持有的文件映射与内存内容，使缓存中的每个对象大小固定。
+ */
+class ConnStatePool
+{
+public:
+    static ConnStatePool *Instance();
+
+    ConnState *Acquire();
+    void Release(ConnState *state);
+
+    // 正在被连接使用的对象数
+    size_t InUse() const { return inUse_.load(std::memory_order_relaxed); }
+
+    // 空闲表中的对象数
+    size_t Idle() const;
+
+    // 单个对象的常驻内存（对象本身 + 请求内存区 + 两个缓冲区的初始容量）
+    static size_t StateBytes();
+
+    static constexpr size_t MAX_IDLE = 1024;          // 空闲表上限，超出的对象直接释放
+    static constexpr size_t BUFFER_KEEP = 16 * 1024;  // 归还时缓冲区容量超过它就缩回初始大小
+
+private:
+    ConnStatePool() = default;
+    ~ConnStatePool();
+
+    mutable std::mutex mtx_;
+    std::vector<ConnState *> idle_;
+    std::atomic<size_t> inUse_{0};
+};
+
+#endif // CONN_STATE_H
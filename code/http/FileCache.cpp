@@ -0,0 +1,260 @@
+#include "FileCache.h"
+#include "../webserver/OptionParse.h"
+#include "Log.h"
+#include "MimeType.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+bool FileCacheOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "on")
+        return OptionParse::Flag(value, enabled);
+    if (name == "maxfile")
+        return OptionParse::Number<size_t>(value, maxFileBytes, 0);
+    if (name == "max")
+        return OptionParse::Number<size_t>(value, maxBytes, 0);
+    if (name == "populate")
+        return OptionParse::Flag(value, populate);
+    if (name == "lock")
+        return OptionParse::Number<size_t>(value, lockBytes, 0);
+    if (name == "gzip")
+        return OptionParse::Flag(value, gzip);
+    if (name == "threads")
+        return OptionParse::Number(value, threads, 0);
+    if (name == "deadline")
+        return OptionParse::Number(value, deadlineMs, 0);
+    return false;
+}
+
+FileCache::FileCache(const Options &options)
+    : options_(options), stop_(false), bytes_(0), locked_(0), ready_(false)
+{
+}
+
+FileCache::~FileCache()
+{
+    stop_ = true;
+    if (loader_.joinable())
+    {
+        loader_.join();
+    }
+    for (Entry &e : entries_)
+    {
+        if (e.map != nullptr)
+        {
+            munmap(e.map, e.mapLen); // 同时解除 mlock
+        }
+    }
+}
+
+void FileCache::Start(const std::string &dir)
+{
+    loader_ = std::thread(&FileCache::Run_, this, dir);
+}
+
+bool FileCache::Wait(int timeoutMs)
+{
+    std::unique_lock<std::mutex> locker(mtx_);
+    return cond_.wait_for(locker, std::chrono::milliseconds(std::max(timeoutMs, 0)), [this]()
+                          { return Ready(); });
+}
+
+const StaticFile *FileCache::Find(std::string_view path) const
+{
+    if (!Ready())
+    {
+        return nullptr;
+    }
+    auto it = std::lower_bound(files_.begin(), files_.end(), path, [](const StaticFile &file, std::string_view key)
+                               { return file.path < key; });
+    return it != files_.end() && it->path == path ? &*it : nullptr;
+}
+
+void FileCache::Run_(std::string dir)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // 扫描目录：只收集路径与大小，读取留给加载线程
+    std::error_code ec;
+    fs::path root(dir);
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (!name.empty() && name[0] == '.')
+        {
+            if (it->is_directory(ec))
+                it.disable_recursion_pending();
+            continue;
+        }
+        std::error_code fileEc;
+        if (!it->is_regular_file(fileEc))
+            continue;
+        size_t size = it->file_size(fileEc);
+        if (fileEc || size > options_.maxFileBytes)
+            continue;
+        Entry e;
+        e.fullPath = it->path().string();
+        e.path = "/" + fs::relative(it->path(), root, fileEc).generic_string();
+        e.size = size;
+        entries_.push_back(std::move(e));
+    }
+    if (ec)
+    {
+        LOG_WARN("File cache: cannot scan %s: %s", dir.c_str(), ec.message().c_str());
+    }
+
+    // 小文件优先：同样的预算能覆盖更多请求，页面、样式、脚本通常也是最常访问的
+    std::sort(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b)
+              { return a.size < b.size; });
+    size_t budget = 0, lockBudget = 0, n = 0;
+    for (; n < entries_.size() && budget + entries_[n].size <= options_.maxBytes; ++n)
+    {
+        budget += entries_[n].size;
+        if (lockBudget + entries_[n].size <= options_.lockBytes)
+        {
+            lockBudget += entries_[n].size;
+            entries_[n].lock = true;
+        }
+    }
+    entries_.resize(n);
+
+    // 并行加载：各线程领取下标，互不共享 Entry
+    int threads = options_.threads > 0 ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<int>(threads, std::max<size_t>(entries_.size(), 1));
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([this, &next]()
+                             {
+                                 for (size_t i = next++; i < entries_.size() && !stop_; i = next++)
+                                 {
+                                     Load_(entries_[i]);
+                                 } });
+    }
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    size_t gzipped = 0;
+    for (Entry &e : entries_)
+    {
+        if (!e.ok)
+            continue;
+        StaticFile f;
+        f.path = e.path;
+        f.mime = Mime::FromPath(e.path);
+        f.etag = e.etag;
+        f.data = std::string_view(e.map, e.size);
+        if (!e.gzip.empty())
+        {
+            f.gzip = e.gzip;
+            f.gzipEtag = e.gzipEtag;
+            ++gzipped;
+        }
+        files_.push_back(f);
+        bytes_ += e.size + e.gzip.size();
+        locked_ += e.lock ? e.mapLen : 0;
+    }
+    std::sort(files_.begin(), files_.end(), [](const StaticFile &a, const StaticFile &b)
+              { return a.path < b.path; });
+
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        ready_.store(!stop_, std::memory_order_release);
+    }
+    cond_.notify_all();
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("File cache: %zu files (%zu with gzip, %zu bytes, %zu locked) from %s in %lld ms", files_.size(), gzipped,
+             bytes_, locked_, dir.c_str(), static_cast<long long>(ms));
+}
+
+void FileCache::Load_(Entry &e)
+{
+    int fd = open(e.fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        LOG_WARN("File cache: cannot open %s: %s", e.fullPath.c_str(), strerror(errno));
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) != e.size)
+    {
+        close(fd); // 扫描之后被改动，留给按请求读取
+        return;
+    }
+    if (e.size > 0)
+    {
+        // 拷贝到匿名内存而不是映射文件：MAP_PRIVATE 映射中未写过的页仍跟随磁盘上的文件，
+        // 原地改写会以旧 ETag 发出新内容，截断则让下一次访问触发 SIGBUS
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | (options_.populate ? MAP_POPULATE : 0);
+        void *map = mmap(nullptr, e.size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (map == MAP_FAILED)
+        {
+            LOG_WARN("File cache: cannot allocate %zu bytes for %s: %s", e.size, e.fullPath.c_str(), strerror(errno));
+            close(fd);
+            return;
+        }
+        e.map = static_cast<char *>(map);
+        e.mapLen = e.size;
+        size_t done = 0;
+        while (done < e.size)
+        {
+            ssize_t len = pread(fd, e.map + done, e.size - done, done);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0)
+                break;
+            done += len;
+        }
+        close(fd);
+        if (done != e.size)
+        {
+            LOG_WARN("File cache: short read of %s (%zu of %zu bytes)", e.fullPath.c_str(), done, e.size);
+            munmap(e.map, e.mapLen); // 读取期间被截断或出错，留给按请求读取
+            e.map = nullptr;
+            e.mapLen = 0;
+            return;
+        }
+        mprotect(e.map, e.mapLen, PROT_READ); // 发布后只读
+        if (e.lock && mlock(e.map, e.mapLen) != 0)
+        {
+            LOG_WARN("File cache: mlock %s failed: %s", e.fullPath.c_str(), strerror(errno));
+            e.lock = false;
+        }
+    }
+    else
+    {
+        close(fd);
+    }
+
+    std::string_view data(e.map, e.size);
+    std::string hash = StaticContent::Hash(data);
+    e.etag = "\"" + hash + "\"";
+    if (options_.gzip && Mime::Compressible(Mime::FromPath(e.path)) && StaticContent::Gzip(data, e.gzip))
+    {
+        e.gzipEtag = "\"" + hash + "-gz\"";
+    }
+    else
+    {
+        std::string().swap(e.gzip);
+    }
+    e.ok = true;
+}
@@ -0,0 +1,77 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include "FileCacheOptions.h"
+#include "StaticFile.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * 磁盘静态文件的启动预热缓存（-e 模式）
+ * 启动时在后台扫描资源目录，多线程把每个文件读进自有的匿名内存，并算好 MIME 类型、ETag 与 gzip 版本；
+ * 按文件大小从小到大装入，直到总量预算，小文件优先 mlock。全部装好后一次性发布，之后 Find 不做任何系统调用。
+ * 缓存是启动时的快照（内容是拷贝，不是文件映射）：之后新增的文件仍按原路径从磁盘读取，
+ * 已缓存文件被改写或截断不影响缓存，修改要重启（或热升级）才生效。
+ */
+class FileCache
+{
+public:
+    using Options = FileCacheOptions;
+
+    explicit FileCache(const Options &options);
+    ~FileCache();
+
+    FileCache(const FileCache &) = delete;
+    FileCache &operator=(const FileCache &) = delete;
+
+    // 在后台开始预热 dir，立即返回
+    void Start(const std::string &dir);
+
+    // 等待预热完成，最多 timeoutMs 毫秒；返回是否已完成。超时后加载继续，完成时自动生效
+    bool Wait(int timeoutMs);
+
+    // 按请求路径查找；预热完成前或未缓存时返回 nullptr
+    const StaticFile *Find(std::string_view path) const;
+
+    bool Ready() const { return ready_.load(std::memory_order_acquire); }
+    size_t Count() const { return Ready() ? files_.size() : 0; }
+    size_t Bytes() const { return Ready() ? bytes_ : 0; }
+    size_t LockedBytes() const { return Ready() ? locked_ : 0; }
+
+private:
+    // 一个缓存文件：files_ 中的视图指向这里的内存
+    struct Entry
+    {
+        std::string fullPath;
+        std::string path;
+        bool lock = false;
+        size_t size = 0;
+        bool ok = false;
+        char *map = nullptr; // 文件内容的拷贝（匿名映射）
+        size_t mapLen = 0;
+        std::string etag, gzipEtag, gzip;
+    };
+
+    void Run_(std::string dir);
+    void Load_(Entry &e);
+
+    Options options_;
+    std::thread loader_;
+    std::atomic<bool> stop_;
+
+    std::vector<Entry> entries_;
+    std::vector<StaticFile> files_; // 按 path 排序，ready_ 之后只读
+    size_t bytes_;
+    size_t locked_;
+
+    std::atomic<bool> ready_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+#endif // FILE_CACHE_H
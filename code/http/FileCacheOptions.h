@@ -0,0 +1,23 @@
+#ifndef FILE_CACHE_OPTIONS_H
+#define FILE_CACHE_OPTIONS_H
+
+#include <cstddef>
+#include <string>
+
+// 启动预热参数（FileCache::Options）
+struct FileCacheOptions
+{
+    bool enabled = true;
+    size_t maxFileBytes = 8 << 20;  // 更大的文件不缓存，仍按请求映射
+    size_t maxBytes = 256 << 20;    // 缓存总量（含 gzip 版本）
+    bool populate = true;           // 分配缓存内存时一次建立页表（MAP_POPULATE）
+    size_t lockBytes = 0;           // mlock 的预算，0 表示不锁定
+    bool gzip = true;               // 为可压缩类型生成 gzip 版本
+    int threads = 0;                // 加载线程数，0 表示 CPU 核数
+    int deadlineMs = 3000;          // 监听套接字最多为预热等待的时间
+
+    // 解析 "name=value"：on, maxfile, max, populate, lock, gzip, threads, deadline；失败返回 false
+    bool Parse(const std::string &arg);
+};
+
+#endif // FILE_CACHE_OPTIONS_H
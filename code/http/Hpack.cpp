@@ -0,0 +1,455 @@
+#include "Hpack.h"
+#include <algorithm>
+
+namespace
+{
+    const HpackHeader STATIC_TABLE[HpackTable::STATIC_COUNT] = {
+        {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+        {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+        {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+        {":status", "404"}, {":status", "500"}, {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"},
+        {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+        {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+        {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+        {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+        {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""},
+        {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+        {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""},
+        {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+        {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""},
+        {"retry-after", ""}, {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""},
+        {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+        {"www-authenticate", ""},
+    };
+
+    // RFC 7541 附录 B：每个符号的 Huffman 码（右对齐）和位数，下标 256 为 EOS
+    struct HuffCode
+    {
+        uint32_t code;
+        uint8_t bits;
+    };
+    const HuffCode HUFF_CODES[257] = {
+    {0x00001ff8, 13}, {0x007fffd8, 23}, {0x0fffffe2, 28}, {0x0fffffe3, 28},
+    {0x0fffffe4, 28}, {0x0fffffe5, 28}, {0x0fffffe6, 28}, {0x0fffffe7, 28},
+    {0x0fffffe8, 28}, {0x00ffffea, 24}, {0x3ffffffc, 30}, {0x0fffffe9, 28},
+    {0x0fffffea, 28}, {0x3ffffffd, 30}, {0x0fffffeb, 28}, {0x0fffffec, 28},
+    {0x0fffffed, 28}, {0x0fffffee, 28}, {0x0fffffef, 28}, {0x0ffffff0, 28},
+    {0x0ffffff1, 28}, {0x0ffffff2, 28}, {0x3ffffffe, 30}, {0x0ffffff3, 28},
+    {0x0ffffff4, 28}, {0x0ffffff5, 28}, {0x0ffffff6, 28}, {0x0ffffff7, 28},
+    {0x0ffffff8, 28}, {0x0ffffff9, 28}, {0x0ffffffa, 28}, {0x0ffffffb, 28},
+    {0x00000014, 6}, {0x000003f8, 10}, {0x000003f9, 10}, {0x00000ffa, 12},
+    {0x00001ff9, 13}, {0x00000015, 6}, {0x000000f8, 8}, {0x000007fa, 11},
+    {0x000003fa, 10}, {0x000003fb, 10}, {0x000000f9, 8}, {0x000007fb, 11},
+    {0x000000fa, 8}, {0x00000016, 6}, {0x00000017, 6}, {0x00000018, 6},
+    {0x00000000, 5}, {0x00000001, 5}, {0x00000002, 5}, {0x00000019, 6},
+    {0x0000001a, 6}, {0x0000001b, 6}, {0x0000001c, 6}, {0x0000001d, 6},
+    {0x0000001e, 6}, {0x0000001f, 6}, {0x0000005c, 7}, {0x000000fb, 8},
+    {0x00007ffc, 15}, {0x00000020, 6}, {0x00000ffb, 12}, {0x000003fc, 10},
+    {0x00001ffa, 13}, {0x00000021, 6}, {0x0000005d, 7}, {0x0000005e, 7},
+    {0x0000005f, 7}, {0x00000060, 7}, {0x00000061, 7}, {0x00000062, 7},
+    {0x00000063, 7}, {0x00000064, 7}, {0x00000065, 7}, {0x00000066, 7},
+    {0x00000067, 7}, {0x00000068, 7}, {0x00000069, 7}, {0x0000006a, 7},
+    {0x0000006b, 7}, {0x0000006c, 7}, {0x0000006d, 7}, {0x0000006e, 7},
+    {0x0000006f, 7}, {0x00000070, 7}, {0x00000071, 7}, {0x00000072, 7},
+    {0x000000fc, 8}, {0x00000073, 7}, {0x000000fd, 8}, {0x00001ffb, 13},
+    {0x0007fff0, 19}, {0x00001ffc, 13}, {0x00003ffc, 14}, {0x00000022, 6},
+    {0x00007ffd, 15}, {0x00000003, 5}, {0x00000023, 6}, {0x00000004, 5},
+    {0x00000024, 6}, {0x00000005, 5}, {0x00000025, 6}, {0x00000026, 6},
+    {0x00000027, 6}, {0x00000006, 5}, {0x00000074, 7}, {0x00000075, 7},
+    {0x00000028, 6}, {0x00000029, 6}, {0x0000002a, 6}, {0x00000007, 5},
+    {0x0000002b, 6}, {0x00000076, 7}, {0x0000002c, 6}, {0x00000008, 5},
+    {0x00000009, 5}, {0x0000002d, 6}, {0x00000077, 7}, {0x00000078, 7},
+    {0x00000079, 7}, {0x0000007a, 7}, {0x0000007b, 7}, {0x00007ffe, 15},
+    {0x000007fc, 11}, {0x00003ffd, 14}, {0x00001ffd, 13}, {0x0ffffffc, 28},
+    {0x000fffe6, 20}, {0x003fffd2, 22}, {0x000fffe7, 20}, {0x000fffe8, 20},
+    {0x003fffd3, 22}, {0x003fffd4, 22}, {0x003fffd5, 22}, {0x007fffd9, 23},
+    {0x003fffd6, 22}, {0x007fffda, 23}, {0x007fffdb, 23}, {0x007fffdc, 23},
+    {0x007fffdd, 23}, {0x007fffde, 23}, {0x00ffffeb, 24}, {0x007fffdf, 23},
+    {0x00ffffec, 24}, {0x00ffffed, 24}, {0x003fffd7, 22}, {0x007fffe0, 23},
+    {0x00ffffee, 24}, {0x007fffe1, 23}, {0x007fffe2, 23}, {0x007fffe3, 23},
+    {0x007fffe4, 23}, {0x001fffdc, 21}, {0x003fffd8, 22}, {0x007fffe5, 23},
+    {0x003fffd9, 22}, {0x007fffe6, 23}, {0x007fffe7, 23}, {0x00ffffef, 24},
+    {0x003fffda, 22}, {0x001fffdd, 21}, {0x000fffe9, 20}, {0x003fffdb, 22},
+    {0x003fffdc, 22}, {0x007fffe8, 23}, {0x007fffe9, 23}, {0x001fffde, 21},
+    {0x007fffea, 23}, {0x003fffdd, 22}, {0x003fffde, 22}, {0x00fffff0, 24},
+    {0x001fffdf, 21}, {0x003fffdf, 22}, {0x007fffeb, 23}, {0x007fffec, 23},
+    {0x001fffe0, 21}, {0x001fffe1, 21}, {0x003fffe0, 22}, {0x001fffe2, 21},
+    {0x007fffed, 23}, {0x003fffe1, 22}, {0x007fffee, 23}, {0x007fffef, 23},
+    {0x000fffea, 20}, {0x003fffe2, 22}, {0x003fffe3, 22}, {0x003fffe4, 22},
+    {0x007ffff0, 23}, {0x003fffe5, 22}, {0x003fffe6, 22}, {0x007ffff1, 23},
+    {0x03ffffe0, 26}, {0x03ffffe1, 26}, {0x000fffeb, 20}, {0x0007fff1, 19},
+    {0x003fffe7, 22}, {0x007ffff2, 23}, {0x003fffe8, 22}, {0x01ffffec, 25},
+    {0x03ffffe2, 26}, {0x03ffffe3, 26}, {0x03ffffe4, 26}, {0x07ffffde, 27},
+    {0x07ffffdf, 27}, {0x03ffffe5, 26}, {0x00fffff1, 24}, {0x01ffffed, 25},
+    {0x0007fff2, 19}, {0x001fffe3, 21}, {0x03ffffe6, 26}, {0x07ffffe0, 27},
+    {0x07ffffe1, 27}, {0x03ffffe7, 26}, {0x07ffffe2, 27}, {0x00fffff2, 24},
+    {0x001fffe4, 21}, {0x001fffe5, 21}, {0x03ffffe8, 26}, {0x03ffffe9, 26},
+    {0x0ffffffd, 28}, {0x07ffffe3, 27}, {0x07ffffe4, 27}, {0x07ffffe5, 27},
+    {0x000fffec, 20}, {0x00fffff3, 24}, {0x000fffed, 20}, {0x001fffe6, 21},
+    {0x003fffe9, 22}, {0x001fffe7, 21}, {0x001fffe8, 21}, {0x007ffff3, 23},
+    {0x003fffea, 22}, {0x003fffeb, 22}, {0x01ffffee, 25}, {0x01ffffef, 25},
+    {0x00fffff4, 24}, {0x00fffff5, 24}, {0x03ffffea, 26}, {0x007ffff4, 23},
+    {0x03ffffeb, 26}, {0x07ffffe6, 27}, {0x03ffffec, 26}, {0x03ffffed, 26},
+    {0x07ffffe7, 27}, {0x07ffffe8, 27}, {0x07ffffe9, 27}, {0x07ffffea, 27},
+    {0x07ffffeb, 27}, {0x0ffffffe, 28}, {0x07ffffec, 27}, {0x07ffffed, 27},
+    {0x07ffffee, 27}, {0x07ffffef, 27}, {0x07fffff0, 27}, {0x03ffffee, 26},
+    {0x3fffffff, 30},
+    };
+
+    // 规范 Huffman 码：同一长度的码字连续，按长度记下首个码字和对应的符号区间即可逐位解码
+    struct HuffDecodeTable
+    {
+        static constexpr int MAX_BITS = 30;
+        uint32_t first[MAX_BITS + 1] = {}; // 该长度的最小码字
+        uint32_t count[MAX_BITS + 1] = {}; // 该长度的码字个数
+        uint32_t offset[MAX_BITS + 1] = {}; // 该长度第一个符号在 symbols 中的位置
+        uint16_t symbols[257] = {};
+
+        HuffDecodeTable()
+        {
+            uint16_t order[257];
+            for (int i = 0; i < 257; ++i)
+                order[i] = static_cast<uint16_t>(i);
+            std::sort(order, order + 257, [](uint16_t a, uint16_t b)
+                      { return HUFF_CODES[a].bits != HUFF_CODES[b].bits ? HUFF_CODES[a].bits < HUFF_CODES[b].bits
+                                                                        : HUFF_CODES[a].code < HUFF_CODES[b].code; });
+            for (int i = 0; i < 257; ++i)
+            {
+                const HuffCode &c = HUFF_CODES[order[i]];
+                if (count[c.bits]++ == 0)
+                {
+                    first[c.bits] = c.code;
+                    offset[c.bits] = i;
+                }
+                symbols[i] = order[i];
+            }
+        }
+    };
+
+    const HuffDecodeTable &DecodeTable()
+    {
+        static const HuffDecodeTable table;
+        return table;
+    }
+
+    // 解码 prefixBits 位前缀的整数（RFC 7541 5.1）
+    bool DecodeInt(std::string_view &in, int prefixBits, uint64_t &value)
+    {
+        if (in.empty())
+            return false;
+        uint64_t mask = (1u << prefixBits) - 1;
+        value = static_cast<uint8_t>(in[0]) & mask;
+        in.remove_prefix(1);
+        if (value < mask)
+            return true;
+        for (int shift = 0; shift <= 56; shift += 7)
+        {
+            if (in.empty())
+                return false;
+            uint8_t b = static_cast<uint8_t>(in[0]);
+            in.remove_prefix(1);
+            value += static_cast<uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false; // 过长，视为非法
+    }
+
+    void EncodeInt(uint8_t flags, int prefixBits, uint64_t value, std::string &out)
+    {
+        uint64_t mask = (1u << prefixBits) - 1;
+        if (value < mask)
+        {
+            out.push_back(static_cast<char>(flags | value));
+            return;
+        }
+        out.push_back(static_cast<char>(flags | mask));
+        value -= mask;
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool DecodeString(std::string_view &in, std::string &out)
+    {
+        if (in.empty())
+            return false;
+        bool huffman = (static_cast<uint8_t>(in[0]) & 0x80) != 0;
+        uint64_t len;
+        if (!DecodeInt(in, 7, len) || len > in.size())
+            return false;
+        std::string_view raw = in.substr(0, len);
+        in.remove_prefix(len);
+        out.clear();
+        if (huffman)
+            return Huffman::Decode(raw, out);
+        out.assign(raw.data(), raw.size());
+        return true;
+    }
+
+    void EncodeString(std::string_view s, std::string &out)
+    {
+        size_t huffLen = Huffman::EncodedLength(s);
+        if (huffLen < s.size())
+        {
+            EncodeInt(0x80, 7, huffLen, out);
+            Huffman::Encode(s, out);
+        }
+        else
+        {
+            EncodeInt(0, 7, s.size(), out);
+            out.append(s.data(), s.size());
+        }
+    }
+}
+
+// ---------------- Huffman ----------------
+
+bool Huffman::Decode(std::string_view in, std::string &out)
+{
+    const HuffDecodeTable &t = DecodeTable();
+    uint32_t code = 0;
+    int bits = 0;
+    for (unsigned char byte : in)
+    {
+        for (int i = 7; i >= 0; --i)
+        {
+            code = (code << 1) | ((byte >> i) & 1);
+            ++bits;
+            if (bits > HuffDecodeTable::MAX_BITS)
+                return false;
+            if (t.count[bits] != 0 && code - t.first[bits] < t.count[bits])
+            {
+                uint16_t sym = t.symbols[t.offset[bits] + (code - t.first[bits])];
+                if (sym == 256)
+                    return false; // 串中出现 EOS 是解码错误
+                out.push_back(static_cast<char>(sym));
+                code = 0;
+                bits = 0;
+            }
+        }
+    }
+    // 结尾的填充必须是 EOS 码的前缀（全 1）且不超过 7 位
+    return bits < 8 && code == (1u << bits) - 1;
+}
+
+size_t Huffman::EncodedLength(std::string_view in)
+{
+    size_t bits = 0;
+    for (unsigned char ch : in)
+        bits += HUFF_CODES[ch].bits;
+    return (bits + 7) / 8;
+}
+
+void Huffman::Encode(std::string_view in, std::string &out)
+{
+    uint64_t acc = 0;
+    int bits = 0;
+    for (unsigned char ch : in)
+    {
+        acc = (acc << HUFF_CODES[ch].bits) | HUFF_CODES[ch].code;
+        bits += HUFF_CODES[ch].bits;
+        while (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+        acc &= (uint64_t(1) << bits) - 1;
+    }
+    if (bits > 0)
+    {
+        out.push_back(static_cast<char>((acc << (8 - bits)) | ((1u << (8 - bits)) - 1)));
+    }
+}
+
+// ---------------- HpackTable ----------------
+
+const HpackHeader *HpackTable::Get(size_t index) const
+{
+    if (index == 0)
+        return nullptr;
+    if (index <= STATIC_COUNT)
+        return &STATIC_TABLE[index - 1];
+    index -= STATIC_COUNT + 1;
+    return index < entries_.size() ? &entries_[index] : nullptr;
+}
+
+size_t HpackTable::Find(std::string_view name, std::string_view value, size_t &nameIndex) const
+{
+    nameIndex = 0;
+    for (size_t i = 0; i < STATIC_COUNT; ++i)
+    {
+        if (STATIC_TABLE[i].name == name)
+        {
+            if (STATIC_TABLE[i].value == value)
+                return i + 1;
+            if (nameIndex == 0)
+                nameIndex = i + 1;
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        if (entries_[i].name == name)
+        {
+            if (entries_[i].value == value)
+                return STATIC_COUNT + 1 + i;
+            if (nameIndex == 0)
+                nameIndex = STATIC_COUNT + 1 + i;
+        }
+    }
+    return 0;
+}
+
+void HpackTable::Insert(std::string_view name, std::string_view value)
+{
+    size_t entrySize = name.size() + value.size() + ENTRY_OVERHEAD;
+    if (entrySize > maxSize_)
+    {
+        // 比整张表还大的条目会清空动态表且自身不被加入
+        entries_.clear();
+        size_ = 0;
+        return;
+    }
+    Evict_(entrySize);
+    entries_.push_front(HpackHeader{std::string(name), std::string(value)});
+    size_ += entrySize;
+}
+
+void HpackTable::Resize(size_t maxSize)
+{
+    maxSize_ = maxSize;
+    Evict_(0);
+}
+
+void HpackTable::Evict_(size_t incoming)
+{
+    while (!entries_.empty() && size_ + incoming > maxSize_)
+    {
+        size_ -= entries_.back().name.size() + entries_.back().value.size() + ENTRY_OVERHEAD;
+        entries_.pop_back();
+    }
+}
+
+// ---------------- HpackDecoder ----------------
+
+bool HpackDecoder::Decode(std::string_view block, std::vector<HpackHeader> &headers)
+{
+    size_t listSize = 0;
+    bool headerSeen = false;
+    while (!block.empty())
+    {
+        uint8_t b = static_cast<uint8_t>(block[0]);
+        uint64_t index;
+        HpackHeader header;
+        bool insert = false;
+
+        if (b & 0x80)
+        {
+            // 索引头部字段
+            if (!DecodeInt(block, 7, index))
+                return false;
+            const HpackHeader *entry = table_.Get(index);
+            if (entry == nullptr)
+                return false;
+            header = *entry;
+        }
+        else if ((b & 0xe0) == 0x20)
+        {
+            // 动态表大小更新，只能出现在头部块开头
+            if (headerSeen || !DecodeInt(block, 5, index) || index > limit_)
+                return false;
+            table_.Resize(index);
+            continue;
+        }
+        else
+        {
+            // 字面量：01 增量索引（6 位前缀），0000 不索引 / 0001 永不索引（4 位前缀）
+            insert = (b & 0xc0) == 0x40;
+            if (!DecodeInt(block, insert ? 6 : 4, index))
+                return false;
+            if (index != 0)
+            {
+                const HpackHeader *entry = table_.Get(index);
+                if (entry == nullptr)
+                    return false;
+                header.name = entry->name;
+            }
+            else if (!DecodeString(block, header.name))
+            {
+                return false;
+            }
+            if (!DecodeString(block, header.value))
+                return false;
+        }
+
+        headerSeen = true;
+        listSize += header.name.size() + header.value.size() + HpackTable::ENTRY_OVERHEAD;
+        if (listSize > MAX_HEADER_LIST)
+            return false;
+        if (insert)
+            table_.Insert(header.name, header.value);
+        headers.push_back(std::move(header));
+    }
+    return true;
+}
+
+// ---------------- HpackEncoder ----------------
+
+void HpackEncoder::SetPeerLimit(size_t limit)
+{
+    // 响应头种类有限，动态表用不到超过 4KB
+    size_t size = std::min<size_t>(limit, 4096);
+    if (size != table_.MaxSize())
+    {
+        table_.Resize(size);
+        pendingUpdate_ = true;
+    }
+}
+
+void HpackEncoder::FlushSizeUpdate_(std::string &out)
+{
+    if (pendingUpdate_)
+    {
+        EncodeInt(0x20, 5, table_.MaxSize(), out);
+        pendingUpdate_ = false;
+    }
+}
+
+void HpackEncoder::EncodeStatus(int code, std::string &out)
+{
+    char num[4] = {static_cast<char>('0' + code / 100 % 10), static_cast<char>('0' + code / 10 % 10),
+                   static_cast<char>('0' + code % 10), '\0'};
+    Encode(":status", std::string_view(num, 3), false, out);
+}
+
+void HpackEncoder::Encode(std::string_view name, std::string_view value, bool index, std::string &out)
+{
+    FlushSizeUpdate_(out);
+    size_t nameIndex;
+    size_t full = table_.Find(name, value, nameIndex);
+    if (full != 0)
+    {
+        EncodeInt(0x80, 7, full, out);
+        return;
+    }
+    if (index)
+    {
+        EncodeInt(0x40, 6, nameIndex, out);
+    }
+    else
+    {
+        EncodeInt(0x00, 4, nameIndex, out);
+    }
+    if (nameIndex == 0)
+    {
+        EncodeString(name, out);
+    }
+    EncodeString(value, out);
+    if (index)
+    {
+        table_.Insert(name, value);
+    }
+}
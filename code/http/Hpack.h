@@ -0,0 +1,90 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * HPACK 头部压缩（RFC 7541）
+ * 解码器完整实现静态表、动态表与 Huffman 解码；编码器只用于响应头，
+ * 重复出现的值（静态文件的 content-type 等）以增量索引加入动态表，之后同类资源的响应只需 1 字节。
+ */
+struct HpackHeader
+{
+    std::string name;
+    std::string value;
+};
+
+// 动态表：最新插入的条目索引最小
+class HpackTable
+{
+public:
+    static constexpr size_t STATIC_COUNT = 61;
+    static constexpr size_t ENTRY_OVERHEAD = 32;
+
+    // 按 HPACK 索引（从 1 开始，先静态表后动态表）取条目
+    const HpackHeader *Get(size_t index) const;
+
+    // 查找完全匹配的条目，返回索引；只匹配名字时写入 nameIndex；都没有时返回 0
+    size_t Find(std::string_view name, std::string_view value, size_t &nameIndex) const;
+
+    void Insert(std::string_view name, std::string_view value);
+    void Resize(size_t maxSize);
+    size_t MaxSize() const { return maxSize_; }
+
+private:
+    void Evict_(size_t incoming);
+
+    std::deque<HpackHeader> entries_;
+    size_t size_ = 0;
+    size_t maxSize_ = 4096;
+};
+
+class HpackDecoder
+{
+public:
+    // 解码一个完整的头部块，失败时（COMPRESSION_ERROR）返回 false
+    bool Decode(std::string_view block, std::vector<HpackHeader> &headers);
+
+    // 本端 SETTINGS_HEADER_TABLE_SIZE，对端的动态表大小更新不能超过它
+    void SetLimit(size_t limit) { limit_ = limit; }
+
+    // 解码后头部列表的上限（名字 + 值 + 32 字节开销）
+    static constexpr size_t MAX_HEADER_LIST = 64 * 1024;
+
+private:
+    HpackTable table_;
+    size_t limit_ = 4096;
+};
+
+class HpackEncoder
+{
+public:
+    // 对端 SETTINGS_HEADER_TABLE_SIZE 变化时调用，下一个头部块开头会带上大小更新
+    void SetPeerLimit(size_t limit);
+
+    // 编码 :status
+    void EncodeStatus(int code, std::string &out);
+
+    // 编码一个响应头；index 为 true 时值加入动态表
+    void Encode(std::string_view name, std::string_view value, bool index, std::string &out);
+
+private:
+    void FlushSizeUpdate_(std::string &out);
+
+    HpackTable table_;
+    bool pendingUpdate_ = false;
+};
+
+namespace Huffman
+{
+    // 解码失败（非法填充或 EOS）时返回 false
+    bool Decode(std::string_view in, std::string &out);
+    size_t EncodedLength(std::string_view in);
+    void Encode(std::string_view in, std::string &out);
+}
+
+#endif // HPACK_H
@@ -0,0 +1,950 @@
+#include "Http2Session.h"
+#include "HttpConn.h"
+#include "../webserver/RateLimiter.h"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    uint32_t ReadU32(const char *p)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+        return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | u[3];
+    }
+
+    void AppendU32(Buffer &out, uint32_t v)
+    {
+        char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8), static_cast<char>(v)};
+        out.append(b, 4);
+    }
+
+    // 去掉 PADDED 标志带来的填充，填充长度非法时返回 false
+    bool StripPadding(uint8_t flags, std::string_view &payload)
+    {
+        if ((flags & 0x8) == 0)
+            return true;
+        if (payload.empty())
+            return false;
+        size_t pad = static_cast<uint8_t>(payload[0]);
+        payload.remove_prefix(1);
+        if (pad > payload.size())
+            return false;
+        payload.remove_suffix(pad);
+        return true;
+    }
+
+    bool Base64UrlDecode(std::string_view in, std::string &out)
+    {
+        uint32_t acc = 0;
+        int bits = 0;
+        for (char ch : in)
+        {
+            int v;
+            if (ch >= 'A' && ch <= 'Z')
+                v = ch - 'A';
+            else if (ch >= 'a' && ch <= 'z')
+                v = ch - 'a' + 26;
+            else if (ch >= '0' && ch <= '9')
+                v = ch - '0' + 52;
+            else if (ch == '-' || ch == '+')
+                v = 62;
+            else if (ch == '_' || ch == '/')
+                v = 63;
+            else if (ch == '=')
+                break;
+            else
+                return false;
+            acc = (acc << 6) | v;
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                out.push_back(static_cast<char>(acc >> bits));
+                acc &= (1u << bits) - 1;
+            }
+        }
+        return true;
+    }
+}
+
+Http2Session::Http2Session(HttpConn &conn) : conn_(conn)
+{
+}
+
+Http2Session::~Http2Session() = default;
+
+void Http2Session::WriteFrameHeader_(Buffer &out, uint32_t length, uint8_t type, uint8_t flags, uint32_t streamId)
+{
+    char h[9] = {static_cast<char>(length >> 16), static_cast<char>(length >> 8), static_cast<char>(length),
+                 static_cast<char>(type), static_cast<char>(flags),
+                 static_cast<char>((streamId >> 24) & 0x7f), static_cast<char>(streamId >> 16),
+                 static_cast<char>(streamId >> 8), static_cast<char>(streamId)};
+    out.append(h, sizeof(h));
+}
+
+void Http2Session::SendSettings_(Buffer &out)
+{
+    // 关闭服务器推送、限制并发流，并放大接收窗口，免得 POST 请求体被 64KB 的默认窗口卡住
+    const uint16_t ids[] = {0x2, 0x3, 0x4};
+    const uint32_t values[] = {0, MAX_CONCURRENT_STREAMS, static_cast<uint32_t>(RECV_WINDOW)};
+    WriteFrameHeader_(out, 6 * 3, SETTINGS, 0, 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        char id[2] = {static_cast<char>(ids[i] >> 8), static_cast<char>(ids[i])};
+        out.append(id, 2);
+        AppendU32(out, values[i]);
+    }
+    WriteFrameHeader_(out, 4, WINDOW_UPDATE, 0, 0);
+    AppendU32(out, RECV_WINDOW - 65535);
+}
+
+void Http2Session::ResetStream_(uint32_t streamId, ErrorCode code, Buffer &out)
+{
+    WriteFrameHeader_(out, 4, RST_STREAM, 0, streamId);
+    AppendU32(out, code);
+    sending_.erase(std::remove(sending_.begin(), sending_.end(), streamId), sending_.end());
+    streams_.erase(streamId);
+}
+
+bool Http2Session::SendGoaway_(ErrorCode code, Buffer &out)
+{
+    if (!goawaySent_)
+    {
+        WriteFrameHeader_(out, 8, GOAWAY, 0, 0);
+        AppendU32(out, lastStreamId_);
+        AppendU32(out, code);
+        goawaySent_ = true;
+        if (code != NO_ERROR)
+        {
+            LOG_DEBUG("h2 connection fd %d closed with error 0x%x", conn_.GetFd(), code);
+        }
+    }
+    return false;
+}
+
+void Http2Session::Drain(Buffer &out)
+{
+    if (!goawaySent_ && !draining_)
+    {
+        WriteFrameHeader_(out, 8, GOAWAY, 0, 0);
+        AppendU32(out, lastStreamId_);
+        AppendU32(out, NO_ERROR);
+        draining_ = true;
+    }
+}
+
+bool Http2Session::Upgrade(std::string_view settings, Buffer &out)
+{
+    std::string payload;
+    if (!Base64UrlDecode(settings, payload) || ApplySettings_(payload) != NO_ERROR)
+    {
+        return false;
+    }
+
+    // 101 即是对 HTTP2-Settings 的确认，随后必须先发服务端的 SETTINGS
+    out.append("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+    SendSettings_(out);
+
+    // 升级请求本身成为已半关闭（remote）的 1 号流
+    auto stream = std::make_unique<Stream>();
+    stream->id = 1;
+    stream->sendWindow = peerInitialWindow_;
+    stream->remoteClosed = true;
+    stream->method.assign(conn_.state_->request.method());
+    stream->startNs = Metrics::NowNs();
+    lastStreamId_ = 1;
+    Stream &ref = *stream;
+    streams_[1] = std::move(stream);
+    Respond_(ref, conn_.state_->request, true, out);
+    return true;
+}
+
+void Http2Session::OnData(Buffer &in, Buffer &out)
+{
+    if (goawaySent_)
+    {
+        in.clear();
+        return;
+    }
+
+    if (!prefaceReceived_)
+    {
+        size_t n = std::min(in.readableBytes(), PREFACE.size());
+        if (PREFACE.compare(0, n, std::string_view(in.peek(), n)) != 0)
+        {
+            SendGoaway_(PROTOCOL_ERROR, out);
+            in.clear();
+            return;
+        }
+        if (n < PREFACE.size())
+        {
+            return; // 前言还没收全
+        }
+        in.skip(PREFACE.size());
+        prefaceReceived_ = true;
+    }
+
+    while (in.readableBytes() >= 9)
+    {
+        const unsigned char *h = reinterpret_cast<const unsigned char *>(in.peek());
+        uint32_t length = (uint32_t(h[0]) << 16) | (uint32_t(h[1]) << 8) | h[2];
+        if (length > MAX_FRAME_SIZE)
+        {
+            SendGoaway_(FRAME_SIZE_ERROR, out);
+            in.clear();
+            return;
+        }
+        if (in.readableBytes() < 9 + length)
+        {
+            break; // 帧不完整，等待更多数据
+        }
+        uint8_t type = h[3];
+        uint8_t flags = h[4];
+        uint32_t streamId = ReadU32(in.peek() + 5) & 0x7fffffff;
+        bool ok = OnFrame_(type, flags, streamId, std::string_view(in.peek() + 9, length), out);
+        in.skip(9 + length);
+        if (!ok)
+        {
+            in.clear();
+            return;
+        }
+    }
+}
+
+bool Http2Session::OnFrame_(uint8_t type, uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out)
+{
+    // 连接前言之后的第一帧必须是 SETTINGS；头部块未结束时只能出现同一个流的 CONTINUATION
+    if (!settingsReceived_ && type != SETTINGS)
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+    if (continuationStream_ != 0 && (type != CONTINUATION || streamId != continuationStream_))
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+
+    switch (type)
+    {
+    case DATA:
+        return OnData_(flags, streamId, payload, out);
+
+    case HEADERS:
+        return OnHeaders_(flags, streamId, payload, out);
+
+    case CONTINUATION:
+        if (continuationStream_ == 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        if (headerBlock_.size() + payload.size() > MAX_HEADER_BLOCK)
+        {
+            return SendGoaway_(ENHANCE_YOUR_CALM, out);
+        }
+        headerBlock_.append(payload.data(), payload.size());
+        if (flags & FLAG_END_HEADERS)
+        {
+            continuationStream_ = 0;
+            return OnHeaderBlock_(streamId, continuationEndStream_, out);
+        }
+        return true;
+
+    case PRIORITY:
+    {
+        if (streamId == 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        if (payload.size() != 5)
+        {
+            ResetStream_(streamId, FRAME_SIZE_ERROR, out);
+            return true;
+        }
+        uint32_t parent;
+        int weight;
+        ParsePriority_(payload, parent, weight);
+        if (parent == streamId)
+        {
+            ResetStream_(streamId, PROTOCOL_ERROR, out);
+            return true;
+        }
+        auto it = streams_.find(streamId);
+        if (it != streams_.end())
+        {
+            it->second->parent = parent;
+            it->second->weight = weight;
+        }
+        return true;
+    }
+
+    case RST_STREAM:
+        if (streamId == 0 || streamId > lastStreamId_)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        if (payload.size() != 4)
+        {
+            return SendGoaway_(FRAME_SIZE_ERROR, out);
+        }
+        sending_.erase(std::remove(sending_.begin(), sending_.end(), streamId), sending_.end());
+        streams_.erase(streamId);
+        return true;
+
+    case SETTINGS:
+        if (streamId != 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        return OnSettings_(flags, payload, out);
+
+    case PUSH_PROMISE:
+        return SendGoaway_(PROTOCOL_ERROR, out); // 客户端不能推送
+
+    case PING:
+        if (streamId != 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        if (payload.size() != 8)
+        {
+            return SendGoaway_(FRAME_SIZE_ERROR, out);
+        }
+        if ((flags & FLAG_ACK) == 0)
+        {
+            WriteFrameHeader_(out, 8, PING, FLAG_ACK, 0);
+            out.append(payload);
+        }
+        return true;
+
+    case GOAWAY:
+        if (streamId != 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        goawayReceived_ = true;
+        return true;
+
+    case WINDOW_UPDATE:
+        return OnWindowUpdate_(streamId, payload, out);
+
+    default:
+        return true; // 忽略未知类型的帧
+    }
+}
+
+void Http2Session::ParsePriority_(std::string_view spec, uint32_t &parent, int &weight)
+{
+    parent = ReadU32(spec.data()) & 0x7fffffff;
+    weight = static_cast<uint8_t>(spec[4]) + 1;
+}
+
+bool Http2Session::OnHeaders_(uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out)
+{
+    if (streamId == 0 || (streamId & 1) == 0)
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+    if (!StripPadding(flags, payload))
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+    blockParent_ = 0;
+    blockWeight_ = 16;
+    if (flags & FLAG_PRIORITY)
+    {
+        if (payload.size() < 5)
+        {
+            return SendGoaway_(FRAME_SIZE_ERROR, out);
+        }
+        ParsePriority_(payload, blockParent_, blockWeight_);
+        payload.remove_prefix(5);
+    }
+
+    headerBlock_.assign(payload.data(), payload.size());
+    if (flags & FLAG_END_HEADERS)
+    {
+        return OnHeaderBlock_(streamId, flags & FLAG_END_STREAM, out);
+    }
+    continuationStream_ = streamId;
+    continuationEndStream_ = flags & FLAG_END_STREAM;
+    return true;
+}
+
+bool Http2Session::OnHeaderBlock_(uint32_t streamId, bool endStream, Buffer &out)
+{
+    // 即使随后要拒绝这个流也必须先解码，否则两端的动态表会失去同步
+    std::vector<HpackHeader> headers;
+    bool decoded = decoder_.Decode(headerBlock_, headers);
+    headerBlock_.clear();
+    if (!decoded)
+    {
+        return SendGoaway_(COMPRESSION_ERROR, out);
+    }
+
+    auto it = streams_.find(streamId);
+    if (it != streams_.end())
+    {
+        // 已打开的流上的第二个头部块只能是带 END_STREAM 的 trailer
+        Stream &stream = *it->second;
+        if (stream.remoteClosed)
+        {
+            ResetStream_(streamId, STREAM_CLOSED, out);
+        }
+        else if (!endStream)
+        {
+            ResetStream_(streamId, PROTOCOL_ERROR, out);
+        }
+        else
+        {
+            stream.remoteClosed = true;
+            Dispatch_(stream, out);
+        }
+        return true;
+    }
+    if (streamId <= lastStreamId_)
+    {
+        return SendGoaway_(STREAM_CLOSED, out);
+    }
+    lastStreamId_ = streamId;
+
+    if (goawayReceived_ || draining_ || streams_.size() >= MAX_CONCURRENT_STREAMS)
+    {
+        ResetStream_(streamId, REFUSED_STREAM, out);
+        return true;
+    }
+    if (blockParent_ == streamId)
+    {
+        ResetStream_(streamId, PROTOCOL_ERROR, out);
+        return true;
+    }
+
+    auto stream = std::make_unique<Stream>();
+    stream->id = streamId;
+    stream->sendWindow = peerInitialWindow_;
+    stream->parent = blockParent_;
+    stream->weight = blockWeight_;
+    stream->remoteClosed = endStream;
+    stream->startNs = Metrics::NowNs();
+
+    // 伪头部必须在普通头部之前，头部名必须是小写，不能带连接级头部
+    bool malformed = false;
+    bool regularSeen = false;
+    for (const HpackHeader &h : headers)
+    {
+        if (!h.name.empty() && h.name[0] == ':')
+        {
+            if (regularSeen)
+                malformed = true;
+            else if (h.name == ":method")
+                stream->method = h.value;
+            else if (h.name == ":path")
+                stream->path = h.value;
+            else if (h.name != ":scheme" && h.name != ":authority")
+                malformed = true;
+            continue;
+        }
+        regularSeen = true;
+        if (std::any_of(h.name.begin(), h.name.end(), [](char ch)
+                        { return std::isupper(static_cast<unsigned char>(ch)); }) ||
+            h.name == "connection" || h.name == "transfer-encoding")
+        {
+            malformed = true;
+        }
+        else if (h.name == "content-type")
+        {
+            stream->contentType = h.value;
+        }
+        else if (h.name == "accept-encoding")
+        {
+            stream->acceptEncoding = h.value;
+        }
+        else if (h.name == "if-none-match")
+        {
+            stream->ifNoneMatch = h.value;
+        }
+        else if (h.name == "cookie")
+        {
+            // HTTP/2 允许把 Cookie 拆成多个字段，合并回一行（RFC 9113 8.2.3）
+            if (!stream->cookie.empty())
+                stream->cookie += "; ";
+            stream->cookie += h.value;
+        }
+    }
+    if (malformed || stream->method.empty() || stream->path.empty())
+    {
+        ResetStream_(streamId, PROTOCOL_ERROR, out);
+        return true;
+    }
+    stream->head = stream->method == "HEAD";
+
+    Stream &ref = *stream;
+    streams_[streamId] = std::move(stream);
+    if (endStream)
+    {
+        Dispatch_(ref, out);
+    }
+    return true;
+}
+
+bool Http2Session::OnData_(uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out)
+{
+    if (streamId == 0)
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+    uint32_t flowLen = static_cast<uint32_t>(payload.size()); // 填充也计入流量控制
+    if (!StripPadding(flags, payload))
+    {
+        return SendGoaway_(PROTOCOL_ERROR, out);
+    }
+
+    // 数据立即交给请求体，接收窗口随即归还
+    if (flowLen > 0)
+    {
+        WriteFrameHeader_(out, 4, WINDOW_UPDATE, 0, 0);
+        AppendU32(out, flowLen);
+    }
+
+    auto it = streams_.find(streamId);
+    if (it == streams_.end() || it->second->remoteClosed)
+    {
+        if (streamId > lastStreamId_)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out); // 空闲流上不能有 DATA
+        }
+        ResetStream_(streamId, STREAM_CLOSED, out);
+        return true;
+    }
+
+    Stream &stream = *it->second;
+    if (stream.body.size() + payload.size() > MAX_BODY_SIZE)
+    {
+        ResetStream_(streamId, ENHANCE_YOUR_CALM, out);
+        return true;
+    }
+    stream.body.append(payload.data(), payload.size());
+    if (flags & FLAG_END_STREAM)
+    {
+        stream.remoteClosed = true;
+        Dispatch_(stream, out);
+    }
+    else if (flowLen > 0)
+    {
+        WriteFrameHeader_(out, 4, WINDOW_UPDATE, 0, streamId);
+        AppendU32(out, flowLen);
+    }
+    return true;
+}
+
+Http2Session::ErrorCode Http2Session::ApplySettings_(std::string_view payload)
+{
+    if (payload.size() % 6 != 0)
+    {
+        return FRAME_SIZE_ERROR;
+    }
+    for (size_t off = 0; off < payload.size(); off += 6)
+    {
+        uint16_t id = (static_cast<uint8_t>(payload[off]) << 8) | static_cast<uint8_t>(payload[off + 1]);
+        uint32_t value = ReadU32(payload.data() + off + 2);
+        switch (id)
+        {
+        case 0x1: // HEADER_TABLE_SIZE
+            encoder_.SetPeerLimit(value);
+            break;
+        case 0x2: // ENABLE_PUSH
+            if (value > 1)
+                return PROTOCOL_ERROR;
+            break;
+        case 0x4: // INITIAL_WINDOW_SIZE：按差值调整所有已打开流的窗口
+        {
+            if (value > MAX_WINDOW)
+                return FLOW_CONTROL_ERROR;
+            int64_t delta = static_cast<int64_t>(value) - peerInitialWindow_;
+            for (auto &entry : streams_)
+            {
+                entry.second->sendWindow += delta;
+                if (entry.second->sendWindow > MAX_WINDOW)
+                    return FLOW_CONTROL_ERROR;
+            }
+            peerInitialWindow_ = value;
+            break;
+        }
+        case 0x5: // MAX_FRAME_SIZE
+            if (value < 16384 || value > 16777215)
+                return PROTOCOL_ERROR;
+            peerMaxFrame_ = value;
+            break;
+        default: // MAX_CONCURRENT_STREAMS、MAX_HEADER_LIST_SIZE 与未知设置：服务端不需要
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+bool Http2Session::OnSettings_(uint8_t flags, std::string_view payload, Buffer &out)
+{
+    if (flags & FLAG_ACK)
+    {
+        return payload.empty() ? true : SendGoaway_(FRAME_SIZE_ERROR, out);
+    }
+    ErrorCode err = ApplySettings_(payload);
+    if (err != NO_ERROR)
+    {
+        return SendGoaway_(err, out);
+    }
+    if (!settingsReceived_)
+    {
+        settingsReceived_ = true;
+        if (lastStreamId_ == 0)
+        {
+            SendSettings_(out); // prior knowledge：服务端前言（升级时已在 101 之后发送）
+        }
+    }
+    WriteFrameHeader_(out, 0, SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+bool Http2Session::OnWindowUpdate_(uint32_t streamId, std::string_view payload, Buffer &out)
+{
+    if (payload.size() != 4)
+    {
+        return SendGoaway_(FRAME_SIZE_ERROR, out);
+    }
+    uint32_t increment = ReadU32(payload.data()) & 0x7fffffff;
+    if (streamId == 0)
+    {
+        if (increment == 0)
+        {
+            return SendGoaway_(PROTOCOL_ERROR, out);
+        }
+        connSendWindow_ += increment;
+        return connSendWindow_ <= MAX_WINDOW ? true : SendGoaway_(FLOW_CONTROL_ERROR, out);
+    }
+
+    auto it = streams_.find(streamId);
+    if (it == streams_.end())
+    {
+        return streamId <= lastStreamId_ ? true : SendGoaway_(PROTOCOL_ERROR, out);
+    }
+    if (increment == 0)
+    {
+        ResetStream_(streamId, PROTOCOL_ERROR, out);
+        return true;
+    }
+    it->second->sendWindow += increment;
+    if (it->second->sendWindow > MAX_WINDOW)
+    {
+        ResetStream_(streamId, FLOW_CONTROL_ERROR, out);
+    }
+    return true;
+}
+
+// 把流还原成等价的 HTTP/1.1 请求交给现有解析器，别名、路由和表单解析与 HTTP/1.1 完全一致
+void Http2Session::Dispatch_(Stream &stream, Buffer &out)
+{
+    Buffer text(256 + stream.body.size());
+    text.append(stream.head ? std::string_view("GET") : std::string_view(stream.method));
+    text.append(" ");
+    text.append(stream.path);
+    text.append(" HTTP/1.1\r\n");
+    if (stream.method == "POST")
+    {
+        if (!stream.contentType.empty())
+        {
+            text.append("Content-Type: ");
+            text.append(stream.contentType);
+            text.append("\r\n");
+        }
+        text.append("Content-Length: ");
+        text.append(std::to_string(stream.body.size()));
+        text.append("\r\n");
+    }
+    if (!stream.acceptEncoding.empty())
+    {
+        text.append("Accept-Encoding: ");
+        text.append(stream.acceptEncoding);
+        text.append("\r\n");
+    }
+    if (!stream.ifNoneMatch.empty())
+    {
+        text.append("If-None-Match: ");
+        text.append(stream.ifNoneMatch);
+        text.append("\r\n");
+    }
+    if (!stream.cookie.empty())
+    {
+        text.append("Cookie: ");
+        text.append(stream.cookie);
+        text.append("\r\n");
+    }
+    text.append("\r\n");
+    text.append(stream.body);
+    std::string().swap(stream.body);
+
+    // 登录/注册可能挂起，它们的请求不能放在会被后续流复用的连接请求中
+    if (stream.method == "POST")
+    {
+        stream.request = std::make_unique<HttpRequest>();
+    }
+    HttpRequest &request = stream.request ? *stream.request : conn_.state_->request;
+    request.Init();
+    bool parsed = request.parse(text) && request.IsFinished();
+    Respond_(stream, request, parsed, out);
+}
+
+void Http2Session::Respond_(Stream &stream, HttpRequest &request, bool parsed, Buffer &out)
+{
+    ThreadMetrics &metrics = Metrics::Local();
+    HttpResponse &response = stream.response;
+
+    if (!parsed)
+    {
+        response.Init(HttpConn::srcDir, request.path(), true, 400);
+    }
+    else if (HttpConn::rateLimiter != nullptr &&
+             !HttpConn::rateLimiter->Allow(conn_.addr_.sin_addr.s_addr, request.NeedsDb() ? RateLimiter::DB : RateLimiter::STATIC))
+    {
+        CounterAdd(metrics.rateLimited);
+        response.InitContent("text/html", "<html><body><h1>Too Many Requests</h1></body></html>", true, 429);
+        response.SetRetryAfter(1);
+    }
+    else if (request.AsyncRoute() != nullptr)
+    {
+        // 协程处理函数直接操作 HTTP/1.1 连接，暂不支持在 HTTP/2 流上运行
+        response.InitContent("text/html", "<html><body><h1>Internal Server Error</h1></body></html>", true, 500);
+    }
+    else if ((request.NeedsKdf() || request.NeedsDb()) && (HttpConn::kdfPool || HttpConn::dbLane))
+    {
+        // 不在当前工作线程上算哈希、访问数据库：挂起该流，由 HttpConn 按步骤投递到对应线程池，
+        // 与 HTTP/1.1 共用排队上限和按客户端的公平性
+        parked_.push_back(stream.id);
+        return;
+    }
+    else
+    {
+        request.RunPending(); // 对应的线程池都关闭时在当前线程完成
+        Serve_(stream, request);
+    }
+    Send_(stream, request, out);
+}
+
+void Http2Session::Serve_(Stream &stream, HttpRequest &request)
+{
+    HttpResponse &response = stream.response;
+    if (!HttpConn::metricsPath.empty() && request.path() == HttpConn::metricsPath)
+    {
+        response.InitContent("text/plain; version=0.0.4", Metrics::Instance()->Render(), true);
+    }
+    else
+    {
+        response.Init(HttpConn::srcDir, request.path(), true, 200);
+        response.SetCookie(request.SetCookie());
+        std::string_view ifNoneMatch;
+        request.FindHeader("If-None-Match", ifNoneMatch);
+        response.Negotiate(request.AcceptsGzip(), ifNoneMatch);
+    }
+}
+
+HttpRequest *Http2Session::Parked()
+{
+    // 挂起期间可能已被 RST_STREAM 或 GOAWAY 移除
+    while (!parked_.empty())
+    {
+        auto it = streams_.find(parked_.front());
+        if (it != streams_.end() && it->second->request)
+        {
+            return it->second->request.get();
+        }
+        parked_.pop_front();
+    }
+    return nullptr;
+}
+
+void Http2Session::Resume(Buffer &out, int rejectCode)
+{
+    HttpRequest *request = Parked();
+    if (request == nullptr)
+    {
+        return;
+    }
+    Stream &stream = *streams_[parked_.front()];
+    parked_.pop_front();
+    if (rejectCode != 0)
+    {
+        stream.response.InitContent("text/html", "<html><body><h1>Service Unavailable</h1></body></html>", true, rejectCode);
+        stream.response.SetRetryAfter(1);
+    }
+    else
+    {
+        Serve_(stream, *request);
+    }
+    Send_(stream, *request, out);
+}
+
+void Http2Session::Send_(Stream &stream, HttpRequest &request, Buffer &out)
+{
+    HttpResponse &response = stream.response;
+    stream.path.assign(request.path());
+
+    // 生成 HTTP/1 形式的头部再转换；错误页的内容由 HttpResponse 直接写在头部之后
+    Buffer head(512);
+    response.MakeResponse(head);
+    stream.code = response.Code();
+    Metrics::Local().CountResponse(stream.code);
+    stream.request.reset(); // 头部已生成，不再引用请求
+
+    std::string_view text(head.peek(), head.readableBytes());
+    size_t end = text.find("\r\n\r\n");
+    stream.inlineBody.assign(text.substr(end + 4));
+    if (!stream.inlineBody.empty())
+    {
+        stream.data = stream.inlineBody.data();
+        stream.remaining = stream.inlineBody.size();
+    }
+    else
+    {
+        stream.data = response.Body();
+        stream.remaining = response.BodyLen();
+    }
+    if (stream.head)
+    {
+        stream.remaining = 0;
+    }
+
+    WriteHeaders_(stream, text.substr(0, end + 2), out);
+    if (stream.remaining > 0)
+    {
+        sending_.push_back(stream.id);
+    }
+    else
+    {
+        Finish_(stream);
+    }
+}
+
+void Http2Session::WriteHeaders_(Stream &stream, std::string_view head, Buffer &out)
+{
+    std::string block;
+    encoder_.EncodeStatus(stream.code, block);
+
+    head.remove_prefix(head.find("\r\n") + 2); // 跳过状态行
+    std::string name;
+    while (!head.empty())
+    {
+        size_t eol = head.find("\r\n");
+        std::string_view line = head.substr(0, eol);
+        head.remove_prefix(eol + 2);
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        name.assign(line.substr(0, colon));
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch)
+                       { return std::tolower(ch); });
+        if (name == "connection" || name == "keep-alive" || name == "transfer-encoding")
+            continue;
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && value.front() == ' ')
+            value.remove_prefix(1);
+        // 静态资源的 content-type 只有几种，加入动态表后同类资源的响应只需一个字节
+        encoder_.Encode(name, value, name == "content-type", block);
+    }
+
+    // 超过对端最大帧长的头部块拆成 HEADERS + CONTINUATION
+    uint8_t endStream = stream.remaining == 0 ? FLAG_END_STREAM : 0;
+    size_t off = 0;
+    do
+    {
+        size_t n = std::min<size_t>(block.size() - off, peerMaxFrame_);
+        bool last = off + n == block.size();
+        WriteFrameHeader_(out, n, off == 0 ? HEADERS : CONTINUATION,
+                          (off == 0 ? endStream : 0) | (last ? FLAG_END_HEADERS : 0), stream.id);
+        out.append(block.data() + off, n);
+        off += n;
+    } while (off < block.size());
+}
+
+void Http2Session::Finish_(Stream &stream)
+{
+    if (Log::Instance()->AccessEnabled())
+    {
+        Log::Instance()->Access(conn_.addr_.sin_addr.s_addr, ntohs(conn_.addr_.sin_port), stream.method, stream.path,
+                                stream.code, stream.bytes, Metrics::NowNs() - stream.startNs);
+    }
+    streams_.erase(stream.id);
+}
+
+bool Http2Session::Sendable_(const Stream &stream) const
+{
+    if (stream.remaining == 0 || stream.sendWindow <= 0)
+    {
+        return false;
+    }
+    // 父流还能发送时先让给父流；依赖链最多看 8 层，防止对端构造的环
+    uint32_t parent = stream.parent;
+    for (int depth = 0; parent != 0 && depth < 8; ++depth)
+    {
+        auto it = streams_.find(parent);
+        if (it == streams_.end())
+        {
+            break;
+        }
+        const Stream &p = *it->second;
+        if (p.remaining > 0 && p.sendWindow > 0)
+        {
+            return false;
+        }
+        parent = p.parent;
+    }
+    return true;
+}
+
+void Http2Session::Pump(Buffer &out)
+{
+    // 加权轮转：每轮每个可发送的流最多发送 weight KB，权重 16 的默认流正好一帧
+    bool progress = true;
+    while (progress && !goawaySent_ && connSendWindow_ > 0 && !sending_.empty() &&
+           out.readableBytes() < OUTPUT_BUDGET)
+    {
+        progress = false;
+        for (uint32_t id : sending_)
+        {
+            Stream &stream = *streams_[id];
+            if (!Sendable_(stream))
+            {
+                continue;
+            }
+            int64_t allowance = static_cast<int64_t>(stream.weight) * 1024;
+            while (allowance > 0 && stream.remaining > 0 && stream.sendWindow > 0 && connSendWindow_ > 0 &&
+                   out.readableBytes() < OUTPUT_BUDGET)
+            {
+                size_t n = std::min<size_t>({stream.remaining, static_cast<size_t>(stream.sendWindow),
+                                             static_cast<size_t>(connSendWindow_), peerMaxFrame_,
+                                             static_cast<size_t>(allowance)});
+                WriteFrameHeader_(out, n, DATA, n == stream.remaining ? FLAG_END_STREAM : 0, id);
+                out.append(stream.data, n);
+                stream.data += n;
+                stream.remaining -= n;
+                stream.sendWindow -= n;
+                stream.bytes += n;
+                connSendWindow_ -= n;
+                allowance -= n;
+                progress = true;
+            }
+        }
+
+        // 响应体发送完的流结束
+        for (size_t i = 0; i < sending_.size();)
+        {
+            Stream &stream = *streams_[sending_[i]];
+            if (stream.remaining == 0)
+            {
+                sending_.erase(sending_.begin() + i);
+                Finish_(stream);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef HTTP2_SESSION_H
+#define HTTP2_SESSION_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../buffer/Buffer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Hpack.h"
+
+class HttpConn;
+
+/*
+ * 一个 HTTP/2 连接（RFC 9113）
+ * 以明文 h2c 运行：客户端直接发送连接前言（prior knowledge），或由 HTTP/1.1 的 Upgrade: h2c 切换过来。
+ * 帧从 HttpConn 的读缓冲区解析，待发送的帧追加到它的写缓冲区，仍由原有的读写事件驱动。
+ * 每个请求流在解析完后复用 HttpConn 的 HttpRequest 做路由（别名、登录/注册），响应由 HttpResponse 生成，
+ * 再把 HTTP/1 头部转换成 HPACK 编码的 HEADERS 帧，响应体按流量控制窗口和流优先级切成 DATA 帧。
+ * 登录/注册与 HTTP/1.1 一样交给口令哈希线程池和数据库通道：这样的流带着自己的 HttpRequest 挂起，
+ * 由 HttpConn 逐步投递，全部完成后经 Resume() 生成响应。
+ */
+class Http2Session
+{
+public:
+    explicit Http2Session(HttpConn &conn);
+    ~Http2Session();
+
+    // 客户端连接前言
+    static constexpr std::string_view PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    // 由 HTTP/1.1 升级而来：settings 为 HTTP2-Settings 头部（base64url 编码的 SETTINGS 载荷），
+    // 连接上已解析完的请求成为 1 号流。101 响应之后的服务端 SETTINGS 与 1 号流的响应追加到 out
+    bool Upgrade(std::string_view settings, Buffer &out);
+
+    // 处理 in 中的完整帧，需要发送的帧追加到 out
+    void OnData(Buffer &in, Buffer &out);
+
+    // 在发送预算内按优先级为各流生成 DATA 帧
+    void Pump(Buffer &out);
+
+    // 服务器排空：发送 GOAWAY(NO_ERROR)，已开始的流继续完成，之后的新流被拒绝
+    void Drain(Buffer &out);
+
+    // 挂起的流中最早的一个的请求（等待口令哈希或数据库步骤），没有时返回 nullptr
+    HttpRequest *Parked();
+
+    // 为最早挂起的流生成响应并移出挂起队列；rejectCode 非 0 时回对应的拒绝响应（503）
+    void Resume(Buffer &out, int rejectCode);
+
+    // 没有未完成的流（响应发完的流即被移除）
+    bool Idle() const { return streams_.empty(); }
+
+    // 连接即将关闭：已因错误发送 GOAWAY，或任意一方发起了正常关闭且没有未完成的流
+    bool Closing() const { return goawaySent_ || ((goawayReceived_ || draining_) && streams_.empty()); }
+
+private:
+    enum FrameType : uint8_t
+    {
+        DATA = 0x0,
+        HEADERS = 0x1,
+        PRIORITY = 0x2,
+        RST_STREAM = 0x3,
+        SETTINGS = 0x4,
+        PUSH_PROMISE = 0x5,
+        PING = 0x6,
+        GOAWAY = 0x7,
+        WINDOW_UPDATE = 0x8,
+        CONTINUATION = 0x9,
+    };
+
+    enum ErrorCode : uint32_t
+    {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        COMPRESSION_ERROR = 0x9,
+        ENHANCE_YOUR_CALM = 0xb,
+    };
+
+    static constexpr uint8_t FLAG_END_STREAM = 0x1;
+    static constexpr uint8_t FLAG_ACK = 0x1;
+    static constexpr uint8_t FLAG_END_HEADERS = 0x4;
+    static constexpr uint8_t FLAG_PADDED = 0x8;
+    static constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+    static constexpr uint32_t MAX_FRAME_SIZE = 16384;        // 本端接收的最大帧（协议默认值）
+    static constexpr uint32_t MAX_CONCURRENT_STREAMS = 128;  // 本端允许的并发流
+    static constexpr int32_t RECV_WINDOW = 1 << 20;          // 本端为连接和每个流通告的接收窗口
+    static constexpr size_t MAX_BODY_SIZE = 1 << 20;         // 请求体上限，与 HTTP/1.1 一致
+    static constexpr size_t MAX_HEADER_BLOCK = 64 * 1024;    // HEADERS + CONTINUATION 累计上限
+    static constexpr size_t OUTPUT_BUDGET = 256 * 1024;      // 一次写事件最多生成的输出
+    static constexpr int64_t MAX_WINDOW = 0x7fffffff;
+
+    struct Stream
+    {
+        uint32_t id = 0;
+        int64_t sendWindow = 0; // 对端给这个流的发送窗口，可因 SETTINGS 变为负数
+        bool remoteClosed = false;
+        bool head = false;
+
+        // 请求
+        std::string method, path, contentType;
+        std::string acceptEncoding, ifNoneMatch; // 内嵌资源的协商头部
+        std::string cookie;                      // 会话令牌
+        std::string body;
+        std::unique_ptr<HttpRequest> request; // POST 请求单独持有，挂起期间不被后续的流覆盖
+
+        // 响应：HttpResponse 持有文件映射，错误页等内联内容放在 inlineBody
+        HttpResponse response;
+        std::string inlineBody;
+        const char *data = nullptr;
+        size_t remaining = 0;
+        int code = 0;
+        size_t bytes = 0;
+        uint64_t startNs = 0;
+
+        // 优先级：依赖的父流和权重（1-256）
+        uint32_t parent = 0;
+        int weight = 16;
+    };
+
+    // 帧处理；返回 false 表示已发送 GOAWAY
+    bool OnFrame_(uint8_t type, uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out);
+    bool OnHeaders_(uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out);
+    bool OnHeaderBlock_(uint32_t streamId, bool endStream, Buffer &out);
+    bool OnData_(uint8_t flags, uint32_t streamId, std::string_view payload, Buffer &out);
+    bool OnSettings_(uint8_t flags, std::string_view payload, Buffer &out);
+    ErrorCode ApplySettings_(std::string_view payload);
+    bool OnWindowUpdate_(uint32_t streamId, std::string_view payload, Buffer &out);
+    static void ParsePriority_(std::string_view spec, uint32_t &parent, int &weight);
+
+    // 请求完整后路由并生成响应头
+    void Dispatch_(Stream &stream, Buffer &out);
+    void Respond_(Stream &stream, HttpRequest &request, bool parsed, Buffer &out);
+    void Serve_(Stream &stream, HttpRequest &request); // 按路由结果准备正常响应
+    void Send_(Stream &stream, HttpRequest &request, Buffer &out); // 发出响应头，响应体交给 Pump
+    void WriteHeaders_(Stream &stream, std::string_view head, Buffer &out);
+    void Finish_(Stream &stream);
+
+    // 流是否可以发送 DATA：还有数据、窗口未耗尽、父流已发送完毕
+    bool Sendable_(const Stream &stream) const;
+
+    void SendSettings_(Buffer &out);
+    void ResetStream_(uint32_t streamId, ErrorCode code, Buffer &out); // 发送 RST_STREAM 并丢弃该流
+    bool SendGoaway_(ErrorCode code, Buffer &out);
+    static void WriteFrameHeader_(Buffer &out, uint32_t length, uint8_t type, uint8_t flags, uint32_t streamId);
+
+    HttpConn &conn_;
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+
+    std::unordered_map<uint32_t, std::unique_ptr<Stream>> streams_;
+    std::vector<uint32_t> sending_; // 有响应体待发送的流，按到达顺序
+    std::deque<uint32_t> parked_;   // 等待口令哈希或数据库步骤的流，按到达顺序
+
+    bool prefaceReceived_ = false;
+    bool settingsReceived_ = false;
+    bool goawaySent_ = false;
+    bool goawayReceived_ = false;
+    bool draining_ = false; // 已发送 NO_ERROR 的 GOAWAY，等待现有的流完成
+    uint32_t lastStreamId_ = 0;
+
+    // 跨 CONTINUATION 帧累积的头部块
+    uint32_t continuationStream_ = 0;
+    bool continuationEndStream_ = false;
+    std::string headerBlock_;
+    uint32_t blockParent_ = 0; // HEADERS 帧携带的优先级
+    int blockWeight_ = 16;
+
+    // 流量控制
+    int64_t connSendWindow_ = 65535;
+    int64_t peerInitialWindow_ = 65535;
+    uint32_t peerMaxFrame_ = 16384;
+};
+
+#endif // HTTP2_SESSION_H
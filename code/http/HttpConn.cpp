@@ -1,12 +1,39 @@
 #include "HttpConn.h"
+#include "../webserver/RateLimiter.h"
+#include "../webserver/Tls.h"
+#include "CoContext.h"
+#include "Http2Session.h"
+#include "ConnState.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <sys/resource.h>
+#include <openssl/err.h>
 
 // 静态变量初始化
-const char *HttpConn::srcDir = "../resources";
+std::string HttpConn::srcDir = "../resources";
+std::string HttpConn::metricsPath = "/metrics";
 std::atomic<int> HttpConn::userCount = 0;
+bool HttpConn::corkResponses = false;
+bool HttpConn::dbLane = false;
+bool HttpConn::kdfPool = false;
+size_t HttpConn::zeroCopyThreshold = 0;
+RateLimiter *HttpConn::rateLimiter = nullptr;
+TlsContext *HttpConn::tls = nullptr;
+std::unique_ptr<std::atomic<bool>[]> HttpConn::idleFds;
+size_t HttpConn::idleFdCount = 0;
 
 HttpConn::HttpConn()
-    : fd_(-1), isClose_(false), iovCnt_(0), isWriting_(false) {}
+    : isWriting_(false), fd_(-1), isClose_(false), iovCnt_(0),
+      acceptNs_(0), requestNs_(0), writeStartNs_(0), responseBytes_(0), firstByteSent_(false), corked_(false), pendingDb_(false), pendingKdf_(false), pendingAsync_(false),
+      zcNextId_(0), zcBodyPinned_(false), zcCopied_(false), lingering_(false),
+      ssl_(nullptr), handshaking_(false), ktlsSend_(false), state_(nullptr),
+      enqueueTsc_(0), dequeueTsc_(0)
+{
+}
 
 HttpConn::~HttpConn()
 {
@@ -17,10 +44,30 @@ void HttpConn::init(int sockFd, const sockaddr_in &addr)
 {
     fd_ = sockFd;
     addr_ = addr;
-    readBuff_.clear();
-    writeBuff_.clear();
+    ReleaseState_();
     isClose_ = false;
+    acceptNs_ = Metrics::NowNs();
+    firstByteSent_ = false;
+    corked_ = false;
+    pendingDb_ = false;
+    pendingKdf_ = false;
+    pendingAsync_ = false;
+    std::vector<ZeroCopyPin>().swap(zcPins_);
+    zcNextId_ = 0;
+    zcBodyPinned_ = false;
+    zcCopied_ = false;
+    lingering_ = false;
+    h2_.reset();
+    if (ssl_ != nullptr)
+    {
+        SSL_free(ssl_);
+    }
+    ssl_ = tls != nullptr ? tls->NewSsl(sockFd) : nullptr;
+    handshaking_ = tls != nullptr; // 创建失败时握手直接失败
+    ktlsSend_ = false;
+    enqueueTsc_ = dequeueTsc_ = 0;
     userCount++;
+    MarkIdle_(true);
 }
 
 void HttpConn::Close()
@@ -29,6 +76,18 @@ void HttpConn::Close()
     {
         isClose_ = true;
         userCount--;
+        MarkIdle_(false);
+        if (ssl_ != nullptr)
+        {
+            if (!handshaking_)
+            {
+                ERR_clear_error();
+                SSL_shutdown(ssl_); // 尽力发送 close_notify，不等待对端的回应
+            }
+            SSL_free(ssl_);
+            ssl_ = nullptr;
+        }
+        ReleaseState_();
         if (fd_ >= 0)
         {
             close(fd_);
@@ -37,12 +96,105 @@ void HttpConn::Close()
     }
 }
 
+HttpConn::HandshakeResult HttpConn::Handshake()
+{
+    if (ssl_ == nullptr)
+    {
+        return HANDSHAKE_FAILED;
+    }
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret != 1)
+    {
+        int err = SSL_get_error(ssl_, ret);
+        if (err == SSL_ERROR_WANT_READ)
+            return HANDSHAKE_READ;
+        if (err == SSL_ERROR_WANT_WRITE)
+            return HANDSHAKE_WRITE;
+        unsigned long code = ERR_get_error();
+        LOG_DEBUG("TLS handshake with %s failed: %s", GetIP(),
+                  code != 0 ? ERR_reason_error_string(code) : strerror(errno));
+        ERR_clear_error();
+        CounterAdd(Metrics::Local().tlsFailed);
+        return HANDSHAKE_FAILED;
+    }
+
+    handshaking_ = false;
+    ThreadMetrics &metrics = Metrics::Local();
+    CounterAdd(metrics.tlsHandshakes);
+    if (SSL_session_reused(ssl_))
+    {
+        CounterAdd(metrics.tlsResumed);
+    }
+
+    // OpenSSL 在切换密钥时已尝试 kTLS；接收方向由 SSL_read 内部直接读套接字，发送方向我们自己 writev
+    ktlsSend_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+    if (ktlsSend_)
+    {
+        CounterAdd(metrics.ktlsSend);
+    }
+    if (BIO_get_ktls_recv(SSL_get_rbio(ssl_)))
+    {
+        CounterAdd(metrics.ktlsRecv);
+    }
+
+    // ALPN 选中 h2：客户端接下来直接发送连接前言
+    const unsigned char *alpn = nullptr;
+    unsigned int alpnLen = 0;
+    SSL_get0_alpn_selected(ssl_, &alpn, &alpnLen);
+    if (alpnLen == 2 && memcmp(alpn, "h2", 2) == 0)
+    {
+        h2_ = std::make_unique<Http2Session>(*this);
+    }
+    return HANDSHAKE_DONE;
+}
+
+void HttpConn::SendNow(std::string_view data)
+{
+    Send_(data.data(), data.size());
+}
+
+ssize_t HttpConn::ReadOnce_(int *saveErrno)
+{
+    AttachState_();
+    if (ssl_ == nullptr)
+    {
+        return state_->readBuff.ReadFd(fd_, saveErrno);
+    }
+
+    char buf[16384]; // 一个 TLS 记录的最大明文
+    ERR_clear_error();
+    int len = SSL_read(ssl_, buf, sizeof(buf));
+    if (len > 0)
+    {
+        state_->readBuff.append(buf, len);
+        return len;
+    }
+    switch (SSL_get_error(ssl_, len))
+    {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        *saveErrno = EAGAIN;
+        return -1;
+    case SSL_ERROR_ZERO_RETURN:
+        return 0; // 收到 close_notify
+    case SSL_ERROR_SYSCALL:
+        *saveErrno = errno != 0 ? errno : ECONNRESET;
+        break;
+    default:
+        *saveErrno = EPROTO;
+        break;
+    }
+    ERR_clear_error();
+    return -1;
+}
+
 ssize_t HttpConn::read(int *saveErrno)
 {
     ssize_t len = 0;
     while (true) // 一直读取，直到没有数据可读或发生错误
     {
-        int len = readBuff_.ReadFd(fd_, saveErrno); // 读取数据
+        int len = ReadOnce_(saveErrno); // 读取数据
         if (len <= 0)
         {
             break; // 如果读取失败或没有数据可读，则退出循环
@@ -57,7 +209,11 @@ ssize_t HttpConn::write(int *saveErrno)
 
     while (true)
     {
-        ssize_t len = writev(fd_, iov_, iovCnt_); // 执行写操作
+        ssize_t len = SendZeroCopy_();
+        if (len < 0 && errno == EOPNOTSUPP)
+        {
+            len = Writev_(); // 执行写操作
+        }
 
         if (len < 0)
         {
@@ -65,13 +221,14 @@ ssize_t HttpConn::write(int *saveErrno)
             if (errno == EAGAIN || errno == EWOULDBLOCK)
             {
                 // 缓冲区满，稍后重试
+                state_->trace.CountWriteBlock();
                 //std::cerr << "Write temporarily unavailable (errno: " << errno << ")" << std::endl;
                 break;
             }
             else
             {
                 // 其他错误，打印日志并退出
-                //std::cerr << "Write error: " << strerror(errno) << " (errno: " << errno << ")" << std::endl;
+                LOG_DEBUG("write to fd %d failed: %s", fd_, strerror(errno));
                 return -1;
             }
         }
@@ -108,6 +265,45 @@ ssize_t HttpConn::write(int *saveErrno)
         }
     }
 
+    if (totalLen > 0)
+    {
+        ThreadMetrics &metrics = Metrics::Local();
+        uint64_t now = Metrics::NowNs();
+        CounterAdd(metrics.bytesSent, totalLen);
+        if (!firstByteSent_)
+        {
+            firstByteSent_ = true;
+            metrics.RecordStage(ThreadMetrics::STAGE_FIRST_BYTE, now - acceptNs_);
+        }
+        if (ToWriteBytes() == 0)
+        {
+            if (corked_)
+            {
+                SetCork_(false); // 拔掉塞子，把最后不满一段的数据立即发出
+            }
+            if (!zcPins_.empty())
+            {
+                ReleaseZeroCopy_();
+            }
+            if (h2_)
+            {
+                return totalLen; // HTTP/2 的写出不对应单个请求，按流在会话中记录
+            }
+            metrics.RecordStage(ThreadMetrics::STAGE_WRITE, now - writeStartNs_);
+            if (Log::Instance()->AccessEnabled())
+            {
+                Log::Instance()->Access(addr_.sin_addr.s_addr, ntohs(addr_.sin_port), state_->request.method(),
+                                        state_->request.path(), state_->response.Code(), responseBytes_, now - requestNs_);
+            }
+            if (state_->trace.Active())
+            {
+                state_->trace.Mark(RequestTrace::WRITE_END);
+                Tracer::Instance()->Finish(state_->trace, fd_, state_->request.method(), state_->request.path(), state_->response.Code());
+                state_->trace.Reset();
+            }
+        }
+    }
+
     return totalLen; // 返回总共写入的字节数
 }
 
@@ -131,38 +327,532 @@ sockaddr_in HttpConn::GetAddr() const
     return addr_;
 }
 
+bool HttpConn::IsKeepAlive() const
+{
+    if (h2_)
+    {
+        return !h2_->Closing();
+    }
+    // 请求要求保持连接、且响应没有声明 Connection: close 时才保持
+    return state_ != nullptr && state_->request.IsKeepAlive() && state_->response.IsKeepAlive();
+}
+
 bool HttpConn::process()
 {
-    //没有写才重置请求
-    if(!IsWriting())
-        request_.Init();
+    AttachState_();
+    if (h2_)
+    {
+        return ProcessHttp2_();
+    }
+
+    //没有写且上一个请求已完成才重置请求，未完整的请求保留已解析的部分
+    if(!IsWriting() && state_->request.IsFinished())
+        state_->request.Init();
 
-    if (readBuff_.readableBytes() <= 0)
+    if (state_->readBuff.readableBytes() <= 0)
     {
+        // 连接进入空闲：没有未解析的数据也没有待写的响应，把请求状态还给共享池
+        if (state_->request.IsFresh() && ToWriteBytes() == 0)
+        {
+            ReleaseState_();
+            MarkIdle_(true);
+        }
         return false;
     }
-    else if (request_.parse(readBuff_))
+
+    // 新连接以 HTTP/2 前言开头（prior knowledge）
+    if (state_->request.IsFresh() && state_->readBuff.peek()[0] == 'P')
     {
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+        size_t n = std::min(state_->readBuff.readableBytes(), Http2Session::PREFACE.size());
+        if (Http2Session::PREFACE.compare(0, n, std::string_view(state_->readBuff.peek(), n)) == 0)
+        {
+            if (n < Http2Session::PREFACE.size())
+            {
+                return false; // 前言还没收全
+            }
+            h2_ = std::make_unique<Http2Session>(*this);
+            return ProcessHttp2_();
+        }
     }
-    else
+
+    // 新请求开始打点：由读事件触发时沿用投递/出队时间，流水线中的后续请求从当前时刻算起
+    if (!state_->trace.Active())
+    {
+        if (dequeueTsc_ != 0)
+            state_->trace.Begin(enqueueTsc_, dequeueTsc_);
+        else
+            state_->trace.Begin(0, ReadTsc());
+        enqueueTsc_ = dequeueTsc_ = 0;
+    }
+    if (state_->trace.Stamp(RequestTrace::PARSE_BEGIN) == 0)
+        state_->trace.Mark(RequestTrace::PARSE_BEGIN);
+
+    ThreadMetrics &metrics = Metrics::Local();
+    requestNs_ = Metrics::NowNs();
+    bool parsed = state_->request.parse(state_->readBuff);
+    state_->trace.Mark(RequestTrace::PARSE_END);
+    metrics.RecordStage(ThreadMetrics::STAGE_PARSE, Metrics::NowNs() - requestNs_);
+
+    if (!parsed)
+    {
+        state_->response.Init(srcDir, state_->request.path(), false, 400);
+        metrics.CountResponse(400);
+        state_->readBuff.clear(); // 丢弃无法解析的数据，下次从新请求开始
+        state_->request.Init();
+        state_->trace.Reset();
+        return false;
+    }
+    else if (!state_->request.IsFinished())
+    {
+        return false; // 请求还不完整，等待更多数据
+    }
+
+    if (TryHttp2_())
     {
-        response_.Init(srcDir, request_.path(), false, 400);
+        return true;
+    }
+
+    // 先按路由类别限流，被拒绝的登录/注册请求不会访问数据库
+    bool limited = rateLimiter != nullptr &&
+                   !rateLimiter->Allow(addr_.sin_addr.s_addr, state_->request.NeedsDb() ? RateLimiter::DB : RateLimiter::STATIC);
+    if (limited)
+    {
+        CounterAdd(metrics.rateLimited);
+        return MakeResponse_(429);
+    }
+    if (state_->request.AsyncRoute() != nullptr)
+    {
+        pendingAsync_ = true; // 交给 reactor 上的协程，由 RunAsync() 完成
         return false;
     }
+    return Advance_();
+}
+
+bool HttpConn::Advance_()
+{
+    // HTTP/2 连接上依次处理各个挂起的流，全部完成后再发送
+    HttpRequest *request = h2_ ? h2_->Parked() : &state_->request;
+    while (request != nullptr)
+    {
+        while (request->NeedsKdf() || request->NeedsDb())
+        {
+            if (request->NeedsKdf())
+            {
+                if (kdfPool)
+                {
+                    pendingKdf_ = true; // 交给口令哈希线程池，由 processKdf() 继续
+                    return false;
+                }
+                request->RunKdf();
+            }
+            else
+            {
+                if (dbLane)
+                {
+                    pendingDb_ = true; // 交给数据库通道，由 processDb() 继续
+                    return false;
+                }
+                request->RunDb();
+            }
+        }
+        if (!h2_)
+        {
+            return MakeResponse_(0);
+        }
+        h2_->Resume(state_->writeBuff, 0);
+        request = h2_->Parked();
+    }
+    return FlushHttp2_();
+}
+
+HttpRequest &HttpConn::PendingRequest_()
+{
+    return h2_ ? *h2_->Parked() : state_->request;
+}
+
+bool HttpConn::TryHttp2_()
+{
+    // 只升级没有请求体的 GET，请求体会占用升级后的连接；h2c 只用于明文连接
+    std::string_view upgrade, settings;
+    if (ssl_ != nullptr || !state_->request.FindHeader("Upgrade", upgrade) || upgrade != "h2c" ||
+        !state_->request.FindHeader("HTTP2-Settings", settings) || state_->request.method() != "GET")
+    {
+        return false;
+    }
+
+    state_->trace.Reset();
+    state_->writeBuff.clear();
+    auto session = std::make_unique<Http2Session>(*this);
+    if (!session->Upgrade(settings, state_->writeBuff))
+    {
+        state_->writeBuff.clear();
+        return false; // HTTP2-Settings 非法，按 HTTP/1.1 处理
+    }
+    h2_ = std::move(session);
+    h2_->OnData(state_->readBuff, state_->writeBuff); // 客户端前言可能已随升级请求到达
+    h2_->Pump(state_->writeBuff);
+
+    iov_[0].iov_base = const_cast<char *>(state_->writeBuff.peek());
+    iov_[0].iov_len = state_->writeBuff.readableBytes();
+    iov_[1].iov_len = 0;
+    iovCnt_ = 1;
+    return true;
+}
+
+bool HttpConn::ProcessHttp2_()
+{
+    // 上一批输出已全部写出（否则不会回到 process）
+    state_->writeBuff.clear();
+    h2_->OnData(state_->readBuff, state_->writeBuff);
+    if (HttpRequest::Draining())
+    {
+        h2_->Drain(state_->writeBuff);
+    }
+    return Advance_();
+}
+
+bool HttpConn::FlushHttp2_()
+{
+    h2_->Pump(state_->writeBuff);
+    if (state_->writeBuff.readableBytes() == 0)
+    {
+        MarkIdle_(h2_->Idle());
+        return false; // 没有要发送的：等待新帧（可能是对端的 WINDOW_UPDATE）
+    }
+    iov_[0].iov_base = const_cast<char *>(state_->writeBuff.peek());
+    iov_[0].iov_len = state_->writeBuff.readableBytes();
+    iov_[1].iov_len = 0;
+    iovCnt_ = 1;
+    return true;
+}
+
+bool HttpConn::processDb(bool admitted)
+{
+    pendingDb_ = false;
+    if (!admitted)
+    {
+        CounterAdd(Metrics::Local().shed);
+        return Reject_(503);
+    }
+    PendingRequest_().RunDb();
+    return Advance_();
+}
+
+bool HttpConn::processKdf(bool admitted)
+{
+    pendingKdf_ = false;
+    if (!admitted)
+    {
+        CounterAdd(Metrics::Local().shed);
+        return Reject_(503);
+    }
+    PendingRequest_().RunKdf();
+    return Advance_();
+}
+
+bool HttpConn::Reject_(int code)
+{
+    if (!h2_)
+    {
+        return MakeResponse_(code);
+    }
+    h2_->Resume(state_->writeBuff, code); // 只拒绝这一个流，其余挂起的流照常继续
+    return Advance_();
+}
+
+bool HttpConn::MakeResponse_(int rejectCode)
+{
+    state_->trace.Mark(RequestTrace::FILE_BEGIN);
+    if (rejectCode != 0)
+    {
+        std::string body = rejectCode == 429 ? "<html><body><h1>Too Many Requests</h1></body></html>"
+                                             : "<html><body><h1>Service Unavailable</h1></body></html>";
+        state_->response.InitContent("text/html", std::move(body), false, rejectCode);
+        state_->response.SetRetryAfter(1);
+    }
+    else if (!metricsPath.empty() && state_->request.path() == metricsPath)
+    {
+        state_->response.InitContent("text/plain; version=0.0.4", Metrics::Instance()->Render(), state_->request.IsKeepAlive());
+    }
+    else
+    {
+        state_->response.Init(srcDir, state_->request.path(), state_->request.IsKeepAlive(), 200);
+        state_->response.SetCookie(state_->request.SetCookie());
+        std::string_view ifNoneMatch;
+        state_->request.FindHeader("If-None-Match", ifNoneMatch);
+        state_->response.Negotiate(state_->request.AcceptsGzip(), ifNoneMatch);
+    }
+    state_->trace.Mark(RequestTrace::FILE_END);
+    PrepareWrite_();
+    return true;
+}
 
-    response_.MakeResponse(writeBuff_);
+void HttpConn::PrepareWrite_()
+{
+    state_->writeBuff.clear(); // 上一个响应已经写完，丢弃其头部
+    state_->response.MakeResponse(state_->writeBuff);
+    Metrics::Local().CountResponse(state_->response.Code());
+    writeStartNs_ = Metrics::NowNs();
+    state_->trace.Mark(RequestTrace::WRITE_BEGIN);
+    responseBytes_ = state_->writeBuff.readableBytes() + state_->response.BodyLen();
 
     // 设置写缓冲区
-    iov_[0].iov_base = const_cast<char *>(writeBuff_.peek());
-    iov_[0].iov_len = writeBuff_.readableBytes();
+    iov_[0].iov_base = const_cast<char *>(state_->writeBuff.peek());
+    iov_[0].iov_len = state_->writeBuff.readableBytes();
+    iov_[1].iov_len = 0;
     iovCnt_ = 1;
+    zcBodyPinned_ = false;
 
-    if (response_.FileLen() > 0)
+    if (state_->response.BodyLen() > 0)
     {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
+        iov_[1].iov_base = const_cast<char *>(state_->response.Body());
+        iov_[1].iov_len = state_->response.BodyLen();
         iovCnt_ = 2;
+
+        // 头部和文件体可能分多次写出，塞住连接避免头部单独成为一个小段
+        if (corkResponses && !corked_)
+        {
+            SetCork_(true);
+        }
+    }
+}
+
+Task<bool> HttpConn::RunAsync(CoReactor &reactor)
+{
+    pendingAsync_ = false;
+    CoContext ctx(*this, reactor);
+    try
+    {
+        co_await (*state_->request.AsyncRoute())(ctx);
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR("async handler for %.*s failed: %s", static_cast<int>(state_->request.path().size()),
+                  state_->request.path().data(), e.what());
+    }
+
+    if (!ctx.Failed() && !ctx.Responded())
+    {
+        // 处理函数没有给出响应（或中途抛出异常）
+        co_await ctx.Respond(500, "text/html", "<html><body><h1>Internal Server Error</h1></body></html>");
+    }
+    else if (!ctx.Failed() && ctx.Streaming())
+    {
+        co_await ctx.EndStream();
+    }
+    co_return !ctx.Failed();
+}
+
+ssize_t HttpConn::Writev_()
+{
+    if (ssl_ == nullptr || ktlsSend_)
+    {
+        return writev(fd_, iov_, iovCnt_); // 内核 TLS 在套接字上加密，响应体仍从文件映射直接写出
+    }
+    // 用户态 TLS：每次加密一段，部分写出后由调用方前移 iov_
+    const iovec &vec = iov_[0].iov_len > 0 ? iov_[0] : iov_[1];
+    return Send_(static_cast<const char *>(vec.iov_base), vec.iov_len);
+}
+
+ssize_t HttpConn::Send_(const char *data, size_t len)
+{
+    if (ssl_ == nullptr || ktlsSend_)
+    {
+        return send(fd_, data, len, MSG_NOSIGNAL);
+    }
+    if (len == 0)
+    {
+        return 0;
+    }
+    ERR_clear_error();
+    int ret = SSL_write(ssl_, data, static_cast<int>(std::min<size_t>(len, INT32_MAX)));
+    if (ret > 0)
+    {
+        return ret;
+    }
+    int err = SSL_get_error(ssl_, ret);
+    if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+    {
+        errno = EAGAIN;
+    }
+    else if (err != SSL_ERROR_SYSCALL || errno == 0)
+    {
+        errno = EPIPE;
+    }
+    ERR_clear_error();
+    return -1;
+}
+
+ssize_t HttpConn::SendZeroCopy_()
+{
+    // 用户态 TLS 需要先加密，内核 TLS 的发送路径也不支持 MSG_ZEROCOPY
+    if (ssl_ != nullptr || zeroCopyThreshold == 0 || zcCopied_ || iovCnt_ < 2 || iov_[1].iov_len < zeroCopyThreshold)
+    {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    msghdr msg{};
+    if (iov_[0].iov_len > 0)
+    {
+        // 头部很小，照常拷贝；MSG_MORE 让它与随后的响应体合并成满段
+        msg.msg_iov = &iov_[0];
+        msg.msg_iovlen = 1;
+        return sendmsg(fd_, &msg, MSG_MORE | MSG_NOSIGNAL);
+    }
+
+    // 第一次零拷贝发送前接管响应体，使下一个响应的 Init 不会释放或覆盖它
+    if (!zcBodyPinned_)
+    {
+        const char *oldBase = state_->response.Body();
+        std::shared_ptr<const char> body = state_->response.PinBody();
+        if (!body)
+        {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        iov_[1].iov_base = const_cast<char *>(body.get()) + (static_cast<char *>(iov_[1].iov_base) - oldBase);
+        zcPins_.push_back({zcNextId_, 0, 0, std::move(body)});
+        zcBodyPinned_ = true;
+    }
+
+    msg.msg_iov = &iov_[1];
+    msg.msg_iovlen = 1;
+    ssize_t len = sendmsg(fd_, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (len < 0 && errno == ENOBUFS)
+    {
+        // 超出 optmem 限制，本次退回普通发送
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    if (len > 0)
+    {
+        // 每次成功的零拷贝发送占用一个编号，完成通知按编号区间返回
+        ++zcPins_.back().sent;
+        ++zcNextId_;
+        CounterAdd(Metrics::Local().zeroCopySends);
+    }
+    return len;
+}
+
+void HttpConn::DrainZeroCopy()
+{
+    char control[128];
+    while (!zcPins_.empty())
+    {
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd_, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break; // EAGAIN：暂时没有更多通知
+        }
+
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const sock_extended_err *serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+            {
+                continue;
+            }
+
+            uint32_t lo = serr->ee_info;
+            uint32_t hi = serr->ee_data;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                // 内核实际做了拷贝（例如回环或网卡不支持分散读），零拷贝只剩额外开销
+                zcCopied_ = true;
+                CounterAdd(Metrics::Local().zeroCopyCopied, hi - lo + 1);
+            }
+
+            // 通知可能乱序，按区间重叠累加每个响应体的完成数
+            for (ZeroCopyPin &pin : zcPins_)
+            {
+                if (pin.sent == 0)
+                    continue;
+                uint32_t from = std::max(lo, pin.first);
+                uint32_t to = std::min(hi, pin.first + pin.sent - 1);
+                if (from <= to)
+                    pin.done += to - from + 1;
+            }
+        }
+    }
+    ReleaseZeroCopy_();
+}
+
+void HttpConn::ReleaseZeroCopy_()
+{
+    for (auto it = zcPins_.begin(); it != zcPins_.end();)
+    {
+        // 最后一个响应体可能还有没发完的部分，后续发送仍会引用它
+        bool sending = zcBodyPinned_ && std::next(it) == zcPins_.end() && ToWriteBytes() > 0;
+        if (!sending && it->done == it->sent)
+            it = zcPins_.erase(it);
+        else
+            ++it;
+    }
+}
+
+void HttpConn::AttachState_()
+{
+    if (state_ == nullptr)
+    {
+        state_ = ConnStatePool::Instance()->Acquire();
+    }
+    MarkIdle_(false);
+}
+
+void HttpConn::ReleaseState_()
+{
+    if (state_ != nullptr)
+    {
+        ConnStatePool::Instance()->Release(state_);
+        state_ = nullptr;
+    }
+}
+
+void HttpConn::InitIdleTable()
+{
+    // 软上限为 RLIM_INFINITY 时退回内核默认的 fs.nr_open，fd 不可能超过它
+    size_t count = 1 << 20;
+    struct rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    {
+        count = limit.rlim_cur;
+    }
+    idleFds = std::make_unique<std::atomic<bool>[]>(count);
+    idleFdCount = count;
+}
+
+void HttpConn::MarkIdle_(bool idle)
+{
+    if (fd_ >= 0 && static_cast<size_t>(fd_) < idleFdCount)
+    {
+        idleFds[fd_].store(idle, std::memory_order_relaxed);
+    }
+}
+
+void HttpConn::CollectIdle(std::vector<int> &fds)
+{
+    for (size_t fd = 0; fd < idleFdCount; ++fd)
+    {
+        if (idleFds[fd].load(std::memory_order_relaxed))
+        {
+            fds.push_back(static_cast<int>(fd));
+        }
+    }
+}
+
+void HttpConn::SetCork_(bool on)
+{
+    int value = on ? 1 : 0;
+    if (setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0)
+    {
+        corked_ = on;
     }
-    return true;
 }
@@ -8,10 +8,22 @@
 #include <errno.h>
 #include <iostream>
 #include <atomic> // std::atomic
+#include <vector>
+#include <memory>
 #include "../pool/SqlConnRAII.h"
 #include "../buffer/Buffer.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "ConnState.h"
+#include "../metrics/Metrics.h"
+#include "../log/Log.h"
+#include "../trace/Trace.h"
+
+class RateLimiter;
+class CoReactor;
+class Http2Session;
+class TlsContext;
+struct ssl_st;
 
 class HttpConn
 {
@@ -25,6 +37,23 @@ public:
     // 关闭连接
     void Close();
 
+    enum HandshakeResult
+    {
+        HANDSHAKE_DONE,  // 握手完成，可以读请求
+        HANDSHAKE_READ,  // 等待可读
+        HANDSHAKE_WRITE, // 等待可写
+        HANDSHAKE_FAILED,
+    };
+
+    // 推进 TLS 握手（非阻塞），在 reactor 线程上由该连接的读写事件驱动
+    HandshakeResult Handshake();
+
+    // 是否还在 TLS 握手中
+    bool IsHandshaking() const { return handshaking_; }
+
+    // 尽力立即发送一段数据（TLS 连接经由 SSL 加密），用于关闭前的拒绝响应
+    void SendNow(std::string_view data);
+
     // 读取数据
     ssize_t read(int *saveErrno);
 
@@ -43,33 +72,178 @@ public:
     // 获取客户端地址
     sockaddr_in GetAddr() const;
 
-    // 处理请求
+    // 处理请求：返回 true 表示响应已就绪；需要访问数据库（或计算口令哈希）且启用了对应线程池时
+    // 返回 false 并置 PendingDb()（或 PendingKdf()）
     bool process();
 
+    // 在数据库通道中执行 process() 推迟的数据库步骤；admitted 为 false 时（通道已满）直接回 503。
+    // 返回值同 process()：false 时可能还有下一步（PendingKdf() 或 PendingDb()）
+    bool processDb(bool admitted);
+
+    // 在口令哈希线程池中执行推迟的哈希步骤；admitted 为 false 时（排队已满）直接回 503。
+    // 返回值同 process()：false 时可能还有下一步（PendingDb() 或 PendingKdf()）
+    bool processKdf(bool admitted);
+
+    // 是否有等待数据库通道处理的请求
+    bool PendingDb() const { return pendingDb_; }
+
+    // 是否有等待口令哈希线程池处理的请求
+    bool PendingKdf() const { return pendingKdf_; }
+
+    // 请求匹配到协程处理函数时 process() 返回 false 并置 PendingAsync()，由 reactor 线程调用 RunAsync()
+    bool PendingAsync() const { return pendingAsync_; }
+
+    // 在 reactor 线程上运行协程处理函数并写出它的响应；返回 false 表示连接已不可用，应关闭
+    Task<bool> RunAsync(CoReactor &reactor);
+
+    // 记录读事件投递到线程池的时间，并以当前时间作为出队时间
+    void MarkQueued(uint64_t enqueueTsc)
+    {
+        enqueueTsc_ = enqueueTsc;
+        dequeueTsc_ = ReadTsc();
+    }
+
     // 获取待写字节数
     int ToWriteBytes() const
     {
         return iov_[0].iov_len + iov_[1].iov_len;
     }
 
-    // 判断是否保持长连接
-    bool IsKeepAlive() const
-    {
-        return request_.IsKeepAlive();
-    }
+    // 判断是否保持长连接；HTTP/2 连接在发送或收到 GOAWAY 之前一直保持
+    bool IsKeepAlive() const;
+
+    // 是否已切换到 HTTP/2
+    bool IsHttp2() const { return h2_ != nullptr; }
 
 public:
     bool IsWriting() const { return isWriting_; }
+
+    // 读缓冲区中还有未处理的数据
+    bool HasInput() const { return state_ != nullptr && state_->readBuff.readableBytes() > 0; }
     void SetWriting(bool flag) { isWriting_ = flag; }
 
+    // 活跃用户数
+    static int UserCount() { return userCount; }
+
+    // 空闲连接（在等待下一个请求，没有未完成的请求或流）的 fd，排空时由 server 逐个关闭
+    static void CollectIdle(std::vector<int> &fds);
+
+    // 按进程的 fd 上限（RLIMIT_NOFILE）分配空闲标记表，接受连接之前调用一次
+    static void InitIdleTable();
+
+    // 设置磁盘上的静态资源目录
+    static void SetSrcDir(const std::string &dir) { srcDir = dir; }
+
+    // 设置指标导出路径，为空时关闭
+    static void SetMetricsPath(const std::string &path) { metricsPath = path; }
+
+    // 是否在写带文件体的响应时使用 TCP_CORK
+    static void SetCork(bool enable) { corkResponses = enable; }
+
+    // 需要访问数据库的请求是否交给单独的数据库通道处理
+    static void SetDbLane(bool enable) { dbLane = enable; }
+
+    // 口令哈希交给单独的线程池，关闭时在当前线程计算
+    static void SetKdfPool(bool enable) { kdfPool = enable; }
+
+    // 按客户端 IP 限流，为空时不限
+    static void SetRateLimiter(RateLimiter *limiter) { rateLimiter = limiter; }
+
+    // 新连接先完成 TLS 握手，为空时为明文
+    static void SetTls(TlsContext *context) { tls = context; }
+
+    // 响应体不小于该字节数时以 MSG_ZEROCOPY 发送，0 表示关闭（套接字需已设置 SO_ZEROCOPY）
+    static void SetZeroCopyThreshold(size_t bytes) { zeroCopyThreshold = bytes; }
+
+    // 读取错误队列中的零拷贝完成通知，释放内核已用完的响应体
+    void DrainZeroCopy();
+
+    // 是否还有内核未确认的零拷贝发送
+    bool ZeroCopyPending() const { return !zcPins_.empty(); }
+
+    // 连接已关闭写端，等待零拷贝完成后再真正关闭
+    bool IsLingering() const { return lingering_; }
+    void SetLingering() { lingering_ = true; }
+
 private:
     bool isWriting_; // 表示是否在写数据中
 
     // 静态变量
-    static const char *srcDir;         // 静态资源目录
+    static std::string srcDir;         // 静态资源目录（未使用内嵌资源时）
+    static std::string metricsPath;    // 指标导出路径
     static std::atomic<int> userCount; // 活跃用户数
+    static bool corkResponses;         // 写响应时塞住连接
+    static bool dbLane;                // 数据库请求走单独的通道
+    static bool kdfPool;               // 口令哈希走单独的线程池
+    static size_t zeroCopyThreshold;   // 零拷贝发送阈值
+    static RateLimiter *rateLimiter;   // 请求级限流
+    static TlsContext *tls;            // 监听端口的 TLS 配置
+
+    // 按 fd 记录的空闲标记：连接在工作线程间流转，reactor 不能安全地遍历连接表。
+    // 表长取启动时的 fd 上限，accept 得到的 fd 不会超出，排空时每个空闲连接都能找到
+    static std::unique_ptr<std::atomic<bool>[]> idleFds;
+    static size_t idleFdCount;
+    void MarkIdle_(bool idle);
 
 private:
+    friend class CoContext;
+    friend class Http2Session;
+
+    // HTTP/2 连接的 process()：处理收到的帧并生成要发送的帧
+    bool ProcessHttp2_();
+
+    // 为 HTTP/2 的各个流生成 DATA 帧并设置写缓冲区；没有要发送的时返回 false
+    bool FlushHttp2_();
+
+    // 收到 HTTP/2 连接前言或 Upgrade: h2c 请求时切换协议，返回 true 表示已切换
+    bool TryHttp2_();
+
+    // 执行或推迟请求剩余的哈希与数据库步骤，都完成后生成响应
+    bool Advance_();
+
+    // 等待哈希或数据库步骤的请求：HTTP/2 连接上为最早挂起的流的请求
+    HttpRequest &PendingRequest_();
+
+    // 线程池排队已满时拒绝等待中的请求；HTTP/2 连接上只拒绝对应的流
+    bool Reject_(int code);
+
+    // 生成响应并设置写缓冲区；rejectCode 非 0 时生成对应的拒绝响应（429/503）
+    bool MakeResponse_(int rejectCode);
+
+    // 把 response_ 的头部写入 writeBuff_ 并设置 iov_
+    void PrepareWrite_();
+
+    // 读一次数据追加到 readBuff_；返回 0 表示对端已关闭，-1 时 saveErrno 为 EAGAIN 或其他错误
+    ssize_t ReadOnce_(int *saveErrno);
+
+    // 写出 iov_ 中的数据：明文与内核 TLS 直接 writev，否则经 SSL_write；失败时返回 -1 并设置 errno
+    ssize_t Writev_();
+
+    // 写出一段连续数据，语义同 send
+    ssize_t Send_(const char *data, size_t len);
+
+    // 开始处理数据前从共享池取得请求状态；连接空闲时归还
+    void AttachState_();
+    void ReleaseState_();
+
+    // 打开或关闭 TCP_CORK
+    void SetCork_(bool on);
+
+    // 以 MSG_ZEROCOPY 发送剩余的响应体；不适用时返回 -1 且 errno 为 EOPNOTSUPP
+    ssize_t SendZeroCopy_();
+
+    // 释放内核已全部确认、且不再发送的响应体
+    void ReleaseZeroCopy_();
+
+    // 一个被钉住的响应体及其零拷贝发送编号区间 [first, first + sent)
+    struct ZeroCopyPin
+    {
+        uint32_t first;
+        uint32_t sent; // 成功发送的次数
+        uint32_t done; // 已确认的次数
+        std::shared_ptr<const char> body;
+    };
+
     int fd_;           // 客户端文件描述符
     sockaddr_in addr_; // 客户端地址
     bool isClose_;     // 是否关闭连接
@@ -77,11 +251,32 @@ private:
     int iovCnt_;          // iovec 计数
     struct iovec iov_[2]; // iovec 数组
 
-    Buffer readBuff_;  // 读缓冲区
-    Buffer writeBuff_; // 写缓冲区
+    uint64_t acceptNs_;     // 连接建立时间
+    uint64_t requestNs_;    // 当前请求开始处理的时间
+    uint64_t writeStartNs_; // 当前响应开始写的时间
+    size_t responseBytes_;  // 当前响应的总字节数
+    bool firstByteSent_;    // 是否已写出过响应字节
+    bool corked_;           // 当前响应是否已打开 TCP_CORK
+    bool pendingDb_;        // 请求已解析完，等待数据库通道处理
+    bool pendingKdf_;       // 等待口令哈希线程池处理
+    bool pendingAsync_;     // 请求已解析完，等待 reactor 上的协程处理
+
+    std::vector<ZeroCopyPin> zcPins_; // 等待内核确认的响应体（空时不占堆内存）
+    uint32_t zcNextId_;              // 内核给下一次零拷贝发送分配的编号
+    bool zcBodyPinned_;              // 当前响应体是否已钉住
+    bool zcCopied_;                  // 内核报告过退化为拷贝，本连接不再尝试零拷贝
+    bool lingering_;                 // 已关闭写端，等待零拷贝完成
+
+    std::unique_ptr<Http2Session> h2_; // 切换到 HTTP/2 后的会话
+
+    ssl_st *ssl_;      // TLS 连接的 SSL 对象，明文连接为空
+    bool handshaking_; // TLS 握手未完成
+    bool ktlsSend_;    // 发送方向已交给内核 TLS，可直接写套接字
+
+    ConnState *state_; // 读写缓冲区、请求与响应，只在处理请求期间持有
 
-    HttpRequest request_;   // HTTP 请求对象
-    HttpResponse response_; // HTTP 响应对象
+    uint64_t enqueueTsc_; // 最近一次读事件的投递时间，开始新请求时使用
+    uint64_t dequeueTsc_; // 最近一次读事件的出队时间
 };
 
 #endif // HTTP_CONN_H
@@ -1,39 +1,66 @@
 #include "HttpRequest.h"
+#include "Session.h"
+#include "../pool/PasswordHasher.h"
+#include "../metrics/Metrics.h"
+#include "../log/Log.h"
 #include <iostream>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <mutex>
 
 using namespace std;
 
-const unordered_set<string> HttpRequest::DEFAULT_HTML{
-    "/index",
-    "/register",
-    "/login",
-    "/welcome",
-    "/video",
-    "/picture",
-};
-
-const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG{
-    {"/register.html", 0},
-    {"/login.html", 1},
-};
+bool HttpRequest::stubDb_ = false;
+std::atomic<bool> HttpRequest::draining_ = false;
+RegisterBatcher *HttpRequest::registerBatcher_ = nullptr;
+const SessionTokens *HttpRequest::sessionTokens_ = nullptr;
 
 // 初始化请求对象
 HttpRequest::HttpRequest()
+    : state_(REQUEST_LINE),
+      dbNs_(0),
+      dbAction_(DB_NONE),
+      kdfAction_(KDF_NONE),
+      userFound_(false),
+      contentLength_(0),
+      hasContentLength_(false),
+      method_(arena_.Resource()),
+      path_(arena_.Resource()),
+      version_(arena_.Resource()),
+      body_(arena_.Resource()),
+      header_(arena_.Resource()),
+      post_(arena_.Resource()),
+      setCookie_(arena_.Resource())
 {
-    Init();
 }
 
 // 重置请求对象状态
 void HttpRequest::Init()
 {
     state_ = REQUEST_LINE;
-    method_.clear();
-    path_.clear();
-    version_.clear();
-    body_.clear();
-    header_.clear();
-    post_.clear();
+    dbNs_ = 0;
+    dbAction_ = DB_NONE;
+    kdfAction_ = KDF_NONE;
+    userFound_ = false;
+    credential_.clear();
+    asyncRoute_ = nullptr;
+    params_.count = 0;
+    contentLength_ = 0;
+    hasContentLength_ = false;
+
+    // 先用空对象替换掉所有引用 arena 内存的成员（旧对象在作用域结束时析构），
+    // 再整体释放 arena；仅 clear() 会保留指向旧内存的容量和桶数组
+    {
+        String(arena_.Resource()).swap(method_);
+        String(arena_.Resource()).swap(path_);
+        String(arena_.Resource()).swap(version_);
+        String(arena_.Resource()).swap(body_);
+        StringMap(arena_.Resource()).swap(header_);
+        StringMap(arena_.Resource()).swap(post_);
+        String(arena_.Resource()).swap(setCookie_);
+    }
+    arena_.Reset();
 }
 
 bool HttpRequest::parse(Buffer &buff)
@@ -45,16 +72,22 @@ bool HttpRequest::parse(Buffer &buff)
         return false;
     }
 
+    bool wasFinished = (state_ == FINISH);
     while (buff.readableBytes() && state_ != FINISH)
     {
         // 检查当前状态
         if (state_ == BODY)
         {
-            // 直接处理整个请求体
-            std::string body(buff.peek(), buff.peek() + buff.readableBytes());
-            ParseBody_(body);                    // 解析请求体
-            buff.retrieve(buff.readableBytes()); // 清空已读取的 body 数据
-            state_ = FINISH;                     // BODY 解析完成，状态置为 FINISH
+            // 按 Content-Length 取出请求体，后面的数据属于下一个（流水线）请求；
+            // 没有 Content-Length 时沿用旧行为，把缓冲区剩余数据都当作请求体
+            size_t bodyLen = hasContentLength_ ? contentLength_ : buff.readableBytes();
+            if (buff.readableBytes() < bodyLen)
+            {
+                break; // 请求体不完整，等待更多数据
+            }
+            ParseBody_(std::string_view(buff.peek(), bodyLen)); // 解析请求体
+            buff.skip(bodyLen);                                 // 丢弃已读取的 body 数据
+            state_ = FINISH;                                    // BODY 解析完成，状态置为 FINISH
             break;
         }
 
@@ -66,7 +99,7 @@ bool HttpRequest::parse(Buffer &buff)
             break;
         }
 
-        std::string line(buff.peek(), lineEnd); // 提取当前行
+        std::string_view line(buff.peek(), lineEnd - buff.peek()); // 当前行（指向缓冲区，不拷贝）
 
         switch (state_)
         {
@@ -86,7 +119,26 @@ bool HttpRequest::parse(Buffer &buff)
             {
                 if (method_ == "POST")
                 {
-                    state_ = BODY; // 如果是 POST 请求，转到 BODY 状态
+                    std::string_view len = Header_("Content-Length");
+                    hasContentLength_ = !len.empty();
+                    contentLength_ = 0;
+                    if (len.size() > MAX_LENGTH_DIGITS)
+                    {
+                        return false; // Content-Length 过长
+                    }
+                    for (char ch : len)
+                    {
+                        if (ch < '0' || ch > '9')
+                        {
+                            return false; // Content-Length 非法
+                        }
+                        contentLength_ = contentLength_ * 10 + (ch - '0');
+                        if (contentLength_ > MAX_BODY_SIZE)
+                        {
+                            return false; // 加上这一位之后再检查，否则最多能放过 10 倍上限
+                        }
+                    }
+                    state_ = (hasContentLength_ && contentLength_ == 0) ? FINISH : BODY; // 如果是 POST 请求，转到 BODY 状态
                 }
                 else
                 {
@@ -99,132 +151,330 @@ bool HttpRequest::parse(Buffer &buff)
             break;
         }
 
-        // 安全检查 lineEnd 是否有效
-        if (lineEnd >= buff.peek() && lineEnd <= buff.peek() + buff.readableBytes())
-        {
-            size_t lineLength = lineEnd - buff.peek() + 2; // 行长度，包括 \r\n
-            buff.retrieve(lineLength);                     // 从缓冲区中删除已读取的数据
-        }
-        else
-        {
-            std::cerr << "Invalid lineEnd pointer detected." << std::endl;
-            return false; // 如果 lineEnd 无效，返回 false 避免段错误
-        }
+        buff.skip(line.size() + 2); // 从缓冲区中删除已读取的行，包括 \r\n
+    }
+
+    if (!wasFinished && state_ == FINISH)
+    {
+        Route_();
     }
 
     return true; // 返回true，表示成功解析
 }
 
-// 解析请求行
-bool HttpRequest::ParseRequestLine_(const std::string &line)
+// 解析请求行，格式为 "(GET|POST) <非空白路径> HTTP/d.d"
+bool HttpRequest::ParseRequestLine_(std::string_view line)
 {
-    std::regex pattern(R"((GET|POST) (\S+) (HTTP/\d\.\d))");
-    std::smatch match;
-    if (std::regex_match(line, match, pattern))
+    size_t sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos)
     {
-        method_ = match[1];
-        path_ = match[2];
-        version_ = match[3];
-        return true;
+        return false;
     }
-    return false;
+    std::string_view method = line.substr(0, sp1);
+    if (method != "GET" && method != "POST")
+    {
+        return false;
+    }
+
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos || sp2 == sp1 + 1)
+    {
+        return false;
+    }
+    std::string_view path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    for (char ch : path)
+    {
+        if (std::isspace(static_cast<unsigned char>(ch)))
+        {
+            return false;
+        }
+    }
+
+    std::string_view version = line.substr(sp2 + 1);
+    if (version.size() != 8 || version.compare(0, 5, "HTTP/") != 0 ||
+        !std::isdigit(static_cast<unsigned char>(version[5])) || version[6] != '.' ||
+        !std::isdigit(static_cast<unsigned char>(version[7])))
+    {
+        return false;
+    }
+
+    method_.assign(method.data(), method.size());
+    path_.assign(path.data(), path.size());
+    version_.assign(version.data(), version.size());
+    return true;
 }
 
 // 解析请求头
-void HttpRequest::ParseHeader_(const std::string &line)
+void HttpRequest::ParseHeader_(std::string_view line)
 {
     size_t pos = line.find(':');
-    if (pos != std::string::npos)
+    if (pos != std::string_view::npos)
     {
-        std::string key = line.substr(0, pos);
-        std::string value = line.substr(pos + 2); // 忽略": "部分
-        header_[key] = value;
+        std::string_view key = line.substr(0, pos);
+        std::string_view value = line.substr(pos + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        {
+            value.remove_prefix(1); // 忽略": "后的空白
+        }
+        String &slot = header_[String(key, arena_.Resource())];
+        slot.assign(value.data(), value.size());
     }
 }
 
 // 解析请求体
-void HttpRequest::ParseBody_(const std::string &line)
+void HttpRequest::ParseBody_(std::string_view line)
 {
-    body_ = line; // 简单地将请求体附加到 body 字符串上
+    body_.assign(line.data(), line.size()); // 简单地将请求体附加到 body 字符串上
     ParsePost_();
     this->state_ = PARSE_STATE::FINISH;
 }
 
-// 获取POST请求表单中的参数
-std::string HttpRequest::GetPost(const std::string &key) const
+// 查找请求头
+std::string_view HttpRequest::Header_(const char *key) const
+{
+    auto it = header_.find(String(key)); // 短键走 SSO，不分配内存
+    return it != header_.end() ? std::string_view(it->second) : std::string_view();
+}
+
+bool HttpRequest::FindHeader(std::string_view key, std::string_view &value) const
 {
-    if (post_.find(key) != post_.end())
+    auto it = header_.find(String(key));
+    if (it != header_.end())
+    {
+        value = it->second;
+        return true;
+    }
+    // 常用写法之外的大小写（如 HTTP/2 客户端发来的小写头部）逐个比较
+    for (const auto &entry : header_)
     {
-        return post_.at(key);
+        if (entry.first.size() == key.size() &&
+            std::equal(key.begin(), key.end(), entry.first.begin(), [](char a, char b)
+                       { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); }))
+        {
+            value = entry.second;
+            return true;
+        }
     }
-    return "";
+    return false;
 }
 
-// 判断是否为长连接
-// bool HttpRequest::IsKeepAlive() const
-// {
-//     return (header_.find("Connection") != header_.end()) &&
-//            (header_.at("Connection") == "keep-alive");
-// }
-bool HttpRequest::IsKeepAlive() const
+bool HttpRequest::AcceptsGzip() const
 {
-    auto it = header_.find("Connection");
-    if (it != header_.end())
+    std::string_view value;
+    if (!FindHeader("Accept-Encoding", value))
     {
-        return it->second == "keep-alive";
+        return false;
     }
-    return false; // 默认为短连接
+    while (!value.empty())
+    {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+
+        size_t semi = item.find(';');
+        std::string_view coding = item.substr(0, semi);
+        while (!coding.empty() && coding.front() == ' ')
+            coding.remove_prefix(1);
+        while (!coding.empty() && coding.back() == ' ')
+            coding.remove_suffix(1);
+        if (coding != "gzip" && coding != "*")
+        {
+            continue;
+        }
+        size_t q = semi == std::string_view::npos ? std::string_view::npos : item.find("q=", semi);
+        if (q == std::string_view::npos)
+        {
+            return true;
+        }
+        double weight = 1;
+        std::from_chars(item.data() + q + 2, item.data() + item.size(), weight);
+        return weight > 0;
+    }
+    return false;
+}
+
+// 查找表单参数
+std::string_view HttpRequest::Post_(const char *key) const
+{
+    auto it = post_.find(String(key));
+    return it != post_.end() ? std::string_view(it->second) : std::string_view();
+}
+
+// 获取POST请求表单中的参数
+std::string HttpRequest::GetPost(const std::string &key) const
+{
+    return std::string(Post_(key.c_str()));
+}
+
+// 判断是否为长连接
+bool HttpRequest::IsKeepAlive() const
+{
+    return !Draining() && Header_("Connection") == "keep-alive"; // 默认为短连接
 }
 
 // 请求路径处理
 void HttpRequest::ParsePath_()
 {
-    if (path_ == "/")
+    // 静态别名查编译期生成的完美哈希表，一次哈希加一次比较
+    std::string_view alias = Router::Alias(path_);
+    if (!alias.empty())
     {
-        path_ = "/index.html";
+        path_.assign(alias.data(), alias.size());
+    }
+    this->state_ = PARSE_STATE::HEADERS;
+}
+
+void HttpRequest::Route_()
+{
+    Router::Method method = Router::ParseMethod(method_);
+    const Router::Route *route = Router::Instance()->Match(method, path_, params_);
+    if (route == nullptr)
+    {
+        return;
+    }
+    if (route->async)
+    {
+        asyncRoute_ = &route->async; // 由连接交给 reactor 上的协程处理
     }
     else
     {
-        for (auto &item : DEFAULT_HTML)
-        {
-            if (item == path_)
-            {
-                path_ += ".html";
-                break;
-            }
-        }
+        route->handler(*this, params_);
     }
-    this->state_ = PARSE_STATE::HEADERS;
 }
 
 // POST请求的表单参数处理
 void HttpRequest::ParsePost_()
 {
     ParseFormData_(); // 解析 POST 请求体中的表单数据
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded")
+    if (method_ == "POST" && IsFormUrlencoded())
     {
         ParseFromUrlencoded_();
+    }
+}
+
+// 执行解析阶段记下的数据库访问（登录/注册）
+void HttpRequest::RunDb()
+{
+    if (dbAction_ == DB_NONE)
+    {
+        return;
+    }
+    bool isLogin = (dbAction_ == DB_LOGIN);
+    dbAction_ = DB_NONE;
+    std::string_view name = Post_("username");
+    if (name.empty() || Post_("password").empty())
+    {
+        LOG_DEBUG("Username or password is empty.");
+        kdfAction_ = KDF_NONE;
+        Finish_(false);
+        return;
+    }
 
-        if (DEFAULT_HTML_TAG.count(path_))
+    uint64_t dbStart = Metrics::NowNs();
+    if (trace_)
+        trace_->Mark(RequestTrace::DB_BEGIN);
+    bool ok = false;
+    if (isLogin)
+    {
+        int found = LookupPassword(name, &credential_);
+        if (found >= 0)
         {
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            if (tag == 0 || tag == 1)
-            {
-                bool isLogin = (tag == 1);
-                if (UserVerify(post_["username"], post_["password"], isLogin))
-                {
-                    path_ = "/welcome.html";
-                }
-                else
-                {
-                    path_ = "/error.html";
-                }
-            }
+            // 口令校验交给 RunKdf；用户不存在时也校验一次占位哈希
+            userFound_ = found > 0;
+            if (!userFound_)
+                credential_ = PasswordHasher::DummyHash();
+            kdfAction_ = KDF_VERIFY;
+        }
+    }
+    else
+    {
+        ok = AddUser(name, credential_);
+    }
+    if (trace_)
+        trace_->Mark(RequestTrace::DB_END);
+    dbNs_ += Metrics::NowNs() - dbStart;
+    Metrics::Local().RecordStage(ThreadMetrics::STAGE_DB, dbNs_);
+    if (kdfAction_ == KDF_NONE)
+    {
+        Finish_(ok);
+    }
+}
+
+void HttpRequest::RunKdf()
+{
+    if (kdfAction_ == KDF_NONE)
+    {
+        return;
+    }
+    KdfAction action = kdfAction_;
+    kdfAction_ = KDF_NONE;
+    std::string_view pwd = Post_("password");
+    if (Post_("username").empty() || pwd.empty())
+    {
+        dbAction_ = DB_NONE; // 交给 RunDb 也只会失败，不必再排队
+        Finish_(false);
+        return;
+    }
+
+    uint64_t start = Metrics::NowNs();
+    if (action == KDF_HASH)
+    {
+        if (!PasswordHasher::Hash(pwd, &credential_))
+        {
+            dbAction_ = DB_NONE;
+            Finish_(false);
+        }
+    }
+    else
+    {
+        bool ok = PasswordHasher::Verify(pwd, credential_) && userFound_;
+        Finish_(ok);
+    }
+    Metrics::Local().RecordStage(ThreadMetrics::STAGE_KDF, Metrics::NowNs() - start);
+}
+
+void HttpRequest::RunPending()
+{
+    while (NeedsKdf() || NeedsDb())
+    {
+        if (NeedsKdf())
+            RunKdf();
+        else
+            RunDb();
+    }
+}
+
+void HttpRequest::Finish_(bool ok)
+{
+    if (ok)
+    {
+        path_ = "/welcome.html";
+        if (sessionTokens_ != nullptr)
+        {
+            std::string cookie = sessionTokens_->Issue(Post_("username"));
+            setCookie_.assign(cookie.data(), cookie.size());
+            CounterAdd(Metrics::Local().sessionsIssued);
         }
     }
+    else
+    {
+        path_ = "/error.html";
+    }
+}
+
+bool HttpRequest::SessionUser(std::string *user) const
+{
+    std::string_view cookie;
+    if (sessionTokens_ == nullptr || !FindHeader("Cookie", cookie))
+    {
+        return false;
+    }
+    bool ok = sessionTokens_->Verify(cookie, user);
+    CounterAdd(ok ? Metrics::Local().sessionsVerified : Metrics::Local().sessionsRejected);
+    return ok;
 }
 
-// 解析URL编码的数据
+// 解析URL编码的数据（'+' 转空格，%XX 转对应字节），结果覆盖 post_ 中的原始值
 void HttpRequest::ParseFromUrlencoded_()
 {
     if (body_.size() == 0)
@@ -232,152 +482,236 @@ void HttpRequest::ParseFromUrlencoded_()
         return;
     }
 
-    string key, value;
-    int num = 0;
-    int n = body_.size();
-    int i = 0, j = 0;
+    String key(arena_.Resource());
+    String value(arena_.Resource());
+    String *cur = &key;
+    size_t n = body_.size();
 
-    for (; i < n; i++)
+    for (size_t i = 0; i <= n; i++)
     {
+        if (i == n || body_[i] == '&')
+        {
+            if (!key.empty())
+            {
+                post_[key] = value;
+            }
+            key.clear();
+            value.clear();
+            cur = &key;
+            continue;
+        }
+
         char ch = body_[i];
         switch (ch)
         {
         case '=':
-            key = body_.substr(j, i - j);
-            j = i + 1;
+            if (cur == &key)
+            {
+                cur = &value;
+            }
+            else
+            {
+                cur->push_back(ch);
+            }
             break;
         case '+':
-            body_[i] = ' ';
+            cur->push_back(' ');
             break;
         case '%':
-            num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
-            body_[i + 2] = num % 10 + '0';
-            body_[i + 1] = num / 10 + '0';
-            i += 2;
-            break;
-        case '&':
-            value = body_.substr(j, i - j);
-            j = i + 1;
-            post_[key] = value;
+            if (i + 2 < n && ConverHex(body_[i + 1]) >= 0 && ConverHex(body_[i + 2]) >= 0)
+            {
+                cur->push_back(static_cast<char>(ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2])));
+                i += 2;
+            }
+            else
+            {
+                cur->push_back(ch);
+            }
             break;
         default:
+            cur->push_back(ch);
             break;
         }
     }
-    if (post_.count(key) == 0 && j < i)
-    {
-        value = body_.substr(j, i - j);
-        post_[key] = value;
-    }
 }
 
-// 解析POST表单数据
+// 解析POST表单数据（按 '&' 和 '=' 切分，不做解码）
 void HttpRequest::ParseFormData_()
 {
-    std::istringstream bodyStream(body_);
-    std::string keyValue;
-    while (std::getline(bodyStream, keyValue, '&'))
+    std::string_view rest(body_);
+    while (!rest.empty())
     {
+        size_t amp = rest.find('&');
+        std::string_view keyValue = rest.substr(0, amp);
+        rest = (amp == std::string_view::npos) ? std::string_view() : rest.substr(amp + 1);
+
         size_t pos = keyValue.find('=');
-        if (pos != std::string::npos)
+        if (pos != std::string_view::npos)
         {
-            std::string key = keyValue.substr(0, pos);
-            std::string value = keyValue.substr(pos + 1);
-            post_[key] = value;
+            String &slot = post_[String(keyValue.substr(0, pos), arena_.Resource())];
+            std::string_view value = keyValue.substr(pos + 1);
+            slot.assign(value.data(), value.size());
         }
     }
 }
 
-bool HttpRequest::UserVerify(const std::string &name, const std::string &pwd, bool isLogin)
+int HttpRequest::LookupPassword(std::string_view name, std::string *stored)
 {
-    // 检查用户名或密码是否为空
-    if (name.empty() || pwd.empty())
+    if (stubDb_)
+    {
+        return StubLookup_(name, stored);
+    }
+
+    // 只读查询走从库
+    SqlConnPool *pool = SqlConnPool::Instance();
+    MYSQL *sql = pool->GetReadConn();
+    int found = LoginQuery_(sql, name, stored);
+    if (found <= 0 && pool->IsReplica(sql))
+    {
+        // 从库出错，或查不到用户（可能刚注册、从库还没同步到）：以主库为准再查一次
+        if (found < 0)
+        {
+            pool->ReportFailure(sql);
+        }
+        pool->FreeConn(sql);
+        sql = pool->GetConn();
+        found = LoginQuery_(sql, name, stored);
+    }
+    pool->FreeConn(sql);
+    return found;
+}
+
+bool HttpRequest::AddUser(std::string_view name, std::string_view credential)
+{
+    if (name.empty() || credential.empty())
     {
-        std::cerr << "Username or password is empty." << std::endl;
         return false;
     }
 
-    MYSQL *sql;
-    SqlConnRAII(&sql, SqlConnPool::Instance()); // 获取数据库连接
+    if (registerBatcher_ != nullptr)
+    {
+        return registerBatcher_->Register(name, credential); // 与同一时间的其他注册合并为一个事务
+    }
+
+    if (stubDb_)
+    {
+        return StubAddUser_(name, credential);
+    }
+
+    // 读写都在主库
+    MYSQL *sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance()); // 获取数据库连接
+    if (sql == nullptr)
+    {
+        LOG_ERROR("Register: no database connection");
+        return false;
+    }
 
     bool flag = false;
     char order[256] = {0};
-    MYSQL_RES *res = nullptr;
+    snprintf(order, 256, "SELECT username FROM user WHERE username='%.*s' LIMIT 1", (int)name.size(), name.data());
 
-    // 登录逻辑
-    if (isLogin)
+    if (mysql_query(sql, order))
     {
-        snprintf(order, 256, "SELECT password FROM user WHERE username='%s' LIMIT 1", name.c_str());
+        LOG_ERROR("Register check query failed: %s", mysql_error(sql));
+        return false;
+    }
 
-        if (mysql_query(sql, order))
-        {
-            std::cerr << "Login query failed: " << mysql_error(sql) << std::endl;
-            SqlConnPool::Instance()->FreeConn(sql);
-            return false;
-        }
+    MYSQL_RES *res = mysql_store_result(sql);
+    if (!res)
+    {
+        LOG_ERROR("Failed to store result: %s", mysql_error(sql));
+        return false;
+    }
 
-        res = mysql_store_result(sql);
-        if (!res)
+    if (!mysql_fetch_row(res))
+    { // 用户不存在，可以注册
+        snprintf(order, 256, "INSERT INTO user(username, password) VALUES('%.*s','%.*s')",
+                 (int)name.size(), name.data(), (int)credential.size(), credential.data());
+        if (mysql_query(sql, order))
         {
-            std::cerr << "Failed to store result: " << mysql_error(sql) << std::endl;
-            SqlConnPool::Instance()->FreeConn(sql);
-            return false;
+            LOG_ERROR("User registration failed: %s", mysql_error(sql));
+            flag = false;
         }
-
-        MYSQL_ROW row = mysql_fetch_row(res);
-        if (row)
+        else
         {
-            std::string password(row[0]);
-            if (pwd == password)
-            {
-                flag = true;
-            }
+            flag = true; // 注册成功
         }
-        mysql_free_result(res);
     }
-    // 注册逻辑
     else
     {
-        snprintf(order, 256, "SELECT username FROM user WHERE username='%s' LIMIT 1", name.c_str());
+        LOG_DEBUG("Username already exists.");
+        flag = false;
+    }
+    mysql_free_result(res);
+    return flag;
+}
 
-        if (mysql_query(sql, order))
-        {
-            std::cerr << "Register check query failed: " << mysql_error(sql) << std::endl;
-            SqlConnPool::Instance()->FreeConn(sql);
-            return false;
-        }
+// 查询登录用户的口令：-1 查询失败，0 用户不存在，1 用户存在（*stored 为保存的口令哈希）
+int HttpRequest::LoginQuery_(MYSQL *sql, std::string_view name, std::string *stored)
+{
+    if (sql == nullptr)
+    {
+        LOG_ERROR("Login: no database connection");
+        return -1;
+    }
 
-        res = mysql_store_result(sql);
-        if (!res)
-        {
-            std::cerr << "Failed to store result: " << mysql_error(sql) << std::endl;
-            SqlConnPool::Instance()->FreeConn(sql);
-            return false;
-        }
+    char order[256] = {0};
+    snprintf(order, 256, "SELECT password FROM user WHERE username='%.*s' LIMIT 1", (int)name.size(), name.data());
 
-        if (!mysql_fetch_row(res))
-        { // 用户不存在，可以注册
-            snprintf(order, 256, "INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-            if (mysql_query(sql, order))
-            {
-                std::cerr << "User registration failed: " << mysql_error(sql) << std::endl;
-                flag = false;
-            }
-            else
-            {
-                flag = true; // 注册成功
-            }
-        }
-        else
-        {
-            std::cerr << "Username already exists." << std::endl;
-            flag = false;
-        }
-        mysql_free_result(res);
+    if (mysql_query(sql, order))
+    {
+        LOG_ERROR("Login query failed: %s", mysql_error(sql));
+        return -1;
     }
 
-    SqlConnPool::Instance()->FreeConn(sql);
-    return flag;
+    MYSQL_RES *res = mysql_store_result(sql);
+    if (!res)
+    {
+        LOG_ERROR("Failed to store result: %s", mysql_error(sql));
+        return -1;
+    }
+
+    MYSQL_ROW row = mysql_fetch_row(res);
+    if (row)
+    {
+        stored->assign(row[0] ? row[0] : "");
+    }
+    mysql_free_result(res);
+    return row ? 1 : 0;
+}
+
+// 内存用户表：语义与 MySQL 版本一致（用户名不能重复，保存口令哈希）
+namespace
+{
+    std::mutex stubMtx;
+    std::unordered_map<std::string, std::string> stubUsers;
+}
+
+int HttpRequest::StubLookup_(std::string_view name, std::string *stored)
+{
+    std::lock_guard<std::mutex> lock(stubMtx);
+    auto it = stubUsers.find(std::string(name));
+    if (it == stubUsers.end())
+    {
+        return 0;
+    }
+    *stored = it->second;
+    return 1;
+}
+
+bool HttpRequest::StubAddUser_(std::string_view name, std::string_view credential)
+{
+    std::lock_guard<std::mutex> lock(stubMtx);
+    return stubUsers.emplace(std::string(name), std::string(credential)).second;
+}
+
+void HttpRequest::StubRegisterBatch(std::vector<RegisterBatcher::Registration *> &batch)
+{
+    for (RegisterBatcher::Registration *r : batch)
+    {
+        r->ok = !r->name.empty() && !r->pwd.empty() && StubAddUser_(r->name, r->pwd);
+    }
 }
 
 // 辅助函数：转换十六进制字符
@@ -399,25 +733,25 @@ int HttpRequest::ConverHex(char ch)
 }
 
 // 获取请求路径
-std::string HttpRequest::path() const
+std::string_view HttpRequest::path() const
 {
     return this->path_;
 }
 
 // 设置请求路径
-void HttpRequest::path(const std::string &path)
+void HttpRequest::path(std::string_view path)
 {
-    this->path_ = path;
+    this->path_.assign(path.data(), path.size());
 }
 
 // 获取请求方法（GET, POST等）
-std::string HttpRequest::method() const
+std::string_view HttpRequest::method() const
 {
     return this->method_;
 }
 
 // 获取请求版本
-std::string HttpRequest::version() const
+std::string_view HttpRequest::version() const
 {
     return this->version_;
 }
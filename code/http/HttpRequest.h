@@ -1,17 +1,23 @@
 #ifndef HTTP_REQUEST_H
 #define HTTP_REQUEST_H
 
+#include <atomic>
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>
-#include <sstream>
+#include <string_view>
+#include <memory_resource>
 #include <mysql/mysql.h> // MySQL 连接池支持
 #include "../buffer/Buffer.h"
 #include "../pool/SqlConnRAII.h"
 #include "../pool/SqlConnPool.h"
+#include "../pool/RequestArena.h"
+#include "../pool/RegisterBatcher.h"
+#include "../trace/Trace.h"
+#include "Router.h"
 
 
+class SessionTokens;
+
 class HttpRequest
 {
 public:
@@ -44,17 +50,17 @@ public:
     // 解析请求缓冲区
     bool parse(Buffer &buff);
 
-    // 获取请求路径
-    std::string path() const;
+    // 获取请求路径（视图在下一次 Init() 之前有效）
+    std::string_view path() const;
 
     // 设置请求路径
-    void path(const std::string& path);
+    void path(std::string_view path);
 
     // 获取请求方法（GET, POST等）
-    std::string method() const;
+    std::string_view method() const;
 
     // 获取请求版本
-    std::string version() const;
+    std::string_view version() const;
 
     // 获取POST请求表单中的参数
     std::string GetPost(const std::string &key) const;
@@ -62,6 +68,66 @@ public:
     // 检查是否为长连接
     bool IsKeepAlive() const;
 
+    // 是否已解析出一个完整请求
+    bool IsFinished() const { return state_ == FINISH; }
+
+    // 还没有开始解析新请求（等待请求行）
+    bool IsFresh() const { return state_ == REQUEST_LINE; }
+
+    // 查找请求头（名字不区分大小写），不存在时返回 false
+    bool FindHeader(std::string_view key, std::string_view &value) const;
+
+    // Accept-Encoding 是否接受 gzip（q=0 表示拒绝）
+    bool AcceptsGzip() const;
+
+    // 本次请求花在数据库上的时间（纳秒）
+    uint64_t DbNs() const { return dbNs_; }
+
+    // 需要在解析后执行的数据库操作，由路由处理函数设置
+    enum DbAction
+    {
+        DB_NONE,
+        DB_REGISTER,
+        DB_LOGIN,
+    };
+    // 注册先计算口令哈希再写库；登录先查库，再校验口令
+    void SetDbAction(DbAction action)
+    {
+        dbAction_ = action;
+        kdfAction_ = action == DB_REGISTER ? KDF_HASH : KDF_NONE;
+    }
+
+    // 解析完成后是否还需要访问数据库（登录/注册表单）
+    bool NeedsDb() const { return dbAction_ != DB_NONE; }
+
+    // 下一步是否为口令哈希计算；与 NeedsDb() 同时成立时先算哈希
+    bool NeedsKdf() const { return kdfAction_ != KDF_NONE; }
+
+    // 请求体是否为 URL 编码的表单
+    bool IsFormUrlencoded() const { return Header_("Content-Type") == "application/x-www-form-urlencoded"; }
+
+    // 执行数据库访问：注册写入用户，登录取出口令哈希留给 RunKdf()
+    void RunDb();
+
+    // 计算口令哈希：注册时生成哈希，登录时校验口令。CPU 密集，应在 PasswordHasher 的线程上执行
+    void RunKdf();
+
+    // 依次执行剩余的哈希与数据库步骤（不经过各自的线程池）
+    void RunPending();
+
+    // 本次请求要下发的 Set-Cookie 值，没有时为空；在下一次 Init() 前有效
+    std::string_view SetCookie() const { return setCookie_; }
+
+    // 验证 Cookie 中的会话令牌（不访问数据库），通过时 *user 为登录的用户名
+    bool SessionUser(std::string *user) const;
+
+    // 匹配到的协程处理函数，没有时为空；参数值指向 path()，在下一次 Init() 前有效
+    const Router::AsyncHandler *AsyncRoute() const { return asyncRoute_; }
+    const RouteParams &Params() const { return params_; }
+
+    // 关联所属连接的追踪记录，用于数据库阶段打点
+    void SetTrace(RequestTrace *trace) { trace_ = trace; }
+
     // 请求路径处理
     void ParsePath_();
 
@@ -71,35 +137,113 @@ public:
     // 解析URL编码的数据
     void ParseFromUrlencoded_();
 
-    // 用户验证（例如登录）
-    static bool UserVerify(const std::string &name, const std::string &pwd, bool isLogin);
+    // 查询用户保存的口令（哈希），-1 查询失败，0 用户不存在，1 找到
+    static int LookupPassword(std::string_view name, std::string *stored);
+
+    // 新增用户，credential 为口令哈希；用户名已存在或写入失败时返回 false
+    static bool AddUser(std::string_view name, std::string_view credential);
+
+    // 使用内存中的用户表代替 MySQL（压测时隔离数据库开销）
+    static void UseStubDb(bool enable) { stubDb_ = enable; }
+
+    // 注册请求交给批量提交，为空时逐条写入
+    static void SetRegisterBatcher(RegisterBatcher *batcher) { registerBatcher_ = batcher; }
+
+    // 内存用户表版本的批量注册，供 -s 模式下的 RegisterBatcher 使用
+    static void StubRegisterBatch(std::vector<RegisterBatcher::Registration *> &batch);
+
+    // 会话令牌的签发与验证，nullptr 表示不使用会话
+    static void SetSessionTokens(const SessionTokens *tokens) { sessionTokens_ = tokens; }
+
+    // 服务器排空连接期间所有响应都带 Connection: close
+    static void SetDraining(bool draining) { draining_.store(draining, std::memory_order_relaxed); }
+    static bool Draining() { return draining_.load(std::memory_order_relaxed); }
 
 private:
+    using String = std::pmr::string;
+    using StringMap = std::pmr::unordered_map<String, String>;
+
     // 解析请求行
-    bool ParseRequestLine_(const std::string &line);
+    bool ParseRequestLine_(std::string_view line);
 
     // 解析请求头
-    void ParseHeader_(const std::string &line);
+    void ParseHeader_(std::string_view line);
 
     // 解析请求体
-    void ParseBody_(const std::string &line);
+    void ParseBody_(std::string_view line);
+
+    // 请求完整后按方法和路径分发给注册的处理函数
+    void Route_();
 
     // 解析POST表单数据
     void ParseFormData_();
 
+    // 查找请求头，不存在时返回空视图
+    std::string_view Header_(const char *key) const;
+
+    // 查找表单参数，不存在时返回空视图
+    std::string_view Post_(const char *key) const;
+
     // 状态机的当前状态
     PARSE_STATE state_;
 
+    // 数据库访问耗时
+    uint64_t dbNs_;
+
+    // 待执行的数据库操作
+    DbAction dbAction_;
+
+    // 待执行的口令哈希计算
+    enum KdfAction
+    {
+        KDF_NONE,
+        KDF_HASH,   // 注册：为口令生成哈希
+        KDF_VERIFY, // 登录：用查到的哈希校验口令
+    };
+    KdfAction kdfAction_;
+    bool userFound_; // 登录的用户存在（不存在时仍用占位哈希校验一次，耗时与口令错误相同）
+
+    // 路由结果
+    const Router::AsyncHandler *asyncRoute_ = nullptr;
+    RouteParams params_;
+
+    // 所属连接的追踪记录，可能为空
+    RequestTrace *trace_ = nullptr;
+
+    // 请求体长度
+    size_t contentLength_;
+    bool hasContentLength_;
+    static constexpr size_t MAX_BODY_SIZE = 1 << 20;
+    static constexpr size_t MAX_LENGTH_DIGITS = 10; // Content-Length 的位数上限（允许少量前导 0）
+
+    // 请求级内存区，必须先于下面的 pmr 成员构造、后于它们析构
+    RequestArena arena_;
+
     // 请求方法、路径、版本、请求体
-    std::string method_, path_, version_, body_;
+    String method_, path_, version_, body_;
 
     // 请求头和POST表单参数
-    std::unordered_map<std::string, std::string> header_;
-    std::unordered_map<std::string, std::string> post_;
-
-    // 存放默认HTML资源
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
+    StringMap header_;
+    StringMap post_;
+
+    // 登录/注册成功后下发的 Cookie
+    String setCookie_;
+
+    // 注册时为口令哈希，登录时为库中保存的口令哈希
+    std::string credential_;
+
+    // 登录/注册结束：改写响应路径，成功时签发会话令牌
+    void Finish_(bool ok);
+
+    // 内存用户表版本的 LookupPassword / AddUser
+    static int StubLookup_(std::string_view name, std::string *stored);
+    static bool StubAddUser_(std::string_view name, std::string_view credential);
+    // 在给定连接上查询登录用户的口令
+    static int LoginQuery_(MYSQL *sql, std::string_view name, std::string *stored);
+    static bool stubDb_;
+    static std::atomic<bool> draining_;
+    static RegisterBatcher *registerBatcher_;
+    static const SessionTokens *sessionTokens_;
 
     // 辅助函数：转换十六进制字符
     static int ConverHex(char ch);
@@ -1,31 +1,31 @@
 #include "HttpResponse.h"
+#include "FileCache.h"
+#include <charconv> // to_chars
+#include <climits>  // PATH_MAX
+#include <cstring>
+#include "MimeType.h"
 
 // 静态成员初始化
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    {"html", "text/html"},
-    {"htm", "text/html"},
-    {"css", "text/css"},
-    {"js", "application/javascript"},
-    {"json", "application/json"},
-    {"jpg", "image/jpeg"},
-    {"jpeg", "image/jpeg"},
-    {"png", "image/png"},
-    {"gif", "image/gif"},
-    {"txt", "text/plain"},
-    {"xml", "application/xml"},
-    {"pdf", "application/pdf"}};
+bool HttpResponse::embedded = false;
+const FileCache *HttpResponse::fileCache = nullptr;
 
 const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
     {200, "OK"},
+    {304, "Not Modified"},
+    {400, "Bad Request"},
+    {403, "Forbidden"},
     {404, "Not Found"},
-    {500, "Internal Server Error"}};
+    {429, "Too Many Requests"},
+    {500, "Internal Server Error"},
+    {503, "Service Unavailable"}};
 
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     {404, "/404.html"},
     {500, "/500.html"}};
 
 HttpResponse::HttpResponse()
-    : code_(-1), isKeepAlive_(false), mmFile_(nullptr)
+    : code_(-1), isKeepAlive_(false), retryAfter_(0), chunked_(false), hasContent_(false), mmFile_(nullptr), mmFileStat_{},
+      static_(nullptr), gzip_(false)
 {
 }
 
@@ -34,27 +34,61 @@ HttpResponse::~HttpResponse()
     UnmapFile();
 }
 
-void HttpResponse::Init(const std::string &srcDir, const std::string &path, bool isKeepAlive, int code)
+void HttpResponse::Init(std::string_view srcDir, std::string_view path, bool isKeepAlive, int code)
 {
-    this->srcDir_ = srcDir;
+    UnmapFile(); // 释放上一次响应映射的文件
+    mmFileStat_ = {};
+    hasContent_ = false;
+    retryAfter_ = 0;
+    setCookie_ = {};
+    chunked_ = false;
+    static_ = nullptr;
+    gzip_ = false;
+
     this->path_ = path;
     this->isKeepAlive_ = isKeepAlive;
     this->code_ = code;
 
-    // 构建文件的绝对路径
-    std::string fullPath = srcDir + path;
-    int ret = stat(fullPath.c_str(), &mmFileStat_);
-    if (ret == -1)
+    if (embedded)
+    {
+        // 资源包是完整的只读部署，找不到即 404，不再回退到磁盘
+        static_ = AssetBundle::Find(path);
+        if (static_ == nullptr)
+        {
+            code_ = 404;
+        }
+        return;
+    }
+    if (fileCache != nullptr && (static_ = fileCache->Find(path)) != nullptr)
+    {
+        return;
+    }
+
+    // 在栈上拼接文件的绝对路径，避免每次请求分配 std::string
+    char fullPath[PATH_MAX];
+    if (srcDir.size() + path.size() >= sizeof(fullPath))
+    {
+        code_ = 404;
+        return;
+    }
+    memcpy(fullPath, srcDir.data(), srcDir.size());
+    memcpy(fullPath + srcDir.size(), path.data(), path.size());
+    fullPath[srcDir.size() + path.size()] = '\0';
+
+    int ret = stat(fullPath, &mmFileStat_);
+    if (ret == -1 || S_ISDIR(mmFileStat_.st_mode))
     {
         // 文件不存在
+        mmFileStat_ = {};
         code_ = 404;
         return;
     }
 
     // 使用 mmap 映射文件
-    int fd = open(fullPath.c_str(), O_RDONLY);
+    int fd = open(fullPath, O_RDONLY);
     if (fd == -1)
     {
+        mmFileStat_ = {};
         code_ = 500;
         return;
     }
@@ -63,10 +97,28 @@ void HttpResponse::Init(const std::string &srcDir, const std::string &path, bool
     if (mmFile_ == MAP_FAILED)
     {
         mmFile_ = nullptr;
+        mmFileStat_ = {};
         code_ = 500;
     }
 }
 
+void HttpResponse::InitContent(std::string_view contentType, std::string content, bool isKeepAlive, int code)
+{
+    UnmapFile();
+    mmFileStat_ = {};
+    path_ = {};
+    retryAfter_ = 0;
+    setCookie_ = {};
+    chunked_ = false;
+    static_ = nullptr;
+    gzip_ = false;
+    hasContent_ = true;
+    contentType_ = contentType;
+    content_ = std::move(content);
+    isKeepAlive_ = isKeepAlive;
+    code_ = code;
+}
+
 void HttpResponse::MakeResponse(Buffer &buff)
 {
     if (code_ == -1)
@@ -75,10 +127,23 @@ void HttpResponse::MakeResponse(Buffer &buff)
         code_ = 200;
     }
 
-    // 构建响应
+    // 构建响应；响应体不拷贝进 buff，由调用者通过 Body()/BodyLen() 以 writev 发送
     AddStateLine_(buff);
-    AddHeader_(buff);
-    AddContent_(buff);
+    if (hasContent_)
+    {
+        AddHeader_(buff, content_.size());
+    }
+    else if (code_ == 200 || code_ == 304)
+    {
+        AddHeader_(buff, BodyLen());
+    }
+    else
+    {
+        UnmapFile();
+        mmFileStat_ = {};
+        static_ = nullptr;
+        AddContent_(buff);
+    }
 }
 
 void HttpResponse::UnmapFile()
@@ -100,59 +165,166 @@ size_t HttpResponse::FileLen() const
     return mmFileStat_.st_size;
 }
 
-void HttpResponse::ErrorContent(Buffer &buff, const std::string &message)
+void HttpResponse::Negotiate(bool acceptGzip, std::string_view ifNoneMatch)
+{
+    if (static_ == nullptr || code_ != 200)
+    {
+        return;
+    }
+    gzip_ = acceptGzip && !static_->gzip.empty();
+    std::string_view etag = gzip_ ? static_->gzipEtag : static_->etag;
+    if (!ifNoneMatch.empty() && (ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string_view::npos))
+    {
+        code_ = 304;
+    }
+}
+
+const char *HttpResponse::Body() const
+{
+    if (hasContent_)
+        return content_.data();
+    if (static_ != nullptr)
+        return (gzip_ ? static_->gzip : static_->data).data();
+    return mmFile_;
+}
+
+size_t HttpResponse::BodyLen() const
+{
+    if (hasContent_)
+        return content_.size();
+    if (static_ != nullptr)
+        return code_ == 304 ? 0 : (gzip_ ? static_->gzip : static_->data).size();
+    return FileLen();
+}
+
+void HttpResponse::Release()
 {
-    std::string body = "<html><body><h1>" + message + "</h1></body></html>";
-    buff.append(body);
+    UnmapFile();
+    static_ = nullptr;
+    gzip_ = false;
+    mmFileStat_ = {};
+    hasContent_ = false;
+    std::string().swap(content_);
 }
 
-std::string HttpResponse::GetFileType_()
+std::shared_ptr<const char> HttpResponse::PinBody()
 {
-    size_t pos = path_.find_last_of('.');
-    if (pos == std::string::npos)
-        return "text/plain"; // 默认类型为 text/plain
+    if (hasContent_)
+    {
+        auto owner = std::make_shared<std::string>(std::move(content_));
+        content_.clear();
+        return std::shared_ptr<const char>(owner, owner->data());
+    }
+    if (static_ != nullptr)
+    {
+        return std::shared_ptr<const char>(Body(), [](const char *) {}); // 只读段与缓存都与进程同寿命
+    }
+    if (mmFile_ == nullptr)
+    {
+        return nullptr;
+    }
+    size_t len = mmFileStat_.st_size;
+    std::shared_ptr<const char> owner(mmFile_, [len](const char *p)
+                                      { munmap(const_cast<char *>(p), len); });
+    mmFile_ = nullptr; // 映射交给 owner，UnmapFile() 不再处理
+    return owner;
+}
 
-    std::string extension = path_.substr(pos + 1);
-    auto it = SUFFIX_TYPE.find(extension);
-    return it != SUFFIX_TYPE.end() ? it->second : "text/plain"; // 查找文件类型
+void HttpResponse::ErrorContent(Buffer &buff, std::string_view message)
+{
+    static constexpr std::string_view head = "<html><body><h1>";
+    static constexpr std::string_view tail = "</h1></body></html>";
+    AddHeader_(buff, head.size() + message.size() + tail.size());
+    buff.append(head);
+    buff.append(message);
+    buff.append(tail);
+}
+
+std::string_view HttpResponse::GetFileType_() const
+{
+    return static_ != nullptr ? static_->mime : Mime::FromPath(path_);
 }
 
 void HttpResponse::AddStateLine_(Buffer &buff)
 {
+    auto status = CODE_STATUS.find(code_);
+    if (status == CODE_STATUS.end())
+    {
+        code_ = 500;
+        status = CODE_STATUS.find(code_);
+    }
+
+    char num[16];
+    auto res = std::to_chars(num, num + sizeof(num), code_);
     buff.append("HTTP/1.1 ");
-    buff.append(std::to_string(code_));
+    buff.append(num, res.ptr - num);
     buff.append(" ");
-    buff.append(CODE_STATUS.at(code_));
+    buff.append(status->second);
     buff.append("\r\n");
 }
 
-void HttpResponse::AddHeader_(Buffer &buff)
+void HttpResponse::AddHeader_(Buffer &buff, size_t contentLen)
 {
     buff.append("Connection: ");
     buff.append(isKeepAlive_ ? "keep-alive" : "close");
     buff.append("\r\n");
 
+    if (retryAfter_ > 0)
+    {
+        char sec[16];
+        auto res = std::to_chars(sec, sec + sizeof(sec), retryAfter_);
+        buff.append("Retry-After: ");
+        buff.append(sec, res.ptr - sec);
+        buff.append("\r\n");
+    }
+
+    if (!setCookie_.empty())
+    {
+        buff.append("Set-Cookie: ");
+        buff.append(setCookie_);
+        buff.append("\r\n");
+    }
+
+    if (static_ != nullptr)
+    {
+        buff.append("ETag: ");
+        buff.append(gzip_ ? static_->gzipEtag : static_->etag);
+        buff.append("\r\n");
+        if (!static_->gzip.empty())
+        {
+            buff.append("Vary: Accept-Encoding\r\n");
+        }
+        if (code_ == 304)
+        {
+            buff.append("\r\n"); // 304 没有响应体，也不带 Content-Type/Content-Length
+            return;
+        }
+        if (gzip_)
+        {
+            buff.append("Content-Encoding: gzip\r\n");
+        }
+    }
+
+    std::string_view type = hasContent_ ? contentType_ : (code_ == 200 ? GetFileType_() : "text/html");
     buff.append("Content-Type: ");
-    buff.append(GetFileType_());
+    buff.append(type);
     buff.append("\r\n");
 
-    if (code_ == 200)
+    if (chunked_)
     {
-        buff.append("Content-Length: ");
-        buff.append(std::to_string(FileLen()));
-        buff.append("\r\n");
+        buff.append("Transfer-Encoding: chunked\r\n\r\n");
+        return;
     }
+
+    char num[24];
+    auto res = std::to_chars(num, num + sizeof(num), contentLen);
+    buff.append("Content-Length: ");
+    buff.append(num, res.ptr - num);
+    buff.append("\r\n");
     buff.append("\r\n");
 }
 
 void HttpResponse::AddContent_(Buffer &buff)
 {
-    if (code_ == 404 || code_ == 500)
-    {
-        ErrorContent(buff, "Something went wrong!");
-    }
-    else
-    {
-        buff.append(mmFile_, FileLen());
-    }
+    ErrorContent(buff, "Something went wrong!");
 }
@@ -2,11 +2,16 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <memory>
+#include <string_view>
 #include <fcntl.h>    // open
 #include <unistd.h>   // close
 #include <sys/stat.h> // stat
 #include <sys/mman.h> // mmap, munmap
 #include "../buffer/Buffer.h"
+#include "AssetBundle.h"
+
+class FileCache;
 
 class HttpResponse
 {
@@ -14,31 +19,79 @@ public:
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std::string &srcDir, const std::string &path, bool isKeepAlive = false, int code = -1);
+    // path 只在本次响应期间被引用，调用者需保证其在 MakeResponse() 之前有效
+    // 启用内嵌资源时只在资源包中查找，不访问文件系统；否则先查预热的文件缓存，未命中才 stat/open/mmap
+    void Init(std::string_view srcDir, std::string_view path, bool isKeepAlive = false, int code = -1);
+
+    // 以内存中生成的内容作为响应体（不访问文件系统）
+    void InitContent(std::string_view contentType, std::string content, bool isKeepAlive = false, int code = 200);
+    // 预先准备好的静态文件（内嵌资源或缓存）按请求头协商：客户端接受 gzip 时改用预压缩版本，If-None-Match 命中 ETag 时改为 304
+    void Negotiate(bool acceptGzip, std::string_view ifNoneMatch);
+
     void MakeResponse(Buffer &buff);
     void UnmapFile();
+
+    // 释放文件映射与内存内容，连接空闲时调用
+    void Release();
     char *File();
     size_t FileLen() const;
-    void ErrorContent(Buffer &buff, const std::string &message);
+
+    // 响应体（文件映射或内存内容），由调用者与 MakeResponse() 生成的头部一起发送
+    const char *Body() const;
+    size_t BodyLen() const;
+
+    // 把响应体的所有权转移出去，返回的指针即响应体地址；之后的 Init 不再释放它。
+    // 用于零拷贝发送：内核确认之前响应体必须保持有效且不被修改。
+    std::shared_ptr<const char> PinBody();
+    void ErrorContent(Buffer &buff, std::string_view message);
     int Code() const { return code_; }
 
+    // 响应头部中的 Connection 是否为 keep-alive；拒绝响应（400/429/503）总是 close
+    bool IsKeepAlive() const { return isKeepAlive_; }
+
+    // 附加 Retry-After 头部（秒），0 表示不附加；Init 时清除
+    void SetRetryAfter(int sec) { retryAfter_ = sec; }
+
+    // 附加 Set-Cookie 头部，为空时不附加；cookie 须在 MakeResponse() 之前有效，Init 时清除
+    void SetCookie(std::string_view cookie) { setCookie_ = cookie; }
+
+    // 以 chunked 编码发送响应体（用 Transfer-Encoding 代替 Content-Length），响应体由调用者分块写出；Init 时清除
+    void SetChunked(bool chunked) { chunked_ = chunked; }
+
+    // 静态文件是否从内嵌资源包提供（资源包为空时无效）
+    static void UseEmbedded(bool enable) { embedded = enable && AssetBundle::Count() > 0; }
+    static bool Embedded() { return embedded; }
+
+    // 磁盘模式下使用的预热缓存，nullptr 表示不使用
+    static void SetFileCache(const FileCache *cache) { fileCache = cache; }
+
 private:
     void AddStateLine_(Buffer &buff);
-    void AddHeader_(Buffer &buff);
+    void AddHeader_(Buffer &buff, size_t contentLen);
     void AddContent_(Buffer &buff);
 
-    std::string GetFileType_();
+    std::string_view GetFileType_() const;
 
     int code_;
     bool isKeepAlive_;
+    int retryAfter_;
+    std::string_view setCookie_;
+    bool chunked_;
+
+    std::string_view path_;
 
-    std::string path_;
-    std::string srcDir_;
+    bool hasContent_;              // 是否为内存内容响应
+    std::string_view contentType_; // 内存内容的类型（须指向静态字符串）
+    std::string content_;          // 内存内容
 
     char *mmFile_;
     struct stat mmFileStat_;
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
+    const StaticFile *static_; // 内嵌资源或缓存的文件，为空时响应体来自文件映射
+    bool gzip_;                // 发送 static_ 的 gzip 版本
+
+    static bool embedded;
+    static const FileCache *fileCache;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
 };
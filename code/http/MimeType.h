@@ -0,0 +1,59 @@
+#ifndef MIME_TYPE_H
+#define MIME_TYPE_H
+
+#include <string_view>
+#include <utility>
+
+/*
+ * 文件后缀到 MIME 类型的映射
+ * 服务器按它填写 Content-Type，资源打包工具（assetpack）用同一张表生成内嵌资源的索引。
+ */
+namespace Mime
+{
+    inline constexpr std::pair<std::string_view, std::string_view> SUFFIX_TYPE[] = {
+        {"html", "text/html"},
+        {"htm", "text/html"},
+        {"css", "text/css"},
+        {"js", "application/javascript"},
+        {"json", "application/json"},
+        {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"png", "image/png"},
+        {"gif", "image/gif"},
+        {"svg", "image/svg+xml"},
+        {"ico", "image/x-icon"},
+        {"txt", "text/plain"},
+        {"xml", "application/xml"},
+        {"pdf", "application/pdf"},
+        {"woff", "font/woff"},
+        {"woff2", "font/woff2"},
+        {"ttf", "font/ttf"},
+        {"otf", "font/otf"},
+        {"eot", "application/vnd.ms-fontobject"},
+    };
+
+    // 按路径后缀查找类型，未知后缀为 text/plain
+    constexpr std::string_view FromPath(std::string_view path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string_view::npos)
+            return "text/plain";
+        std::string_view suffix = path.substr(dot + 1);
+        for (const auto &entry : SUFFIX_TYPE)
+        {
+            if (entry.first == suffix)
+                return entry.second;
+        }
+        return "text/plain";
+    }
+
+    // 值得预压缩的类型：文本类和未压缩的字体（woff/woff2 与图片本身已压缩）
+    constexpr bool Compressible(std::string_view type)
+    {
+        return type.substr(0, 5) == "text/" || type == "application/javascript" || type == "application/json" ||
+               type == "application/xml" || type == "image/svg+xml" || type == "image/x-icon" ||
+               type == "font/ttf" || type == "font/otf" || type == "application/vnd.ms-fontobject";
+    }
+}
+
+#endif // MIME_TYPE_H
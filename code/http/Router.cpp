@@ -0,0 +1,234 @@
+#include "Router.h"
+#include "HttpRequest.h"
+#include "../log/Log.h"
+
+namespace
+{
+    // 静态别名：请求路径 -> 实际文件
+    constexpr std::string_view ALIAS_KEYS[] = {
+        "/",
+        "/index",
+        "/register",
+        "/login",
+        "/welcome",
+        "/video",
+        "/picture",
+    };
+    constexpr std::string_view ALIAS_TARGETS[] = {
+        "/index.html",
+        "/index.html",
+        "/register.html",
+        "/login.html",
+        "/welcome.html",
+        "/video.html",
+        "/picture.html",
+    };
+    static_assert(sizeof(ALIAS_KEYS) == sizeof(ALIAS_TARGETS), "alias table mismatch");
+
+    constexpr PerfectHash<sizeof(ALIAS_KEYS) / sizeof(ALIAS_KEYS[0])> ALIASES(ALIAS_KEYS);
+    static_assert(ALIASES.Find("/login") == 3 && ALIASES.Find("/nope") == -1, "perfect hash built at compile time");
+
+    size_t CommonPrefix(std::string_view a, std::string_view b)
+    {
+        size_t n = std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < n && a[i] == b[i])
+            ++i;
+        return i;
+    }
+}
+
+Router *Router::Instance()
+{
+    static Router instance;
+    return &instance;
+}
+
+Router::Router() : root_(std::make_unique<Node>())
+{
+    // 内置路由：登录/注册表单交给数据库处理
+    Add(POST, "/register.html", [](HttpRequest &req, const RouteParams &)
+        {
+            if (req.IsFormUrlencoded())
+                req.SetDbAction(HttpRequest::DB_REGISTER); });
+    Add(POST, "/login.html", [](HttpRequest &req, const RouteParams &)
+        {
+            if (req.IsFormUrlencoded())
+                req.SetDbAction(HttpRequest::DB_LOGIN); });
+    // 已持有有效会话的用户打开登录页时直接进入欢迎页，只验证令牌，不访问数据库
+    Add(GET, "/login.html", [](HttpRequest &req, const RouteParams &)
+        {
+            std::string user;
+            if (req.SessionUser(&user))
+                req.path("/welcome.html"); });
+}
+
+std::string_view Router::Alias(std::string_view path)
+{
+    int idx = ALIASES.Find(path);
+    return idx < 0 ? std::string_view() : ALIAS_TARGETS[idx];
+}
+
+Router::Method Router::ParseMethod(std::string_view method)
+{
+    if (method == "GET")
+        return GET;
+    if (method == "POST")
+        return POST;
+    if (method == "HEAD")
+        return HEAD;
+    if (method == "PUT")
+        return PUT;
+    if (method == "DELETE")
+        return DELETE;
+    return METHOD_COUNT;
+}
+
+Router::Node *Router::Insert_(Node *node, std::string_view literal)
+{
+    while (!literal.empty())
+    {
+        Node *next = nullptr;
+        for (auto &child : node->children)
+        {
+            if (child->prefix[0] == literal[0])
+            {
+                next = child.get();
+                size_t common = CommonPrefix(child->prefix, literal);
+                if (common < child->prefix.size())
+                {
+                    // 拆分边：公共部分成为新的中间节点，原节点挂在其下
+                    auto mid = std::make_unique<Node>();
+                    mid->prefix = child->prefix.substr(0, common);
+                    child->prefix.erase(0, common);
+                    mid->children.push_back(std::move(child));
+                    child = std::move(mid);
+                    next = child.get();
+                }
+                literal.remove_prefix(common);
+                break;
+            }
+        }
+        if (next == nullptr)
+        {
+            auto leaf = std::make_unique<Node>();
+            leaf->prefix = std::string(literal);
+            next = leaf.get();
+            node->children.push_back(std::move(leaf));
+            literal = {};
+        }
+        node = next;
+    }
+    return node;
+}
+
+void Router::Add(Method method, std::string_view pattern, Handler handler)
+{
+    Node_(method, pattern).handler = std::move(handler);
+}
+
+void Router::AddAsync(Method method, std::string_view pattern, AsyncHandler handler)
+{
+    Node_(method, pattern).async = std::move(handler);
+}
+
+Router::Route &Router::Node_(Method method, std::string_view pattern)
+{
+    Node *node = root_.get();
+    size_t pos = 0;
+    while (pos < pattern.size())
+    {
+        if (pattern[pos] == ':')
+        {
+            size_t end = pattern.find('/', pos);
+            std::string_view name = pattern.substr(pos + 1, end == std::string_view::npos ? end : end - pos - 1);
+            if (!node->param)
+            {
+                node->param = std::make_unique<Node>();
+                node->paramName = std::string(name);
+            }
+            else if (node->paramName != name)
+            {
+                LOG_WARN("route %.*s: parameter :%.*s reuses :%s", static_cast<int>(pattern.size()), pattern.data(),
+                         static_cast<int>(name.size()), name.data(), node->paramName.c_str());
+            }
+            node = node->param.get();
+            pos = end == std::string_view::npos ? pattern.size() : end;
+        }
+        else if (pattern[pos] == '*')
+        {
+            if (!node->wildcard)
+            {
+                node->wildcard = std::make_unique<Node>();
+            }
+            node = node->wildcard.get();
+            break;
+        }
+        else
+        {
+            size_t end = pattern.find_first_of(":*", pos);
+            end = end == std::string_view::npos ? pattern.size() : end;
+            node = Insert_(node, pattern.substr(pos, end - pos));
+            pos = end;
+        }
+    }
+    return node->routes[method];
+}
+
+const Router::Node *Router::Lookup_(const Node *node, std::string_view path, RouteParams &params, Method method)
+{
+    if (path.empty())
+    {
+        if (!node->routes[method].Empty())
+            return node;
+        // "/static/*" 也匹配 "/static/"
+        if (node->wildcard && !node->wildcard->routes[method].Empty())
+            return node->wildcard.get();
+        return nullptr;
+    }
+
+    // 优先级：字面量 > 参数段 > 通配
+    for (const auto &child : node->children)
+    {
+        if (child->prefix[0] == path[0])
+        {
+            if (path.compare(0, child->prefix.size(), child->prefix) == 0)
+            {
+                if (const Node *found = Lookup_(child.get(), path.substr(child->prefix.size()), params, method))
+                    return found;
+            }
+            break; // 首字符互不相同，最多一个候选
+        }
+    }
+
+    if (node->param && params.count < RouteParams::MAX_PARAMS && path[0] != '/')
+    {
+        size_t end = std::min(path.find('/'), path.size());
+        params.names[params.count] = node->paramName;
+        params.values[params.count] = path.substr(0, end);
+        ++params.count;
+        if (const Node *found = Lookup_(node->param.get(), path.substr(end), params, method))
+            return found;
+        --params.count;
+    }
+
+    if (node->wildcard && !node->wildcard->routes[method].Empty() && params.count < RouteParams::MAX_PARAMS)
+    {
+        params.names[params.count] = "*";
+        params.values[params.count] = path;
+        ++params.count;
+        return node->wildcard.get();
+    }
+    return nullptr;
+}
+
+const Router::Route *Router::Match(Method method, std::string_view path, RouteParams &params) const
+{
+    if (method >= METHOD_COUNT)
+    {
+        return nullptr;
+    }
+    params.count = 0;
+    const Node *node = Lookup_(root_.get(), path, params, method);
+    return node ? &node->routes[method] : nullptr;
+}
@@ -0,0 +1,174 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../coro/Task.h"
+
+class HttpRequest;
+class CoContext;
+
+/*
+ * 编译期完美哈希：给定一组互不相同的 key，在编译期搜索一个种子，使所有 key 落在不同的槽里。
+ * 查找时只算一次哈希、做一次字符串比较。
+ */
+template <size_t N>
+class PerfectHash
+{
+public:
+    static constexpr size_t SIZE = [] {
+        size_t size = 1;
+        while (size < 2 * N)
+            size <<= 1;
+        return size;
+    }();
+
+    constexpr explicit PerfectHash(const std::string_view (&keys)[N]) : keys_{}, slots_{}, seed_(0)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            keys_[i] = keys[i];
+        }
+        for (uint32_t seed = 1;; ++seed)
+        {
+            for (size_t s = 0; s < SIZE; ++s)
+            {
+                slots_[s] = 0;
+            }
+            bool ok = true;
+            for (size_t i = 0; i < N && ok; ++i)
+            {
+                size_t slot = Hash(keys_[i], seed) & (SIZE - 1);
+                ok = slots_[slot] == 0;
+                slots_[slot] = static_cast<uint8_t>(i + 1);
+            }
+            if (ok)
+            {
+                seed_ = seed;
+                return;
+            }
+        }
+    }
+
+    // 返回 key 的下标，不存在时返回 -1
+    constexpr int Find(std::string_view key) const
+    {
+        uint8_t slot = slots_[Hash(key, seed_) & (SIZE - 1)];
+        return (slot != 0 && keys_[slot - 1] == key) ? slot - 1 : -1;
+    }
+
+    static constexpr uint32_t Hash(std::string_view key, uint32_t seed)
+    {
+        // FNV-1a，种子混入初始值
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (char ch : key)
+        {
+            h = (h ^ static_cast<uint8_t>(ch)) * 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+private:
+    static_assert(N < 255, "too many keys");
+    std::string_view keys_[N];
+    uint8_t slots_[SIZE];
+    uint32_t seed_;
+};
+
+// 路径参数，如 "/user/:id" 匹配 "/user/42" 后得到 id=42；值指向请求路径，不拷贝
+struct RouteParams
+{
+    static constexpr int MAX_PARAMS = 8;
+    std::string_view names[MAX_PARAMS];
+    std::string_view values[MAX_PARAMS];
+    int count = 0;
+
+    std::string_view Get(std::string_view name) const
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (names[i] == name)
+                return values[i];
+        }
+        return {};
+    }
+};
+
+/*
+ * 请求路由
+ * 1. 静态别名（"/" -> "/index.html" 等）放在编译期生成的完美哈希表里；
+ * 2. 注册的处理函数按"方法 + 路由"存放在基数树中，支持精确路径、":name" 参数段和 "*" 前缀匹配，
+ *    查找只按字符顺序走一遍路径，与已注册路由的数量无关。
+ * 路由表在启动时注册，之后只读，多个工作线程并发查找无需加锁。
+ */
+class Router
+{
+public:
+    enum Method
+    {
+        GET,
+        POST,
+        HEAD,
+        PUT,
+        DELETE,
+        METHOD_COUNT,
+    };
+
+    // 同步处理函数：在工作线程上解析完请求后立即调用，可改写路径、设置数据库操作
+    using Handler = std::function<void(HttpRequest &, const RouteParams &)>;
+
+    // 协程处理函数：在 reactor 线程上运行，自行生成响应，可以 co_await 读写、定时器和数据库查询
+    using AsyncHandler = std::function<Task<void>(CoContext &)>;
+
+    // 一个方法 + 路由上注册的处理函数
+    struct Route
+    {
+        Handler handler;
+        AsyncHandler async;
+        bool Empty() const { return !handler && !async; }
+    };
+
+    static Router *Instance();
+
+    // 静态别名：路径完全匹配时返回改写后的路径，否则返回空视图
+    static std::string_view Alias(std::string_view path);
+
+    // 方法字符串转枚举，未知方法返回 METHOD_COUNT
+    static Method ParseMethod(std::string_view method);
+
+    // 注册处理函数。pattern 以 '/' 开头，可以包含 ":name" 参数段，以 "*" 结尾表示前缀匹配
+    void Add(Method method, std::string_view pattern, Handler handler);
+    void AddAsync(Method method, std::string_view pattern, AsyncHandler handler);
+
+    // 查找处理函数，找不到时返回空指针
+    const Route *Match(Method method, std::string_view path, RouteParams &params) const;
+
+private:
+    Router();
+
+    // 基数树节点：边上保存一段字面量；参数段与通配段作为特殊子节点
+    struct Node
+    {
+        std::string prefix;                       // 本节点对应的字面量片段
+        std::vector<std::unique_ptr<Node>> children; // 字面量子节点，首字符互不相同
+        std::unique_ptr<Node> param;              // ":name" 子节点，匹配到下一个 '/' 为止
+        std::string paramName;
+        std::unique_ptr<Node> wildcard;           // "*" 子节点，匹配剩余全部路径
+        Route routes[METHOD_COUNT];
+    };
+
+    Route &Node_(Method method, std::string_view pattern);
+    static Node *Insert_(Node *node, std::string_view literal);
+    static const Node *Lookup_(const Node *node, std::string_view path, RouteParams &params, Method method);
+
+    std::unique_ptr<Node> root_;
+};
+
+#endif // ROUTER_H
@@ -0,0 +1,238 @@
+#include "Session.h"
+#include "../webserver/OptionParse.h"
+#include "../log/Log.h"
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+namespace
+{
+    constexpr char B64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    // base64url 编码（不补 '='），Cookie 值中可以直接使用
+    void AppendBase64Url(std::string &out, const unsigned char *data, size_t len)
+    {
+        uint32_t acc = 0;
+        int bits = 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            acc = (acc << 8) | data[i];
+            bits += 8;
+            while (bits >= 6)
+            {
+                bits -= 6;
+                out += B64URL[(acc >> bits) & 0x3f];
+            }
+        }
+        if (bits > 0)
+        {
+            out += B64URL[(acc << (6 - bits)) & 0x3f];
+        }
+    }
+
+    bool DecodeBase64Url(std::string_view in, std::string &out)
+    {
+        uint32_t acc = 0;
+        int bits = 0;
+        for (char ch : in)
+        {
+            int v;
+            if (ch >= 'A' && ch <= 'Z')
+                v = ch - 'A';
+            else if (ch >= 'a' && ch <= 'z')
+                v = ch - 'a' + 26;
+            else if (ch >= '0' && ch <= '9')
+                v = ch - '0' + 52;
+            else if (ch == '-')
+                v = 62;
+            else if (ch == '_')
+                v = 63;
+            else
+                return false;
+            acc = (acc << 6) | v;
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                out += static_cast<char>((acc >> bits) & 0xff);
+            }
+        }
+        return true;
+    }
+
+    bool ParseInt(std::string_view text, int64_t &value)
+    {
+        auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+        return res.ec == std::errc() && res.ptr == text.data() + text.size();
+    }
+}
+
+bool SessionOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "on")
+        return OptionParse::Flag(value, enabled);
+    if (name == "cookie")
+        return OptionParse::String(value, cookie);
+    if (name == "ttl")
+        return OptionParse::Number<int64_t>(value, ttlSec, 1);
+    if (name == "rotate")
+        return OptionParse::Number<int64_t>(value, rotateSec, 1);
+    if (name == "keyfile")
+        return OptionParse::String(value, keyFile);
+    if (name == "secure")
+        return OptionParse::Flag(value, secure);
+    return false;
+}
+
+SessionTokens::SessionTokens(const Options &options)
+    : options_(options), keepEpochs_((options.ttlSec + options.rotateSec - 1) / options.rotateSec)
+{
+    bool loaded = false;
+    if (!options_.secret.empty())
+    {
+        unsigned int len = 0;
+        EVP_Digest(options_.secret.data(), options_.secret.size(), master_, &len, EVP_sha256(), nullptr);
+        OPENSSL_cleanse(options_.secret.data(), options_.secret.size());
+        loaded = true;
+    }
+    else if (!options_.keyFile.empty())
+    {
+        std::ifstream in(options_.keyFile, std::ios::binary);
+        std::string secret((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (secret.size() >= KEY_BYTES)
+        {
+            // 任意长度的密钥文件压缩为固定长度的主密钥
+            unsigned int len = 0;
+            EVP_Digest(secret.data(), secret.size(), master_, &len, EVP_sha256(), nullptr);
+            OPENSSL_cleanse(secret.data(), secret.size());
+            loaded = true;
+        }
+        else
+        {
+            LOG_ERROR("session key file %s is missing or shorter than %zu bytes, using a random key",
+                      options_.keyFile.c_str(), KEY_BYTES);
+        }
+    }
+    if (!loaded && RAND_bytes(master_, KEY_BYTES) != 1)
+    {
+        LOG_ERROR("cannot generate a random session key");
+    }
+    LOG_INFO("session tokens: cookie=%s ttl=%lds rotate=%lds key=%s", options_.cookie.c_str(),
+             (long)options_.ttlSec, (long)options_.rotateSec, !loaded ? "random" : options_.keyFile.empty() ? "shared" : options_.keyFile.c_str());
+}
+
+void SessionTokens::EpochKey_(int64_t epoch, unsigned char *key) const
+{
+    char label[32];
+    auto res = std::to_chars(label, label + sizeof(label), epoch);
+    unsigned int len = 0;
+    HMAC(EVP_sha256(), master_, KEY_BYTES, reinterpret_cast<unsigned char *>(label), res.ptr - label, key, &len);
+}
+
+void SessionTokens::Sign_(int64_t epoch, std::string_view payload, unsigned char *mac) const
+{
+    unsigned char key[KEY_BYTES];
+    EpochKey_(epoch, key);
+    unsigned int len = 0;
+    HMAC(EVP_sha256(), key, KEY_BYTES, reinterpret_cast<const unsigned char *>(payload.data()), payload.size(), mac, &len);
+    OPENSSL_cleanse(key, sizeof(key));
+}
+
+std::string SessionTokens::Issue(std::string_view user) const
+{
+    int64_t now = time(nullptr);
+    int64_t epoch = now / options_.rotateSec;
+
+    std::string cookie = options_.cookie;
+    cookie += '=';
+    size_t start = cookie.size();
+    cookie += std::to_string(epoch);
+    cookie += '.';
+    cookie += std::to_string(now + options_.ttlSec);
+    cookie += '.';
+    AppendBase64Url(cookie, reinterpret_cast<const unsigned char *>(user.data()), user.size());
+
+    unsigned char mac[KEY_BYTES];
+    Sign_(epoch, std::string_view(cookie).substr(start), mac);
+    cookie += '.';
+    AppendBase64Url(cookie, mac, sizeof(mac));
+
+    cookie += "; Path=/; Max-Age=";
+    cookie += std::to_string(options_.ttlSec);
+    cookie += "; HttpOnly; SameSite=Lax";
+    if (options_.secure)
+    {
+        cookie += "; Secure";
+    }
+    return cookie;
+}
+
+bool SessionTokens::Verify(std::string_view cookieHeader, std::string *user) const
+{
+    // 在 "a=1; sid=...; b=2" 中找到本服务的 Cookie
+    std::string_view token;
+    while (!cookieHeader.empty())
+    {
+        size_t semi = cookieHeader.find(';');
+        std::string_view item = cookieHeader.substr(0, semi);
+        cookieHeader = semi == std::string_view::npos ? std::string_view() : cookieHeader.substr(semi + 1);
+        while (!item.empty() && item.front() == ' ')
+            item.remove_prefix(1);
+        if (item.size() > options_.cookie.size() && item[options_.cookie.size()] == '=' &&
+            item.compare(0, options_.cookie.size(), options_.cookie) == 0)
+        {
+            token = item.substr(options_.cookie.size() + 1);
+            break;
+        }
+    }
+
+    size_t dot1 = token.find('.');
+    size_t dot2 = dot1 == std::string_view::npos ? dot1 : token.find('.', dot1 + 1);
+    size_t dot3 = token.rfind('.');
+    if (dot2 == std::string_view::npos || dot3 <= dot2)
+    {
+        return false;
+    }
+    int64_t epoch, expires;
+    if (!ParseInt(token.substr(0, dot1), epoch) || !ParseInt(token.substr(dot1 + 1, dot2 - dot1 - 1), expires))
+    {
+        return false;
+    }
+    int64_t now = time(nullptr);
+    int64_t current = now / options_.rotateSec;
+    if (epoch > current || current - epoch > keepEpochs_)
+    {
+        return false; // 未来的或已轮换出去的密钥
+    }
+
+    std::string mac;
+    if (!DecodeBase64Url(token.substr(dot3 + 1), mac) || mac.size() != KEY_BYTES)
+    {
+        return false;
+    }
+    unsigned char expected[KEY_BYTES];
+    Sign_(epoch, token.substr(0, dot3), expected);
+    if (CRYPTO_memcmp(expected, mac.data(), KEY_BYTES) != 0)
+    {
+        return false;
+    }
+    if (expires <= now)
+    {
+        return false;
+    }
+
+    user->clear();
+    return DecodeBase64Url(token.substr(dot2 + 1, dot3 - dot2 - 1), *user) && !user->empty();
+}
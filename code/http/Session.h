@@ -0,0 +1,48 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "SessionOptions.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+ * 无状态会话令牌
+ * 登录/注册成功后发放 Cookie：<纪元>.<过期时间>.<用户名(base64url)>.<HMAC-SHA256(base64url)>，
+ * 之后的请求只需重算 HMAC 并做常数时间比较即可确认身份，不访问数据库，服务端也不保存会话。
+ * 签名密钥按纪元（rotate 秒）轮换：第 e 个纪元的密钥为 HMAC(主密钥, e)，
+ * 令牌里带着签发时的纪元，有效期内仍能用旧纪元的密钥验证。
+ * 主密钥从 keyfile 读取时，热升级后的新进程与旧进程签发的令牌互相通用；未配置时启动时随机生成
+ * （多进程模式下由主进程生成一次，各工作进程共用）。
+ */
+class SessionTokens
+{
+public:
+    using Options = SessionOptions;
+
+    explicit SessionTokens(const Options &options);
+
+    SessionTokens(const SessionTokens &) = delete;
+    SessionTokens &operator=(const SessionTokens &) = delete;
+
+    // 为 user 签发令牌，返回完整的 Set-Cookie 值（名=令牌; 属性）
+    std::string Issue(std::string_view user) const;
+
+    // 从 Cookie 请求头中找出本服务的令牌并验证，成功时 *user 为令牌中的用户名
+    bool Verify(std::string_view cookieHeader, std::string *user) const;
+
+private:
+    static constexpr size_t KEY_BYTES = 32;
+
+    // 第 epoch 个纪元的签名密钥
+    void EpochKey_(int64_t epoch, unsigned char *key) const;
+
+    // 令牌前三段的 MAC，写入 mac（KEY_BYTES 字节）
+    void Sign_(int64_t epoch, std::string_view payload, unsigned char *mac) const;
+
+    Options options_;
+    unsigned char master_[KEY_BYTES];
+    int64_t keepEpochs_; // 令牌有效期跨越的纪元数，更早纪元签发的令牌直接拒绝
+};
+
+#endif // SESSION_H
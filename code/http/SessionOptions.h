@@ -0,0 +1,22 @@
+#ifndef SESSION_OPTIONS_H
+#define SESSION_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+
+// 会话 Cookie 参数（SessionTokens::Options）
+struct SessionOptions
+{
+    bool enabled = true;
+    std::string cookie = "sid"; // Cookie 名
+    int64_t ttlSec = 3600;      // 令牌有效期
+    int64_t rotateSec = 86400;  // 签名密钥轮换周期
+    std::string keyFile;        // 主密钥文件（至少 32 字节），为空时随机生成
+    bool secure = false;        // 附加 Secure 属性（只经 HTTPS 发送）
+    std::string secret;         // 直接给出的主密钥（多进程模式下由主进程生成），优先于 keyfile
+
+    // 解析 "name=value"：on, cookie, ttl, rotate, keyfile, secure；失败返回 false
+    bool Parse(const std::string &option);
+};
+
+#endif // SESSION_OPTIONS_H
@@ -0,0 +1,72 @@
+#ifndef STATIC_FILE_H
+#define STATIC_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/*
+ * 预先准备好的静态文件：内容、类型、ETag 与 gzip 版本都已算好，响应时不再访问文件系统
+ * 来源是内嵌资源包（AssetBundle）或启动时预热的文件缓存（FileCache），两者的内存都在进程内长期有效。
+ */
+struct StaticFile
+{
+    std::string_view path;     // 请求路径，例如 "/index.html"
+    std::string_view mime;
+    std::string_view etag;     // 强 ETag（含引号），按内容哈希生成
+    std::string_view gzipEtag; // gzip 版本的 ETag
+    std::string_view data;
+    std::string_view gzip;     // 预压缩版本，为空时没有
+};
+
+// 打包与预热共用的内容处理
+namespace StaticContent
+{
+    constexpr size_t GZIP_MIN_BYTES = 256;  // 更小的文件不值得多一个版本
+    constexpr size_t GZIP_MAX_RATIO_PCT = 90; // 压缩后不超过原大小的 90% 才保留
+
+    // ETag 的十六进制部分：内容的 FNV-1a 64 位哈希
+    inline std::string Hash(std::string_view data)
+    {
+        uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : data)
+        {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        char hex[20];
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+        return hex;
+    }
+
+    // gzip 压缩；没有 zlib 或压缩率不够时返回 false
+    inline bool Gzip(std::string_view in, std::string &out)
+    {
+#ifdef HAVE_ZLIB
+        if (in.size() < GZIP_MIN_BYTES)
+            return false;
+        z_stream zs{};
+        if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        out.resize(deflateBound(&zs, in.size()));
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        zs.avail_in = in.size();
+        zs.next_out = reinterpret_cast<Bytef *>(out.data());
+        zs.avail_out = out.size();
+        int ret = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return ret == Z_STREAM_END && out.size() * 100 <= in.size() * GZIP_MAX_RATIO_PCT;
+#else
+        (void)in;
+        (void)out;
+        return false;
+#endif
+    }
+}
+
+#endif // STATIC_FILE_H
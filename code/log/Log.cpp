@@ -0,0 +1,390 @@
+#include "Log.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ---------------- LogRing ----------------
+
+LogRecord *LogRing::Reserve()
+{
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= CAPACITY)
+    {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &records_[tail & (CAPACITY - 1)];
+}
+
+void LogRing::Commit()
+{
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool LogRing::Pop(LogRecord &out)
+{
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    out = records_[head & (CAPACITY - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// ---------------- RotatingFile ----------------
+
+RotatingFile::~RotatingFile()
+{
+    Close();
+}
+
+bool RotatingFile::Open(const std::string &path, size_t maxBytes, int maxFiles)
+{
+    Close();
+    path_ = path;
+    maxBytes_ = maxBytes;
+    maxFiles_ = maxFiles;
+    fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    written_ = fstat(fd_, &st) == 0 ? st.st_size : 0;
+    return true;
+}
+
+void RotatingFile::Write(const char *data, size_t len)
+{
+    if (fd_ < 0 || len == 0)
+    {
+        return;
+    }
+    if (maxBytes_ > 0 && written_ + len > maxBytes_ && written_ > 0)
+    {
+        Rotate_();
+    }
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd_, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += n;
+        len -= n;
+        written_ += n;
+    }
+}
+
+void RotatingFile::Rotate_()
+{
+    close(fd_);
+    for (int i = maxFiles_ - 1; i >= 1; --i)
+    {
+        std::string from = path_ + "." + std::to_string(i);
+        std::string to = path_ + "." + std::to_string(i + 1);
+        rename(from.c_str(), to.c_str());
+    }
+    if (maxFiles_ >= 1)
+    {
+        rename(path_.c_str(), (path_ + ".1").c_str());
+    }
+    fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    written_ = 0;
+}
+
+void RotatingFile::Close()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+// ---------------- Log ----------------
+
+namespace
+{
+    uint64_t RealtimeNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+    }
+
+    uint32_t ThreadId()
+    {
+        thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        return tid;
+    }
+
+    const char *LevelName(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::DEBUG:
+            return "DEBUG";
+        case LogLevel::INFO:
+            return "INFO ";
+        case LogLevel::WARN:
+            return "WARN ";
+        default:
+            return "ERROR";
+        }
+    }
+}
+
+Log *Log::Instance()
+{
+    static Log instance;
+    return &instance;
+}
+
+Log::~Log()
+{
+    Stop();
+}
+
+bool Log::Init(const std::string &dir, LogLevel level, bool accessLog, size_t maxFileBytes, int maxFiles)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (running_)
+    {
+        return true;
+    }
+    level_ = level;
+    accessLog_ = accessLog;
+
+    mkdir(dir.c_str(), 0755);
+    if (!errorFile_.Open(dir + "/error.log", maxFileBytes, maxFiles) ||
+        (accessLog_ && !accessFile_.Open(dir + "/access.log", maxFileBytes, maxFiles)))
+    {
+        fprintf(stderr, "Failed to open log files in %s: %s\n", dir.c_str(), strerror(errno));
+        errorFile_.Close();
+        return false;
+    }
+
+    running_ = true;
+    flusher_ = std::thread(&Log::FlushLoop_, this);
+    return true;
+}
+
+void Log::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!running_)
+        {
+            return;
+        }
+        running_ = false;
+    }
+    cond_.notify_all();
+    if (flusher_.joinable())
+    {
+        flusher_.join();
+    }
+    accessFile_.Close();
+    errorFile_.Close();
+}
+
+LogRing *Log::LocalRing_()
+{
+    thread_local LogRing *ring = nullptr;
+    if (!ring)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        rings_.push_back(std::make_unique<LogRing>());
+        ring = rings_.back().get();
+    }
+    return ring;
+}
+
+void Log::Write(LogLevel level, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    if (!running_)
+    {
+        // 未启动异步日志（如工具程序或初始化之前）时直接写 stderr
+        char line[512];
+        vsnprintf(line, sizeof(line), fmt, ap);
+        fprintf(stderr, "%s %s\n", LevelName(level), line);
+        va_end(ap);
+        return;
+    }
+
+    LogRing *ring = LocalRing_();
+    LogRecord *rec = ring->Reserve();
+    if (rec)
+    {
+        rec->timeNs = RealtimeNs();
+        rec->tid = ThreadId();
+        rec->level = level;
+        rec->kind = LogRecord::TEXT;
+        int n = vsnprintf(rec->text, sizeof(rec->text), fmt, ap);
+        rec->len = static_cast<uint16_t>(std::clamp(n, 0, static_cast<int>(sizeof(rec->text)) - 1));
+        ring->Commit();
+    }
+    va_end(ap);
+}
+
+void Log::Access(uint32_t ip, uint16_t port, std::string_view method, std::string_view path,
+                 int status, uint64_t bytes, uint64_t latencyNs)
+{
+    if (!AccessEnabled())
+    {
+        return;
+    }
+    LogRing *ring = LocalRing_();
+    LogRecord *rec = ring->Reserve();
+    if (!rec)
+    {
+        return;
+    }
+    rec->timeNs = RealtimeNs();
+    rec->tid = ThreadId();
+    rec->level = LogLevel::INFO;
+    rec->kind = LogRecord::ACCESS;
+    LogRecord::Access &a = rec->access;
+    a.ip = ip;
+    a.port = port;
+    a.status = static_cast<uint16_t>(status);
+    a.bytes = bytes;
+    a.latencyUs = static_cast<uint32_t>(std::min<uint64_t>(latencyNs / 1000, UINT32_MAX));
+    size_t mlen = std::min(method.size(), sizeof(a.method) - 1);
+    memcpy(a.method, method.data(), mlen);
+    a.method[mlen] = '\0';
+    a.pathLen = static_cast<uint16_t>(std::min(path.size(), sizeof(a.path)));
+    memcpy(a.path, path.data(), a.pathLen);
+    ring->Commit();
+}
+
+uint64_t Log::Dropped()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint64_t total = 0;
+    for (auto &ring : rings_)
+    {
+        total += ring->Dropped();
+    }
+    return total;
+}
+
+void Log::Format_(const LogRecord &rec, std::string &out)
+{
+    // 同一秒内的记录复用格式化好的时间前缀
+    thread_local time_t cachedSec = -1;
+    thread_local char cachedTime[32];
+    time_t sec = static_cast<time_t>(rec.timeNs / 1000000000ull);
+    if (sec != cachedSec)
+    {
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        strftime(cachedTime, sizeof(cachedTime), "%Y-%m-%d %H:%M:%S", &tm);
+        cachedSec = sec;
+    }
+
+    char line[512];
+    int n;
+    unsigned long usec = static_cast<unsigned long>((rec.timeNs % 1000000000ull) / 1000);
+    if (rec.kind == LogRecord::ACCESS)
+    {
+        const LogRecord::Access &a = rec.access;
+        char ip[INET_ADDRSTRLEN];
+        struct in_addr addr;
+        addr.s_addr = a.ip;
+        inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+        n = snprintf(line, sizeof(line), "%s.%06lu %s:%u \"%s %.*s\" %u %lu %uus\n",
+                     cachedTime, usec, ip, a.port, a.method,
+                     static_cast<int>(a.pathLen), a.path, a.status, a.bytes, a.latencyUs);
+    }
+    else
+    {
+        n = snprintf(line, sizeof(line), "%s.%06lu %s [%u] %.*s\n",
+                     cachedTime, usec, LevelName(rec.level), rec.tid,
+                     static_cast<int>(rec.len), rec.text);
+    }
+    if (n > 0)
+    {
+        out.append(line, std::min<size_t>(n, sizeof(line) - 1));
+    }
+}
+
+bool Log::Drain_(std::string &accessBatch, std::string &errorBatch)
+{
+    std::vector<LogRing *> rings;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto &ring : rings_)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    static constexpr size_t BATCH_BYTES = 64 << 10;
+    bool any = false;
+    LogRecord rec;
+    for (LogRing *ring : rings)
+    {
+        while (ring->Pop(rec))
+        {
+            any = true;
+            std::string &batch = rec.kind == LogRecord::ACCESS ? accessBatch : errorBatch;
+            Format_(rec, batch);
+            if (batch.size() >= BATCH_BYTES)
+            {
+                (rec.kind == LogRecord::ACCESS ? accessFile_ : errorFile_).Write(batch.data(), batch.size());
+                batch.clear();
+            }
+        }
+    }
+
+    accessFile_.Write(accessBatch.data(), accessBatch.size());
+    errorFile_.Write(errorBatch.data(), errorBatch.size());
+    accessBatch.clear();
+    errorBatch.clear();
+    return any;
+}
+
+void Log::FlushLoop_()
+{
+    std::string accessBatch, errorBatch;
+    accessBatch.reserve(128 << 10);
+    errorBatch.reserve(16 << 10);
+
+    while (running_)
+    {
+        bool busy = Drain_(accessBatch, errorBatch);
+
+        uint64_t dropped = Dropped();
+        if (dropped != reportedDropped_)
+        {
+            char line[128];
+            int n = snprintf(line, sizeof(line), "log queue full, %lu records dropped so far\n", dropped);
+            errorFile_.Write(line, n);
+            reportedDropped_ = dropped;
+        }
+
+        // 有数据时短间隔轮询，空闲时放慢；生产者不做唤醒，避免热路径上的系统调用
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait_for(lock, std::chrono::milliseconds(busy ? 5 : 50), [this]()
+                       { return !running_; });
+    }
+
+    // 退出前刷完剩余记录
+    Drain_(accessBatch, errorBatch);
+}
@@ -0,0 +1,166 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "LogLevel.h"
+
+/*
+ * 定长二进制日志记录
+ * 访问日志只保存原始字段，由后台线程格式化；普通日志保存已格式化的文本。
+ */
+struct LogRecord
+{
+    enum Kind : uint8_t
+    {
+        TEXT,
+        ACCESS,
+    };
+
+    struct Access
+    {
+        uint32_t ip;        // 网络字节序
+        uint16_t port;
+        uint16_t status;
+        uint64_t bytes;
+        uint32_t latencyUs;
+        char method[8];
+        uint16_t pathLen;
+        char path[200];
+    };
+
+    uint64_t timeNs; // CLOCK_REALTIME
+    uint32_t tid;
+    LogLevel level;
+    Kind kind;
+    uint16_t len; // TEXT 的文本长度
+    union
+    {
+        char text[232];
+        Access access;
+    };
+};
+
+/*
+ * 单生产者单消费者环形队列，每个线程一个
+ * 生产者为写日志的线程，消费者为后台刷盘线程；队列满时丢弃并计数，不阻塞。
+ */
+class LogRing
+{
+public:
+    static constexpr size_t CAPACITY = 2048; // 必须是 2 的幂
+
+    // 生产者：取得一个空槽位，队列满时返回 nullptr
+    LogRecord *Reserve();
+    // 生产者：提交 Reserve() 得到的槽位
+    void Commit();
+    // 消费者：取出一条记录，队列空时返回 false
+    bool Pop(LogRecord &out);
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<uint64_t> head_{0}; // 消费者位置
+    alignas(64) std::atomic<uint64_t> tail_{0}; // 生产者位置
+    std::atomic<uint64_t> dropped_{0};
+    LogRecord records_[CAPACITY];
+};
+
+// 按大小滚动的日志文件：file -> file.1 -> ... -> file.N
+class RotatingFile
+{
+public:
+    RotatingFile() = default;
+    ~RotatingFile();
+
+    bool Open(const std::string &path, size_t maxBytes, int maxFiles);
+    void Write(const char *data, size_t len);
+    void Close();
+
+private:
+    void Rotate_();
+
+    std::string path_;
+    size_t maxBytes_ = 0;
+    int maxFiles_ = 0;
+    size_t written_ = 0;
+    int fd_ = -1;
+};
+
+/*
+ * 异步日志
+ * 热路径只往本线程的环形队列写一条定长记录（无锁、无系统调用），
+ * 后台线程批量格式化后写入滚动文件。未启动时直接写到 stderr。
+ */
+class Log
+{
+public:
+    static Log *Instance();
+
+    // 启动后台刷盘线程；dir 下生成 access.log 与 error.log
+    bool Init(const std::string &dir, LogLevel level = LogLevel::INFO, bool accessLog = true,
+              size_t maxFileBytes = 64 << 20, int maxFiles = 5);
+
+    // 刷完所有队列并停止后台线程
+    void Stop();
+
+    void Write(LogLevel level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    // 记录一条访问日志
+    void Access(uint32_t ip, uint16_t port, std::string_view method, std::string_view path,
+                int status, uint64_t bytes, uint64_t latencyNs);
+
+    bool IsLevelEnabled(LogLevel level) const { return level >= level_; }
+    bool AccessEnabled() const { return accessLog_ && running_; }
+
+    // 因队列满而丢弃的记录数
+    uint64_t Dropped();
+
+    ~Log();
+
+private:
+    Log() = default;
+
+    LogRing *LocalRing_();
+    void FlushLoop_();
+    bool Drain_(std::string &accessBatch, std::string &errorBatch);
+    void Format_(const LogRecord &rec, std::string &out);
+
+    std::atomic<bool> running_{false};
+    LogLevel level_ = LogLevel::INFO;
+    bool accessLog_ = true;
+
+    std::mutex mtx_; // 保护 rings_ 的登记与后台线程的启停
+    std::condition_variable cond_;
+    std::vector<std::unique_ptr<LogRing>> rings_;
+    std::thread flusher_;
+
+    RotatingFile accessFile_;
+    RotatingFile errorFile_;
+    uint64_t reportedDropped_ = 0;
+};
+
+#define LOG_BASE(lv, levelNum, fmt, ...)                                                         \
+    do                                                                                           \
+    {                                                                                            \
+        if constexpr ((levelNum) >= LOG_MIN_LEVEL)                                               \
+        {                                                                                        \
+            if (Log::Instance()->IsLevelEnabled(lv))                                             \
+                Log::Instance()->Write(lv, fmt, ##__VA_ARGS__);                                  \
+        }                                                                                        \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...) LOG_BASE(LogLevel::DEBUG, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_BASE(LogLevel::INFO, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_BASE(LogLevel::WARN, LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_BASE(LogLevel::ERROR, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+#endif // LOG_H
@@ -0,0 +1,24 @@
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+#include <cstdint>
+
+// 编译期日志级别：低于该级别的 LOG_xxx 调用在编译期被整体去掉
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum class LogLevel : uint8_t
+{
+    DEBUG = LOG_LEVEL_DEBUG,
+    INFO = LOG_LEVEL_INFO,
+    WARN = LOG_LEVEL_WARN,
+    ERROR = LOG_LEVEL_ERROR,
+};
+
+#endif // LOG_LEVEL_H
@@ -1,9 +1,171 @@
 #include "webserver/server.h"
+#include "webserver/Prefork.h"
+#include <getopt.h>
 
-int main()
+static void Usage(const char *prog)
 {
-    WebServer server(8080, 8);
+    std::cout << "usage: " << prog << " [-p port] [-t threads] [-W workers] [-l logDir] [-m metricsPath] [-s] [-o name=value]... [-a name=value]... [-r name=value]... [-D dbLaneThreads] [-R name=host[:port]]... [-g name=value]... [-c name=value]... [-P name=value]... [-k name=value]... [-e resourceDir] [-w name=value]...\n"
+              << "       [-u upgradeSock] [-d drainMs] [-T traceFile] [-F chrome|otlp] [-S sampleEvery] [-U slowUs]\n"
+              << "  -W  run a master that supervises this many worker processes, each with its own listener (SO_REUSEPORT)\n"
+              << "  -s  use an in-memory stub user table instead of MySQL\n"
+              << "  -o  socket option: nodelay, cork, defer, fastopen, sndbuf, rcvbuf, backlog, zerocopy, reuseport\n"
+              << "  -a  admission control: target, interval (us), inflight, retry, maxconn\n"
+              << "  -r  per-IP rate limit: on, connrate, connburst, staticrate, staticburst, dbrate, dbburst, prefix, slots\n"
+              << "  -k  TLS: cert, key, tickets, cache, timeout, ktls, h2 (enabled when cert is set)\n"
+              << "  -e  serve static files from resourceDir instead of the embedded bundle\n"
+              << "  -w  startup warm-up: on, maxfile, max, populate, lock, gzip, threads, deadline (ms)\n"
+              << "  -u  hand over the listening socket through this Unix socket on restart (zero-downtime upgrade)\n"
+              << "  -d  how long to wait for open connections to finish before exiting (default 10000)\n"
+              << "  -g  registration group commit: on, batch, window (us)\n"
+              << "  -R  add a MySQL read replica; login lookups go to the least busy replica, falling back to the primary\n"
+              << "  -c  session cookie: on, cookie, ttl (s), rotate (s), keyfile, secure\n"
+              << "  -P  password hashing (bcrypt): on, threads, queue, perclient, cost\n"
+              << "  -D  threads for login/register requests (default: SQL pool size, 0: run them on the main pool)\n"
+              << "  -T  export sampled and slow request traces to traceFile\n";
+}
+
+int main(int argc, char *argv[])
+{
+    ServerConfig config;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:t:W:l:m:so:a:r:k:e:w:u:d:D:R:g:c:P:T:F:S:U:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            config.port = atoi(optarg);
+            break;
+        case 't':
+            config.threadNum = atoi(optarg);
+            break;
+        case 'W':
+            config.workers = atoi(optarg);
+            break;
+        case 'l':
+            config.logDir = optarg;
+            break;
+        case 'm':
+            config.metricsPath = optarg;
+            break;
+        case 's':
+            config.dbStub = true;
+            break;
+        case 'o':
+            if (!config.sock.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid socket option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'a':
+            if (!config.admission.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid admission option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'r':
+            if (!config.rateLimit.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid rate limit option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'k':
+            if (!config.tls.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid TLS option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'e':
+            config.embeddedAssets = false;
+            config.resourceDir = optarg;
+            break;
+        case 'w':
+            if (!config.warm.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid warm-up option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'u':
+            config.upgradeSock = optarg;
+            break;
+        case 'd':
+            config.drainTimeoutMs = atoi(optarg);
+            break;
+        case 'g':
+            if (!config.groupCommit.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid group commit option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'c':
+            if (!config.session.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid session option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'P':
+            if (!config.kdf.Parse(optarg))
+            {
+                std::cerr << "unknown or invalid password hashing option: " << optarg << "\n";
+                return 1;
+            }
+            break;
+        case 'D':
+            config.dbLaneThreads = atoi(optarg);
+            config.dbLane = config.dbLaneThreads > 0;
+            break;
+        case 'R':
+        {
+            // name=host[:port]
+            std::string arg = optarg;
+            size_t eq = arg.find('=');
+            size_t colon = arg.rfind(':');
+            DbReplica replica;
+            replica.name = eq == std::string::npos ? "" : arg.substr(0, eq);
+            replica.host = arg.substr(eq + 1, colon == std::string::npos || colon < eq + 1 ? std::string::npos : colon - eq - 1);
+            if (colon != std::string::npos && colon > eq + 1)
+                replica.port = atoi(arg.c_str() + colon + 1);
+            if (replica.name.empty() || replica.host.empty() || replica.port <= 0)
+            {
+                std::cerr << "bad read replica (expected name=host[:port]): " << optarg << "\n";
+                return 1;
+            }
+            config.dbReplicas.push_back(replica);
+            break;
+        }
+        case 'T':
+            config.traceFile = optarg;
+            break;
+        case 'F':
+            config.traceFormat = std::string(optarg) == "otlp" ? TraceFormat::OTLP : TraceFormat::CHROME;
+            break;
+        case 'S':
+            config.traceSampleEvery = atoi(optarg);
+            break;
+        case 'U':
+            config.traceSlowUs = strtoull(optarg, nullptr, 10);
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (config.workers > 0)
+    {
+        Prefork master(config);
+        std::cout << "server is running with " << config.workers << " workers" << std::endl;
+        return master.Run();
+    }
+
+    WebServer server(config);
     std::cout << "server is running" << std::endl;
     server.start();
     return 0;
-}
\ No newline at end of file
+}
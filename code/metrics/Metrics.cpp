@@ -0,0 +1,307 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+// ---------------- Histogram ----------------
+
+int Histogram::BucketOf(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(SUB_COUNT))
+    {
+        return static_cast<int>(value);
+    }
+    int exp = 63 - __builtin_clzll(value);
+    if (exp > MAX_EXP)
+    {
+        return BUCKETS - 1;
+    }
+    int shift = exp - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + static_cast<int>((value >> shift) & (SUB_COUNT - 1));
+}
+
+uint64_t Histogram::BucketUpper(int index)
+{
+    if (index < SUB_COUNT)
+    {
+        return static_cast<uint64_t>(index);
+    }
+    int shift = index / SUB_COUNT - 1;
+    uint64_t sub = static_cast<uint64_t>(index % SUB_COUNT);
+    return ((SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value)
+{
+    CounterAdd(buckets_[BucketOf(value)]);
+    CounterAdd(count_);
+    CounterAdd(sum_, value);
+}
+
+void Histogram::AddTo(std::vector<uint64_t> &out, uint64_t &count, uint64_t &sum) const
+{
+    out.resize(BUCKETS, 0);
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        out[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+    count += count_.load(std::memory_order_relaxed);
+    sum += sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Quantile(const std::vector<uint64_t> &buckets, uint64_t count, double q)
+{
+    if (count == 0 || buckets.empty())
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count));
+    rank = std::min(std::max<uint64_t>(rank, 1), count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return BucketUpper(static_cast<int>(i));
+        }
+    }
+    return BucketUpper(static_cast<int>(buckets.size()) - 1);
+}
+
+// ---------------- Metrics ----------------
+
+Metrics *Metrics::Instance()
+{
+    static Metrics instance;
+    return &instance;
+}
+
+ThreadMetrics &Metrics::Local()
+{
+    thread_local ThreadMetrics *local = Instance()->Register_();
+    return *local;
+}
+
+ThreadMetrics *Metrics::Register_()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    threads_.push_back(std::make_unique<ThreadMetrics>());
+    return threads_.back().get();
+}
+
+void Metrics::AddGauge(const std::string &name, const std::string &help, std::function<double()> fn)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    RemoveGaugeLocked_(name);
+    gauges_.push_back({name, help, std::move(fn)});
+}
+
+void Metrics::RemoveGauge(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    RemoveGaugeLocked_(name);
+}
+
+void Metrics::RemoveGaugeLocked_(const std::string &name)
+{
+    gauges_.erase(std::remove_if(gauges_.begin(), gauges_.end(),
+                                 [&name](const Gauge &g)
+                                 { return g.name == name; }),
+                  gauges_.end());
+}
+
+namespace
+{
+    void AppendLine(std::string &out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    void AppendLine(std::string &out, const char *fmt, ...)
+    {
+        char line[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(line, sizeof(line), fmt, ap);
+        va_end(ap);
+        if (n > 0)
+        {
+            out.append(line, std::min<size_t>(n, sizeof(line) - 1));
+        }
+    }
+
+    const char *const STAGE_NAMES[ThreadMetrics::STAGE_COUNT] = {"first_byte", "parse", "db", "password_hash", "write"};
+
+    // Prometheus 直方图的桶边界（秒），由细粒度桶按上界归并得到
+    const double LE_BOUNDS[] = {0.00001, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+Metrics::Totals Metrics::Sum()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Totals totals;
+    for (auto &t : threads_)
+    {
+        totals.connections += t->connections.load(std::memory_order_relaxed);
+        totals.requests += t->requests.load(std::memory_order_relaxed);
+        totals.bytesSent += t->bytesSent.load(std::memory_order_relaxed);
+        for (int code = 500; code < 600; ++code)
+        {
+            totals.errors += t->status[code].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+std::string Metrics::Render()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::string out;
+    out.reserve(8192);
+
+    uint64_t connections = 0, requests = 0, bytesSent = 0, shed = 0, rateLimited = 0, zeroCopySends = 0, zeroCopyCopied = 0;
+    uint64_t tlsHandshakes = 0, tlsResumed = 0, tlsFailed = 0, ktlsSend = 0, ktlsRecv = 0;
+    uint64_t registerBatches = 0, registerRows = 0;
+    uint64_t sessionsIssued = 0, sessionsVerified = 0, sessionsRejected = 0;
+    std::vector<uint64_t> status(600, 0);
+    std::vector<uint64_t> stageBuckets[ThreadMetrics::STAGE_COUNT];
+    uint64_t stageCount[ThreadMetrics::STAGE_COUNT] = {};
+    uint64_t stageSum[ThreadMetrics::STAGE_COUNT] = {};
+
+    for (auto &t : threads_)
+    {
+        connections += t->connections.load(std::memory_order_relaxed);
+        requests += t->requests.load(std::memory_order_relaxed);
+        bytesSent += t->bytesSent.load(std::memory_order_relaxed);
+        shed += t->shed.load(std::memory_order_relaxed);
+        rateLimited += t->rateLimited.load(std::memory_order_relaxed);
+        zeroCopySends += t->zeroCopySends.load(std::memory_order_relaxed);
+        zeroCopyCopied += t->zeroCopyCopied.load(std::memory_order_relaxed);
+        tlsHandshakes += t->tlsHandshakes.load(std::memory_order_relaxed);
+        tlsResumed += t->tlsResumed.load(std::memory_order_relaxed);
+        tlsFailed += t->tlsFailed.load(std::memory_order_relaxed);
+        ktlsSend += t->ktlsSend.load(std::memory_order_relaxed);
+        ktlsRecv += t->ktlsRecv.load(std::memory_order_relaxed);
+        registerBatches += t->registerBatches.load(std::memory_order_relaxed);
+        registerRows += t->registerRows.load(std::memory_order_relaxed);
+        sessionsIssued += t->sessionsIssued.load(std::memory_order_relaxed);
+        sessionsVerified += t->sessionsVerified.load(std::memory_order_relaxed);
+        sessionsRejected += t->sessionsRejected.load(std::memory_order_relaxed);
+        for (size_t code = 0; code < status.size(); ++code)
+        {
+            status[code] += t->status[code].load(std::memory_order_relaxed);
+        }
+        for (int s = 0; s < ThreadMetrics::STAGE_COUNT; ++s)
+        {
+            t->stages[s].AddTo(stageBuckets[s], stageCount[s], stageSum[s]);
+        }
+    }
+
+    out += "# HELP webserver_connections_total Accepted connections.\n";
+    out += "# TYPE webserver_connections_total counter\n";
+    AppendLine(out, "webserver_connections_total %lu\n", connections);
+
+    out += "# HELP webserver_requests_total Completed requests by status code.\n";
+    out += "# TYPE webserver_requests_total counter\n";
+    for (size_t code = 100; code < status.size(); ++code)
+    {
+        if (status[code] > 0)
+        {
+            AppendLine(out, "webserver_requests_total{code=\"%zu\"} %lu\n", code, status[code]);
+        }
+    }
+    if (requests == 0)
+    {
+        out += "webserver_requests_total{code=\"200\"} 0\n";
+    }
+
+    out += "# HELP webserver_sent_bytes_total Bytes written to clients.\n";
+    out += "# TYPE webserver_sent_bytes_total counter\n";
+    AppendLine(out, "webserver_sent_bytes_total %lu\n", bytesSent);
+
+    out += "# HELP webserver_shed_total Requests and connections rejected with 503 by admission control.\n";
+    out += "# TYPE webserver_shed_total counter\n";
+    AppendLine(out, "webserver_shed_total %lu\n", shed);
+
+    out += "# HELP webserver_rate_limited_total Requests and connections rejected by per-IP rate limiting.\n";
+    out += "# TYPE webserver_rate_limited_total counter\n";
+    AppendLine(out, "webserver_rate_limited_total %lu\n", rateLimited);
+
+    out += "# HELP webserver_zerocopy_sends_total Sends issued with MSG_ZEROCOPY.\n";
+    out += "# TYPE webserver_zerocopy_sends_total counter\n";
+    AppendLine(out, "webserver_zerocopy_sends_total %lu\n", zeroCopySends);
+    out += "# HELP webserver_zerocopy_copied_total Zero-copy sends the kernel completed by copying.\n";
+    out += "# TYPE webserver_zerocopy_copied_total counter\n";
+    AppendLine(out, "webserver_zerocopy_copied_total %lu\n", zeroCopyCopied);
+
+    out += "# HELP webserver_tls_handshakes_total Completed TLS handshakes.\n";
+    out += "# TYPE webserver_tls_handshakes_total counter\n";
+    AppendLine(out, "webserver_tls_handshakes_total %lu\n", tlsHandshakes);
+    out += "# HELP webserver_tls_resumed_total TLS handshakes that resumed a session.\n";
+    out += "# TYPE webserver_tls_resumed_total counter\n";
+    AppendLine(out, "webserver_tls_resumed_total %lu\n", tlsResumed);
+    out += "# HELP webserver_tls_failed_total Failed TLS handshakes.\n";
+    out += "# TYPE webserver_tls_failed_total counter\n";
+    AppendLine(out, "webserver_tls_failed_total %lu\n", tlsFailed);
+    out += "# HELP webserver_ktls_connections_total TLS connections offloaded to kernel TLS by direction.\n";
+    out += "# TYPE webserver_ktls_connections_total counter\n";
+    AppendLine(out, "webserver_ktls_connections_total{direction=\"tx\"} %lu\n", ktlsSend);
+    AppendLine(out, "webserver_ktls_connections_total{direction=\"rx\"} %lu\n", ktlsRecv);
+
+    out += "# HELP webserver_register_batches_total Transactions committed by the registration batcher.\n";
+    out += "# TYPE webserver_register_batches_total counter\n";
+    AppendLine(out, "webserver_register_batches_total %lu\n", registerBatches);
+    out += "# HELP webserver_register_requests_total Registration requests completed by the batcher.\n";
+    out += "# TYPE webserver_register_requests_total counter\n";
+    AppendLine(out, "webserver_register_requests_total %lu\n", registerRows);
+
+    out += "# HELP webserver_sessions_total Session tokens by outcome.\n";
+    out += "# TYPE webserver_sessions_total counter\n";
+    AppendLine(out, "webserver_sessions_total{result=\"issued\"} %lu\n", sessionsIssued);
+    AppendLine(out, "webserver_sessions_total{result=\"verified\"} %lu\n", sessionsVerified);
+    AppendLine(out, "webserver_sessions_total{result=\"rejected\"} %lu\n", sessionsRejected);
+
+    for (auto &g : gauges_)
+    {
+        AppendLine(out, "# HELP %s %s\n", g.name.c_str(), g.help.c_str());
+        AppendLine(out, "# TYPE %s gauge\n", g.name.c_str());
+        AppendLine(out, "%s %.17g\n", g.name.c_str(), g.fn());
+    }
+
+    out += "# HELP webserver_stage_latency_seconds Per-stage request latency.\n";
+    out += "# TYPE webserver_stage_latency_seconds histogram\n";
+    for (int s = 0; s < ThreadMetrics::STAGE_COUNT; ++s)
+    {
+        std::vector<uint64_t> &buckets = stageBuckets[s];
+        buckets.resize(Histogram::BUCKETS, 0);
+        uint64_t cumulative = 0;
+        int idx = 0;
+        for (double le : LE_BOUNDS)
+        {
+            uint64_t leNs = static_cast<uint64_t>(le * 1e9);
+            while (idx < Histogram::BUCKETS && Histogram::BucketUpper(idx) <= leNs)
+            {
+                cumulative += buckets[idx++];
+            }
+            AppendLine(out, "webserver_stage_latency_seconds_bucket{stage=\"%s\",le=\"%g\"} %lu\n",
+                       STAGE_NAMES[s], le, cumulative);
+        }
+        AppendLine(out, "webserver_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n",
+                   STAGE_NAMES[s], stageCount[s]);
+        AppendLine(out, "webserver_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n",
+                   STAGE_NAMES[s], stageSum[s] / 1e9);
+        AppendLine(out, "webserver_stage_latency_seconds_count{stage=\"%s\"} %lu\n",
+                   STAGE_NAMES[s], stageCount[s]);
+    }
+
+    out += "# HELP webserver_stage_latency_quantile_seconds Per-stage latency quantiles from the HDR histogram.\n";
+    out += "# TYPE webserver_stage_latency_quantile_seconds gauge\n";
+    for (int s = 0; s < ThreadMetrics::STAGE_COUNT; ++s)
+    {
+        for (double q : {0.5, 0.9, 0.99, 0.999})
+        {
+            AppendLine(out, "webserver_stage_latency_quantile_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                       STAGE_NAMES[s], q, Histogram::Quantile(stageBuckets[s], stageCount[s], q) / 1e9);
+        }
+    }
+    return out;
+}
@@ -0,0 +1,153 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * HDR 风格的对数线性直方图（单位：纳秒）
+ * 每个 2 的幂区间再等分为 2^SUB_BITS 个子桶，相对误差约 1/2^SUB_BITS。
+ * 只允许所属线程写入，其他线程可以随时读取（relaxed 原子操作，无锁）。
+ */
+class Histogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int MAX_EXP = 40; // 2^40ns ≈ 18 分钟，更大的值计入最后一个桶
+    static constexpr int BUCKETS = (MAX_EXP - SUB_BITS + 1) * SUB_COUNT + SUB_COUNT;
+
+    // 记录一个样本（仅所属线程调用）
+    void Record(uint64_t value);
+
+    // 将本直方图的计数累加到 out（聚合用）
+    void AddTo(std::vector<uint64_t> &out, uint64_t &count, uint64_t &sum) const;
+
+    // 桶下标与取值范围换算
+    static int BucketOf(uint64_t value);
+    static uint64_t BucketUpper(int index);
+
+    // 在聚合后的桶计数上求分位数（q 取 0~1），返回桶的上界
+    static uint64_t Quantile(const std::vector<uint64_t> &buckets, uint64_t count, double q);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+// 单写者计数器自增：只有所属线程写，不需要带 lock 前缀的原子加
+inline void CounterAdd(std::atomic<uint64_t> &counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/*
+ * 每个线程一份的指标，按缓存行对齐，避免不同线程的计数器互相伪共享
+ */
+struct alignas(64) ThreadMetrics
+{
+    enum Stage
+    {
+        STAGE_FIRST_BYTE, // accept 到响应第一个字节写出
+        STAGE_PARSE,      // 解析请求
+        STAGE_DB,         // 数据库访问
+        STAGE_KDF,        // 口令哈希计算（不含排队）
+        STAGE_WRITE,      // 响应从开始写到写完
+        STAGE_COUNT,
+    };
+
+    std::atomic<uint64_t> connections{0};            // 接受的连接数
+    std::atomic<uint64_t> requests{0};               // 处理的请求数
+    std::atomic<uint64_t> bytesSent{0};              // 发送的字节数
+    std::atomic<uint64_t> shed{0};                   // 准入控制拒绝的请求/连接数
+    std::atomic<uint64_t> rateLimited{0};            // 被限流拒绝的请求/连接数
+    std::atomic<uint64_t> zeroCopySends{0};          // MSG_ZEROCOPY 发送次数
+    std::atomic<uint64_t> zeroCopyCopied{0};         // 内核报告退化为拷贝的零拷贝发送次数
+    std::atomic<uint64_t> tlsHandshakes{0};          // 完成的 TLS 握手数
+    std::atomic<uint64_t> tlsResumed{0};             // 其中复用会话（会话票据或会话缓存）的握手数
+    std::atomic<uint64_t> tlsFailed{0};              // 失败的 TLS 握手数
+    std::atomic<uint64_t> ktlsSend{0};               // 发送方向交给内核 TLS 的连接数
+    std::atomic<uint64_t> ktlsRecv{0};               // 接收方向交给内核 TLS 的连接数
+    std::atomic<uint64_t> registerBatches{0};        // 注册批量提交的事务数
+    std::atomic<uint64_t> registerRows{0};           // 批量提交处理的注册请求数
+    std::atomic<uint64_t> sessionsIssued{0};         // 签发的会话令牌数
+    std::atomic<uint64_t> sessionsVerified{0};       // 验证通过的会话令牌数
+    std::atomic<uint64_t> sessionsRejected{0};       // 带了 Cookie 但验证失败（伪造、过期或密钥已轮换）的请求数
+    std::array<std::atomic<uint64_t>, 600> status{}; // 按状态码计数（100~599）
+    Histogram stages[STAGE_COUNT];
+
+    void CountResponse(int code)
+    {
+        CounterAdd(requests);
+        if (code >= 100 && code < 600)
+        {
+            CounterAdd(status[code]);
+        }
+    }
+
+    void RecordStage(Stage stage, uint64_t ns) { stages[stage].Record(ns); }
+};
+
+/*
+ * 指标注册中心：各线程在第一次使用时登记自己的 ThreadMetrics，
+ * 导出时才遍历所有线程做聚合，热路径上没有锁和共享写。
+ */
+class Metrics
+{
+public:
+    static Metrics *Instance();
+
+    // 当前线程的指标（首次调用时登记）
+    static ThreadMetrics &Local();
+
+    // 单调时钟，纳秒
+    static uint64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // 注册/移除一个在导出时求值的瞬时值（如活跃连接数、队列长度）
+    void AddGauge(const std::string &name, const std::string &help, std::function<double()> fn);
+    void RemoveGauge(const std::string &name);
+
+    // 以 Prometheus 文本格式导出所有指标
+    std::string Render();
+
+    // 各线程主要计数之和（多进程模式下发布到共享内存）
+    struct Totals
+    {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t bytesSent = 0;
+        uint64_t errors = 0; // 5xx 响应
+    };
+    Totals Sum();
+
+private:
+    Metrics() = default;
+    ThreadMetrics *Register_();
+    void RemoveGaugeLocked_(const std::string &name);
+
+    struct Gauge
+    {
+        std::string name;
+        std::string help;
+        std::function<double()> fn;
+    };
+
+    std::mutex mtx_; // 只保护登记和导出
+    std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+    std::vector<Gauge> gauges_;
+};
+
+#endif // METRICS_H
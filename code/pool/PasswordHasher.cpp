@@ -0,0 +1,186 @@
+#include "PasswordHasher.h"
+#include "../webserver/OptionParse.h"
+#include "../log/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <crypt.h>
+#include <openssl/crypto.h>
+
+int PasswordHasher::cost_ = 10;
+
+bool PasswordHasherOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "on")
+        return OptionParse::Flag(value, enabled);
+    if (name == "threads")
+        return OptionParse::Number(value, threads, 0);
+    if (name == "queue")
+        return OptionParse::Number<size_t>(value, queue, 1);
+    if (name == "perclient")
+        return OptionParse::Number<size_t>(value, perClient, 1);
+    if (name == "cost")
+        return OptionParse::Number(value, cost, 4, 31);
+    return false;
+}
+
+PasswordHasher::PasswordHasher(const Options &options)
+    : options_(options), queued_(0), stop_(false)
+{
+    int threads = options_.threads > 0 ? options_.threads
+                                       : std::max<int>(1, std::thread::hardware_concurrency() / 2);
+    for (int i = 0; i < threads; ++i)
+    {
+        workers_.emplace_back(&PasswordHasher::Run_, this);
+    }
+    LOG_INFO("password hashing: bcrypt cost %d, %d threads, queue %zu (%zu per client)", cost_, threads,
+             options_.queue, options_.perClient);
+}
+
+PasswordHasher::~PasswordHasher()
+{
+    Stop();
+}
+
+void PasswordHasher::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto &worker : workers_)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+bool PasswordHasher::TrySubmit(uint32_t client, std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stop_ || queued_ >= options_.queue)
+        {
+            return false;
+        }
+        auto &jobs = pending_[client];
+        if (jobs.size() >= options_.perClient)
+        {
+            return false;
+        }
+        if (jobs.empty())
+        {
+            turns_.push_back(client);
+        }
+        jobs.push_back(std::move(job));
+        ++queued_;
+    }
+    cond_.notify_one();
+    return true;
+}
+
+size_t PasswordHasher::QueueSize() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return queued_;
+}
+
+void PasswordHasher::Run_()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true)
+    {
+        cond_.wait(lock, [this]()
+                   { return stop_ || !turns_.empty(); });
+        if (turns_.empty())
+        {
+            break; // 已停止且没有剩余任务
+        }
+
+        // 取轮到的客户端的一个任务；它还有任务就排到队尾，等其他客户端各执行一个后再轮到它
+        uint32_t client = turns_.front();
+        turns_.pop_front();
+        auto it = pending_.find(client);
+        std::function<void()> job = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty())
+        {
+            pending_.erase(it);
+        }
+        else
+        {
+            turns_.push_back(client);
+        }
+        --queued_;
+
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+bool PasswordHasher::Hash(std::string_view pwd, std::string *out)
+{
+    if (pwd.find('\0') != std::string_view::npos)
+    {
+        return false; // crypt 以 NUL 结尾，含 NUL 的口令会被截断
+    }
+    if (pwd.size() > MAX_PASSWORD_BYTES)
+    {
+        LOG_DEBUG("rejecting a %zu-byte password, bcrypt uses only the first %zu", pwd.size(), MAX_PASSWORD_BYTES);
+        return false;
+    }
+    char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+    if (crypt_gensalt_rn("$2b$", cost_, nullptr, 0, salt, sizeof(salt)) == nullptr)
+    {
+        LOG_ERROR("crypt_gensalt failed for bcrypt");
+        return false;
+    }
+    thread_local crypt_data data{};
+    std::string key(pwd);
+    const char *hash = crypt_r(key.c_str(), salt, &data);
+    OPENSSL_cleanse(key.data(), key.size());
+    if (hash == nullptr || hash[0] != '$')
+    {
+        LOG_ERROR("bcrypt hashing failed");
+        return false;
+    }
+    out->assign(hash);
+    return true;
+}
+
+bool PasswordHasher::Verify(std::string_view pwd, const std::string &stored)
+{
+    if (stored.empty() || stored[0] != '$')
+    {
+        // 启用哈希之前注册的用户仍是明文口令
+        return stored.size() == pwd.size() && CRYPTO_memcmp(stored.data(), pwd.data(), pwd.size()) == 0;
+    }
+    if (pwd.find('\0') != std::string_view::npos || pwd.size() > MAX_PASSWORD_BYTES)
+    {
+        return false;
+    }
+    thread_local crypt_data data{};
+    std::string key(pwd);
+    const char *hash = crypt_r(key.c_str(), stored.c_str(), &data);
+    OPENSSL_cleanse(key.data(), key.size());
+    return hash != nullptr && stored.size() == strlen(hash) &&
+           CRYPTO_memcmp(hash, stored.data(), stored.size()) == 0;
+}
+
+const std::string &PasswordHasher::DummyHash()
+{
+    static const std::string dummy = []
+    {
+        std::string hash;
+        Hash("no such user", &hash);
+        return hash;
+    }();
+    return dummy;
+}
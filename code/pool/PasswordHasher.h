@@ -0,0 +1,76 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include "PasswordHasherOptions.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 口令哈希（bcrypt）与专用计算线程池
+ * bcrypt 每次计算几十毫秒 CPU，放在共享线程池或数据库通道里，一波登录就能占满线程、拖住静态请求。
+ * 这里用固定数量的线程执行，排队总数和每个客户端（IP）的排队数都有上限，超出时由调用者回 503；
+ * 各客户端的任务轮流执行，单个 IP 的洪泛只拉长它自己的排队时间。
+ * 任务完成后由回调把连接交回 epoll（或转入下一阶段），计算期间不占用其他线程。
+ */
+class PasswordHasher
+{
+public:
+    using Options = PasswordHasherOptions;
+
+    explicit PasswordHasher(const Options &options);
+
+    // 执行完已入队的任务后退出
+    ~PasswordHasher();
+
+    // 停止接收新任务，执行完已入队的任务后返回；之后 TrySubmit 总是返回 false
+    void Stop();
+
+    PasswordHasher(const PasswordHasher &) = delete;
+    PasswordHasher &operator=(const PasswordHasher &) = delete;
+
+    // 以 client 的名义排队一个任务；队列已满或该客户端排队过多时返回 false
+    bool TrySubmit(uint32_t client, std::function<void()> job);
+
+    size_t QueueSize() const;
+    int ThreadCount() const { return static_cast<int>(workers_.size()); }
+
+    // bcrypt 只使用口令的前 72 字节，更长的口令会与同前缀的口令互相通过校验，因此直接拒绝
+    static constexpr size_t MAX_PASSWORD_BYTES = 72;
+
+    // 生成口令的 bcrypt 哈希（"$2b$..."）；口令超过 MAX_PASSWORD_BYTES 或计算失败时返回 false
+    static bool Hash(std::string_view pwd, std::string *out);
+
+    // 校验口令；stored 不是 crypt 格式时按旧数据的明文比较，超长口令不能通过 bcrypt 校验
+    static bool Verify(std::string_view pwd, const std::string &stored);
+
+    // 用户不存在时用来校验的哈希，让“用户不存在”和“口令错误”耗时相同
+    static const std::string &DummyHash();
+
+    // 新哈希使用的代价因子
+    static void SetCost(int cost) { cost_ = cost; }
+
+private:
+    void Run_();
+
+    Options options_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cond_;
+    std::unordered_map<uint32_t, std::deque<std::function<void()>>> pending_; // 各客户端的排队任务
+    std::deque<uint32_t> turns_;                                               // 有排队任务的客户端，轮流执行
+    size_t queued_;
+    bool stop_;
+
+    static int cost_;
+};
+
+#endif // PASSWORD_HASHER_H
@@ -0,0 +1,20 @@
+#ifndef PASSWORD_HASHER_OPTIONS_H
+#define PASSWORD_HASHER_OPTIONS_H
+
+#include <cstddef>
+#include <string>
+
+// 口令哈希线程池参数（PasswordHasher::Options）
+struct PasswordHasherOptions
+{
+    bool enabled = true;    // 关闭时在当前线程同步计算
+    int threads = 0;        // 计算线程数，0 表示 CPU 核数的一半（至少 1）
+    size_t queue = 256;     // 排队任务总数上限
+    size_t perClient = 8;   // 单个客户端排队任务上限
+    int cost = 10;          // bcrypt 代价因子（4~31），每加 1 计算时间翻倍
+
+    // 解析 "name=value"：on, threads, queue, perclient, cost；失败返回 false
+    bool Parse(const std::string &option);
+};
+
+#endif // PASSWORD_HASHER_OPTIONS_H
@@ -0,0 +1,235 @@
+#include "RegisterBatcher.h"
+#include "../webserver/OptionParse.h"
+#include "SqlConnRAII.h"
+#include "../log/Log.h"
+#include "../metrics/Metrics.h"
+#include <chrono>
+#include <unordered_set>
+
+bool RegisterBatcherOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "on")
+        return OptionParse::Flag(value, enabled);
+    if (name == "batch")
+        return OptionParse::Number<size_t>(value, maxBatch, 1);
+    if (name == "window")
+        return OptionParse::Number(value, windowUs, 0);
+    return false;
+}
+
+RegisterBatcher::RegisterBatcher(const Options &options, Flush flush)
+    : options_(options), flush_(std::move(flush)), stop_(false)
+{
+    writer_ = std::thread(&RegisterBatcher::Run_, this);
+}
+
+RegisterBatcher::~RegisterBatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cond_.notify_one();
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+}
+
+bool RegisterBatcher::Register(std::string_view name, std::string_view pwd)
+{
+    Pending pending;
+    pending.reg.name.assign(name.data(), name.size());
+    pending.reg.pwd.assign(pwd.data(), pwd.size());
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    queue_.push_back(&pending);
+    if (queue_.size() == 1 || queue_.size() >= options_.maxBatch)
+    {
+        cond_.notify_one();
+    }
+    doneCond_.wait(lock, [&pending]()
+                   { return pending.done; });
+    return pending.reg.ok;
+}
+
+void RegisterBatcher::Run_()
+{
+    std::vector<Pending *> batch;
+    std::vector<Registration *> regs;
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true)
+    {
+        cond_.wait(lock, [this]()
+                   { return stop_ || !queue_.empty(); });
+        if (queue_.empty())
+        {
+            break; // 已停止且没有剩余的注册
+        }
+
+        // 收集窗口：给同一波注册一点时间凑进同一个事务
+        if (options_.windowUs > 0 && queue_.size() < options_.maxBatch && !stop_)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(options_.windowUs);
+            cond_.wait_until(lock, deadline, [this]()
+                             { return stop_ || queue_.size() >= options_.maxBatch; });
+        }
+
+        size_t n = std::min(queue_.size(), options_.maxBatch);
+        batch.assign(queue_.begin(), queue_.begin() + n);
+        queue_.erase(queue_.begin(), queue_.begin() + n);
+        lock.unlock();
+
+        regs.clear();
+        for (Pending *p : batch)
+        {
+            regs.push_back(&p->reg);
+        }
+        flush_(regs);
+        CounterAdd(Metrics::Local().registerBatches);
+        CounterAdd(Metrics::Local().registerRows, n);
+
+        lock.lock();
+        for (Pending *p : batch)
+        {
+            p->done = true;
+        }
+        doneCond_.notify_all();
+    }
+}
+
+namespace
+{
+    // 转义后加上引号，作为 SQL 字符串字面量追加到 out
+    void AppendQuoted(MYSQL *sql, std::string &out, const std::string &value)
+    {
+        size_t start = out.size();
+        out.resize(start + value.size() * 2 + 3);
+        out[start] = '\'';
+        unsigned long len = mysql_real_escape_string(sql, &out[start + 1], value.data(), value.size());
+        out.resize(start + 1 + len);
+        out += '\'';
+    }
+
+    enum class BatchResult
+    {
+        COMMITTED,     // 已提交，插入的各项 ok 已置位
+        INSERT_FAILED, // 多行 INSERT 失败，事务已回滚
+        FAILED,        // 查询、取结果或提交失败，事务已回滚
+    };
+
+    // 在一个事务里锁住这些用户名、插入其中不存在的，提交后置位插入项的 ok
+    BatchResult CommitBatch(MYSQL *sql, const std::vector<RegisterBatcher::Registration *> &fresh)
+    {
+        std::string order = "SELECT username FROM user WHERE username IN (";
+        for (size_t i = 0; i < fresh.size(); ++i)
+        {
+            if (i > 0)
+                order += ',';
+            AppendQuoted(sql, order, fresh[i]->name);
+        }
+        order += ") FOR UPDATE"; // 锁住这些用户名（含不存在的间隙），提交前其他写者无法插入同名用户
+
+        BatchResult result = BatchResult::FAILED;
+        if (mysql_query(sql, order.c_str()))
+        {
+            LOG_ERROR("Register batch check failed: %s", mysql_error(sql));
+        }
+        else if (MYSQL_RES *res = mysql_store_result(sql))
+        {
+            std::unordered_set<std::string> existing;
+            while (MYSQL_ROW row = mysql_fetch_row(res))
+            {
+                existing.emplace(row[0]);
+            }
+            mysql_free_result(res);
+
+            std::vector<RegisterBatcher::Registration *> insert;
+            for (RegisterBatcher::Registration *r : fresh)
+            {
+                if (existing.count(r->name) == 0)
+                    insert.push_back(r);
+            }
+
+            order = "INSERT INTO user(username, password) VALUES ";
+            for (size_t i = 0; i < insert.size(); ++i)
+            {
+                order += i > 0 ? ",(" : "(";
+                AppendQuoted(sql, order, insert[i]->name);
+                order += ',';
+                AppendQuoted(sql, order, insert[i]->pwd);
+                order += ')';
+            }
+            if (!insert.empty() && mysql_query(sql, order.c_str()))
+            {
+                LOG_ERROR("Register batch insert of %zu failed: %s", insert.size(), mysql_error(sql));
+                result = BatchResult::INSERT_FAILED;
+            }
+            else if (mysql_commit(sql))
+            {
+                LOG_ERROR("Register batch commit failed: %s", mysql_error(sql));
+            }
+            else
+            {
+                for (RegisterBatcher::Registration *r : insert)
+                {
+                    r->ok = true;
+                }
+                return BatchResult::COMMITTED;
+            }
+        }
+        else
+        {
+            LOG_ERROR("Failed to store result: %s", mysql_error(sql));
+        }
+
+        mysql_rollback(sql);
+        return result;
+    }
+}
+
+void RegisterBatcher::MySqlFlush(std::vector<Registration *> &batch)
+{
+    MYSQL *sql = nullptr;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    if (sql == nullptr)
+    {
+        LOG_ERROR("Register batch of %zu: no database connection", batch.size());
+        return;
+    }
+
+    // 批内去重：同名的后来者直接失败，与逐条注册的先后语义一致
+    std::unordered_set<std::string_view> seen;
+    std::vector<Registration *> fresh;
+    for (Registration *r : batch)
+    {
+        if (!r->name.empty() && !r->pwd.empty() && seen.insert(r->name).second)
+        {
+            fresh.push_back(r);
+        }
+    }
+    if (fresh.empty())
+    {
+        return;
+    }
+
+    mysql_autocommit(sql, 0);
+    if (CommitBatch(sql, fresh) == BatchResult::INSERT_FAILED && fresh.size() > 1)
+    {
+        // 一行不合法（如严格模式下用户名过长）会让整条多行 INSERT 失败；
+        // 逐条重试，只让出问题的注册失败，不连累同一批的其他用户
+        std::vector<Registration *> one(1);
+        for (Registration *r : fresh)
+        {
+            one[0] = r;
+            CommitBatch(sql, one);
+        }
+    }
+    mysql_autocommit(sql, 1); // 连接还回池中，恢复逐条提交
+}
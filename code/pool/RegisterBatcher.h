@@ -0,0 +1,71 @@
+#ifndef REGISTER_BATCHER_H
+#define REGISTER_BATCHER_H
+
+#include "RegisterBatcherOptions.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * 注册请求的批量提交（group commit）
+ * 调用线程把注册请求放进队列后等待；后台写线程收到第一条后再等一个很短的窗口（或凑满一批），
+ * 在一个事务里用一条 SELECT ... FOR UPDATE 找出已存在的用户名、一条多行 INSERT 写入其余的，
+ * 提交后唤醒这一批的所有请求。每个注册从两次往返加一次 fsync 变为整批共用。
+ * 多行 INSERT 失败时整批回滚后逐条重试，一行不合法只让它自己的注册失败。
+ * 写线程提交期间到达的请求自然攒成下一批，窗口为 0 时不额外增加延迟。
+ */
+class RegisterBatcher
+{
+public:
+    using Options = RegisterBatcherOptions;
+
+    struct Registration
+    {
+        std::string name;
+        std::string pwd; // 口令哈希
+        bool ok = false; // 由 Flush 填写：是否注册成功
+    };
+
+    // 在一个事务里处理一批注册并填写各项的 ok；批内同名的只有第一个可能成功
+    using Flush = std::function<void(std::vector<Registration *> &batch)>;
+
+    RegisterBatcher(const Options &options, Flush flush);
+
+    // 处理完已入队的注册后退出
+    ~RegisterBatcher();
+
+    RegisterBatcher(const RegisterBatcher &) = delete;
+    RegisterBatcher &operator=(const RegisterBatcher &) = delete;
+
+    // 注册一个用户，阻塞到所在的批次提交
+    bool Register(std::string_view name, std::string_view pwd);
+
+    // 写入 MySQL（SqlConnPool 中的连接）
+    static void MySqlFlush(std::vector<Registration *> &batch);
+
+private:
+    struct Pending
+    {
+        Registration reg;
+        bool done = false;
+    };
+
+    void Run_();
+
+    Options options_;
+    Flush flush_;
+    std::thread writer_;
+
+    std::mutex mtx_;
+    std::condition_variable cond_;     // 唤醒写线程
+    std::condition_variable doneCond_; // 唤醒等待提交的调用线程
+    std::deque<Pending *> queue_;
+    bool stop_;
+};
+
+#endif // REGISTER_BATCHER_H
@@ -0,0 +1,18 @@
+#ifndef REGISTER_BATCHER_OPTIONS_H
+#define REGISTER_BATCHER_OPTIONS_H
+
+#include <cstddef>
+#include <string>
+
+// 注册批量提交参数（RegisterBatcher::Options）
+struct RegisterBatcherOptions
+{
+    bool enabled = true;
+    size_t maxBatch = 32; // 一个事务最多处理的注册数
+    int windowUs = 1000;  // 第一条到达后最多再等待的时间
+
+    // 解析 "name=value"：on, batch, window；失败返回 false
+    bool Parse(const std::string &option);
+};
+
+#endif // REGISTER_BATCHER_OPTIONS_H
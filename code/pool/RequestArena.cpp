@@ -0,0 +1,14 @@
+#include "RequestArena.h"
+
+RequestArena::RequestArena(size_t blockSize)
+    : blockSize_(blockSize),
+      block_(new char[blockSize]),
+      resource_(block_.get(), blockSize, std::pmr::new_delete_resource())
+{
+}
+
+void RequestArena::Reset()
+{
+    // release() 会归还上游分配的溢出内存，并让下一次分配重新从 block_ 起始处开始
+    resource_.release();
+}
@@ -0,0 +1,39 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <memory>
+#include <memory_resource>
+
+/*
+ * 请求级单调内存区（arena）
+ * 每个连接持有一块固定大小的内存块，一次请求中的小对象（请求行、请求头、表单参数等）
+ * 都从这块内存上顺序分配，请求结束时整体释放，稳态下不再调用 malloc。
+ * 超出内存块大小的请求才会回退到上游（new/delete）分配。
+ */
+class RequestArena
+{
+public:
+    explicit RequestArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~RequestArena() = default;
+
+    RequestArena(const RequestArena &) = delete;
+    RequestArena &operator=(const RequestArena &) = delete;
+
+    // 获取 pmr 内存资源，供 std::pmr 容器使用
+    std::pmr::memory_resource *Resource() { return &resource_; }
+
+    // 整体释放本次请求分配的所有内存（调用前所有使用者必须已释放或重建）
+    void Reset();
+
+    // 内存块大小
+    size_t BlockSize() const { return blockSize_; }
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+private:
+    size_t blockSize_;
+    std::unique_ptr<char[]> block_;               // 初始内存块，连接生命周期内只分配一次
+    std::pmr::monotonic_buffer_resource resource_; // 在 block_ 上顺序分配
+};
+
+#endif // REQUEST_ARENA_H
@@ -4,11 +4,23 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
+#include <cerrno>
+#include <ctime>
+#include "../log/Log.h"
+
+namespace
+{
+    int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+}
 
 SqlConnPool::SqlConnPool()
-    : MAX_CONN_(0), useCount_(0), freeCount_(0)
+    : nextReplica_(0), closed_(false)
 {
-    sem_init(&semId_, 0, 0); // 初始化信号量
 }
 
 SqlConnPool *SqlConnPool::Instance()
@@ -17,42 +29,64 @@ SqlConnPool *SqlConnPool::Instance()
     return &instance;
 }
 
-// 初始化连接池
+// 初始化连接池（主库）
 void SqlConnPool::Init(const char *host, int port,
                        const char *user, const char *pwd,
                        const char *dbName, int connSize)
 {
-    if (connSize <= 0 || host == nullptr || user == nullptr || pwd == nullptr || dbName == nullptr)
+    if (!endpoints_.empty())
     {
-        std::cerr << "Invalid database connection pool parameters." << std::endl;
+        LOG_ERROR("Database connection pool already initialized.");
         return;
     }
+    AddEndpoint_("primary", false, host, port, user, pwd, dbName, connSize);
+}
 
-    // std::cout << "MySQL Connection Parameters:" << std::endl;
-    // std::cout << "Host: " << (host ? host : "NULL") << std::endl;
-    // std::cout << "Port: " << port << std::endl;
-    // std::cout << "User: " << (user ? user : "NULL") << std::endl;
-    // std::cout << "Password: " << (pwd ? pwd : "NULL") << std::endl;
-    // std::cout << "Database Name: " << (dbName ? dbName : "NULL") << std::endl;
-    // std::cout << "Connection Pool Size: " << connSize << std::endl;
+void SqlConnPool::AddReplica(const std::string &name, const char *host, int port,
+                             const char *user, const char *pwd,
+                             const char *dbName, int connSize)
+{
+    if (endpoints_.empty())
+    {
+        LOG_ERROR("Replica %s added before the primary.", name.c_str());
+        return;
+    }
+    AddEndpoint_(name, true, host, port, user, pwd, dbName, connSize);
+}
 
-    MAX_CONN_ = connSize; // 先设置最大连接数
+SqlConnPool::Endpoint *SqlConnPool::AddEndpoint_(const std::string &name, bool replica, const char *host, int port,
+                                                 const char *user, const char *pwd, const char *dbName, int connSize)
+{
+    if (connSize <= 0 || host == nullptr || user == nullptr || pwd == nullptr || dbName == nullptr)
+    {
+        LOG_ERROR("Invalid database connection pool parameters.");
+        return nullptr;
+    }
 
-    for (int i = 0; i < MAX_CONN_; ++i)
+    auto ep = std::make_unique<Endpoint>();
+    ep->name = name;
+    ep->replica = replica;
+    for (int i = 0; i < connSize; ++i)
     {
         MYSQL *conn = createConn(host, port, user, pwd, dbName);
         if (conn)
         {
-            connQue_.push(conn);
-            ++freeCount_;
+            ep->connQue.push(conn);
+            owner_[conn] = ep.get();
         }
         else
         {
-            std::cerr << "Failed to create MySQL connection at index " << i << std::endl;
+            LOG_ERROR("Failed to create MySQL connection %d to %s (%s:%d)", i, name.c_str(), host, port);
         }
     }
+    // 只按实际建立的连接数发放名额，避免取到空队列
+    ep->size = static_cast<int>(ep->connQue.size());
+    sem_init(&ep->semId, 0, ep->size);
+    LOG_INFO("Database %s %s:%d, %d connections%s", name.c_str(), host, port, ep->size,
+             replica ? " (read replica)" : "");
 
-    sem_init(&semId_, 0, MAX_CONN_);
+    endpoints_.push_back(std::move(ep));
+    return endpoints_.back().get();
 }
 
 // 创建数据库连接
@@ -63,35 +97,121 @@ MYSQL *SqlConnPool::createConn(const char *host, int port,
     MYSQL *conn = mysql_init(nullptr);
     if (!conn || !mysql_real_connect(conn, host, user, pwd, dbName, port, nullptr, 0))
     {
-        std::cerr << "MySQL connection error: " << mysql_error(conn) << std::endl;
+        LOG_ERROR("MySQL connection error: %s", mysql_error(conn));
+        if (conn)
+            mysql_close(conn);
         return nullptr;
     }
     return conn;
 }
 
-// 获取连接（支持超时等待）
-MYSQL *SqlConnPool::GetConn(int timeout_ms)
+MYSQL *SqlConnPool::Take_(Endpoint &ep)
 {
     MYSQL *sql = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!ep.connQue.empty())
+        {
+            sql = ep.connQue.front();
+            ep.connQue.pop();
+        }
+    }
+    if (sql)
+        ++ep.outstanding;
+    return sql;
+}
+
+bool SqlConnPool::Wait_(Endpoint &ep, int timeout_ms)
+{
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    int ret;
+    while ((ret = sem_timedwait(&ep.semId, &deadline)) != 0 && errno == EINTR)
+    {
+    }
+    return ret == 0;
+}
+
+// 获取主库连接，timeout_ms 内等不到空闲连接时返回 nullptr
+MYSQL *SqlConnPool::GetConn(int timeout_ms)
+{
+    if (endpoints_.empty())
+        return nullptr;
 
-    if (sem_wait(&semId_) != 0)
+    Endpoint &primary = *endpoints_[0];
+    if (primary.size == 0)
+        return nullptr; // 一个连接也没建立起来，等待没有意义
+    if (!Wait_(primary, timeout_ms))
     {
-        std::cerr << "Failed to acquire semaphore." << std::endl;
+        LOG_WARN("No free primary connection after %d ms", timeout_ms);
         return nullptr;
     }
+    MYSQL *sql = Take_(primary);
+    if (sql == nullptr)
+        sem_post(&primary.semId);
+    return sql;
+}
 
+// 获取只读连接：在健康的从库中选未完成请求最少的一个
+MYSQL *SqlConnPool::GetReadConn(int timeout_ms)
+{
+    Endpoint *best = nullptr;
+    int64_t now = NowMs();
+    size_t replicas = endpoints_.size() > 1 ? endpoints_.size() - 1 : 0;
+    size_t start = replicas ? nextReplica_.fetch_add(1, std::memory_order_relaxed) % replicas : 0; // 负载相同时轮流
+    for (size_t k = 0; k < replicas; ++k)
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (!connQue_.empty())
+        Endpoint *ep = endpoints_[1 + (start + k) % replicas].get();
+        if (ep->size == 0 || ep->downUntilMs.load(std::memory_order_relaxed) > now)
+            continue;
+        if (best == nullptr || ep->outstanding.load(std::memory_order_relaxed) <
+                                   best->outstanding.load(std::memory_order_relaxed))
+            best = ep;
+    }
+
+    if (best)
+    {
+        if (Wait_(*best, timeout_ms))
         {
-            sql = connQue_.front();
-            connQue_.pop();
-            --freeCount_;
-            ++useCount_;
+            if (MYSQL *sql = Take_(*best))
+                return sql;
+            sem_post(&best->semId);
         }
+        LOG_DEBUG("Replica %s busy, reading from primary", best->name.c_str());
     }
+    return GetConn(); // timeout_ms 只限制等从库的时间，主库按默认期限等待
+}
 
-    return sql;
+SqlConnPool::Endpoint *SqlConnPool::Owner_(MYSQL *conn) const
+{
+    auto it = owner_.find(conn);
+    return it == owner_.end() ? nullptr : it->second;
+}
+
+bool SqlConnPool::IsReplica(MYSQL *conn) const
+{
+    Endpoint *ep = Owner_(conn);
+    return ep && ep->replica;
+}
+
+void SqlConnPool::ReportFailure(MYSQL *conn)
+{
+    Endpoint *ep = Owner_(conn);
+    if (ep == nullptr || !ep->replica)
+        return;
+    int64_t now = NowMs();
+    if (ep->downUntilMs.exchange(now + FAIL_COOLDOWN_MS) <= now)
+    {
+        LOG_WARN("Replica %s failed (%s), reads go to other endpoints for %d ms",
+                 ep->name.c_str(), mysql_error(conn), FAIL_COOLDOWN_MS);
+    }
 }
 
 // 释放连接
@@ -100,25 +220,37 @@ void SqlConnPool::FreeConn(MYSQL *conn)
     if (!conn)
         return;
 
-    std::lock_guard<std::mutex> lock(mtx_);
-    connQue_.push(conn);
-    ++freeCount_;
-    --useCount_;
-    sem_post(&semId_);
+    Endpoint *ep = Owner_(conn);
+    if (ep == nullptr)
+    {
+        LOG_ERROR("Freeing a connection that does not belong to the pool.");
+        return;
+    }
+    --ep->outstanding;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ep->connQue.push(conn);
+    }
+    sem_post(&ep->semId);
 }
 
 // 关闭连接池
 void SqlConnPool::ClosePool()
 {
     std::lock_guard<std::mutex> lock(mtx_);
-    while (!connQue_.empty())
+    if (closed_)
+        return;
+    closed_ = true;
+    for (auto &ep : endpoints_)
     {
-        MYSQL *conn = connQue_.front();
-        connQue_.pop();
-        closeConn(conn);
+        while (!ep->connQue.empty())
+        {
+            MYSQL *conn = ep->connQue.front();
+            ep->connQue.pop();
+            closeConn(conn);
+        }
+        sem_destroy(&ep->semId);
     }
-
-    sem_destroy(&semId_);
 }
 
 // 关闭单个连接
@@ -130,10 +262,16 @@ void SqlConnPool::closeConn(MYSQL *conn)
     }
 }
 
-// 获取空闲连接数
+// 获取空闲连接数（所有端点之和）
 int SqlConnPool::GetFreeConnCount() const
 {
-    return freeCount_;
+    std::lock_guard<std::mutex> lock(mtx_);
+    int count = 0;
+    for (auto &ep : endpoints_)
+    {
+        count += static_cast<int>(ep->connQue.size());
+    }
+    return count;
 }
 
 // 析构函数
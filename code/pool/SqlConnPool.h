@@ -9,23 +9,60 @@
 #include <atomic>
 #include <thread>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
+/*
+ * 数据库连接池：一个主库加若干只读从库，每个端点有自己的连接队列
+ * 写操作和需要读到最新数据的查询用 GetConn（主库）；只读查询用 GetReadConn，
+ * 选未完成请求最少的健康从库，从库都不可用或等待超时时退回主库。
+ * 从库出错后由调用者 ReportFailure，该从库在一段时间内不再被选中。
+ */
 class SqlConnPool
 {
 public:
     static SqlConnPool *Instance();
 
-    MYSQL *GetConn(int timeout_ms = 1000); // 连接获取，支持超时
-    void FreeConn(MYSQL *conn);
+    MYSQL *GetConn(int timeout_ms = 1000); // 主库连接，超时返回 nullptr
+    MYSQL *GetReadConn(int timeout_ms = 100); // 只读连接：从库优先，不可用或等待超时时为主库连接
+    void FreeConn(MYSQL *conn);            // 归还到连接所属的端点
     int GetFreeConnCount() const;
 
+    // 初始化主库
     void Init(const char *host, int port,
               const char *user, const char *pwd,
               const char *dbName, int connSize);
+
+    // 增加一个只读从库，需在 Init 之后、开始处理请求之前调用
+    void AddReplica(const std::string &name, const char *host, int port,
+                    const char *user, const char *pwd,
+                    const char *dbName, int connSize);
+
+    // 连接是否来自从库
+    bool IsReplica(MYSQL *conn) const;
+
+    // 从库上的查询失败：该从库暂停使用 FAIL_COOLDOWN_MS 毫秒
+    void ReportFailure(MYSQL *conn);
+
     void ClosePool();
     ~SqlConnPool();
 
 private:
+    // 一个数据库端点（主库或从库）
+    struct Endpoint
+    {
+        std::string name;
+        bool replica = false;
+        int size = 0;
+        std::queue<MYSQL *> connQue;               // 空闲连接
+        sem_t semId;                               // 空闲连接数
+        std::atomic<int> outstanding{0};           // 已借出的连接数，用于最少未完成请求的选择
+        std::atomic<int64_t> downUntilMs{0};       // 出错后暂停使用到此时刻
+    };
+
+    static constexpr int FAIL_COOLDOWN_MS = 5000;
+
     SqlConnPool();
     MYSQL *createConn(const char *host, int port,
                       const char *user, const char *pwd,
@@ -33,14 +70,17 @@ private:
 
     void closeConn(MYSQL *conn); // 关闭连接并清理资源
 
+    Endpoint *AddEndpoint_(const std::string &name, bool replica, const char *host, int port,
+                           const char *user, const char *pwd, const char *dbName, int connSize);
+    bool Wait_(Endpoint &ep, int timeout_ms); // 在 ep.semId 上最多等待 timeout_ms，超时返回 false
+    MYSQL *Take_(Endpoint &ep); // 调用前已在 ep.semId 上等到一个名额
+    Endpoint *Owner_(MYSQL *conn) const;
 
-    int MAX_CONN_;  // 最大连接数
-    int useCount_;  // 当前使用的连接数
-    int freeCount_; // 当前空闲的连接数
-
-    std::queue<MYSQL *> connQue_;  // 存放空闲连接的队列
-    mutable std::mutex mtx_;       // 保护 connQue_ 的线程安全
-    sem_t semId_;                  // 信号量控制可用连接数
+    std::vector<std::unique_ptr<Endpoint>> endpoints_; // endpoints_[0] 为主库
+    std::unordered_map<MYSQL *, Endpoint *> owner_;     // 连接所属的端点，初始化后只读
+    mutable std::mutex mtx_;                            // 保护各端点的 connQue
+    std::atomic<size_t> nextReplica_;                   // 从库的起始查找位置
+    bool closed_;
 };
 
 #endif // SQLCONNPOOL_H
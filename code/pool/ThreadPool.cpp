@@ -1,4 +1,5 @@
 #include "ThreadPool.h"
+#include "../log/Log.h"
 
 // 构造函数
 ThreadPool::ThreadPool(int minThreads, int maxThreads )
@@ -20,14 +21,25 @@ ThreadPool::ThreadPool(int minThreads, int maxThreads )
     // 启动管理线程
     m_managerThread = std::thread(&ThreadPool::manager, this);
 
-    std::cout << "ThreadPool initialized with " << m_minThreads << " threads." << std::endl;
+    LOG_INFO("ThreadPool initialized with %d threads.", m_minThreads);
 }
 
 // 析构函数
 ThreadPool::~ThreadPool()
 {
-    m_stop = true;
+    {
+        // 在锁内置位，避免工作线程检查完条件、尚未睡眠时错过通知
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stop = true;
+    }
     m_condition.notify_all();
+    m_managerCondition.notify_all();
+
+    // 先等待管理线程退出，之后 m_workers 不会再被修改
+    if (m_managerThread.joinable())
+    {
+        m_managerThread.join();
+    }
 
     // 等待所有工作线程退出
     for (auto &thread : m_workers)
@@ -38,33 +50,26 @@ ThreadPool::~ThreadPool()
         }
     }
 
-    // 等待管理线程退出
-    if (m_managerThread.joinable())
-    {
-        m_managerThread.join();
-    }
-
     //std::cout << "ThreadPool destroyed." << std::endl;
 }
 
-// 工作线程函数
+// 工作线程函数：停止后先把已入队的任务执行完再退出，入队的任务不会被丢弃
 void ThreadPool::worker()
 {
-    while (!m_stop)
+    while (true)
     {
         std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(m_queueMutex);
             m_condition.wait(lock, [this]()
-                             { return m_stop || !m_tasks.empty(); });
+                             { return m_stop || m_taskCount > 0; });
 
-            if (m_stop && m_tasks.empty())
+            if (m_stop && m_taskCount == 0)
             {
                 break;
             }
 
-            task = std::move(m_tasks.front());
-            m_tasks.pop();
+            task = popTask_();
             --m_idleThreads;
         }
 
@@ -75,21 +80,54 @@ void ThreadPool::worker()
         }
         catch (const std::exception &e)
         {
-            std::cerr << "Exception in task: " << e.what() << std::endl;
+            LOG_ERROR("Exception in task: %s", e.what());
         }
 
         ++m_idleThreads;
     }
 }
 
+// 任务入队：队列满时容量翻倍并按顺序搬移
+void ThreadPool::pushTask_(std::function<void()> &&task)
+{
+    if (m_taskCount == m_tasks.size())
+    {
+        std::vector<std::function<void()>> grown(m_tasks.empty() ? 64 : m_tasks.size() * 2);
+        for (size_t i = 0; i < m_taskCount; ++i)
+        {
+            grown[i] = std::move(m_tasks[(m_taskHead + i) % m_tasks.size()]);
+        }
+        m_tasks.swap(grown);
+        m_taskHead = 0;
+    }
+    m_tasks[(m_taskHead + m_taskCount) % m_tasks.size()] = std::move(task);
+    ++m_taskCount;
+}
+
+// 任务出队
+std::function<void()> ThreadPool::popTask_()
+{
+    std::function<void()> task = std::move(m_tasks[m_taskHead]);
+    m_tasks[m_taskHead] = nullptr;
+    m_taskHead = (m_taskHead + 1) % m_tasks.size();
+    --m_taskCount;
+    return task;
+}
+
 // 管理线程函数
 void ThreadPool::manager()
 {
     while (!m_stop)
     {
-        std::this_thread::sleep_for(std::chrono::seconds(5)); // 每5秒检查一次
+        // 每5秒检查一次，线程池停止时立即醒来
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        if (m_managerCondition.wait_for(lock, std::chrono::seconds(5), [this]()
+                                        { return m_stop.load(); }))
+        {
+            break;
+        }
 
-        if (m_tasks.size() > m_idleThreads && m_curThreads < m_maxThreads)
+        if (m_taskCount > static_cast<size_t>(m_idleThreads) && m_curThreads < m_maxThreads)
         {
             // 增加线程
             m_workers.emplace_back(&ThreadPool::worker, this);
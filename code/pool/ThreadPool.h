@@ -14,6 +14,8 @@ class ThreadPool
 {
 public:
     ThreadPool(int min = 4, int max = std::thread::hardware_concurrency());
+
+    // 执行完所有已入队的任务后再回收线程
     ~ThreadPool();
 
     // 添加任务，支持返回值
@@ -28,18 +30,60 @@ public:
 
         {
             std::unique_lock<std::mutex> lock(m_queueMutex);
-            m_tasks.emplace([task]()
-                            { (*task)(); });
+            pushTask_([task]()
+                      { (*task)(); });
         }
 
         m_condition.notify_one();
         return task->get_future();
     }
 
+    // 添加不需要返回值的任务：不创建 packaged_task/future，
+    // 小的可平凡拷贝的闭包（如 [this, fd]）直接存放在 std::function 内部，不分配内存
+    template <typename Func>
+    void addDetachedTask(Func &&func)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            pushTask_(std::function<void()>(std::forward<Func>(func)));
+        }
+        m_condition.notify_one();
+    }
+
+    // 有界入队：排队任务已达 maxQueue 或线程池已停止时不入队，返回 false
+    template <typename Func>
+    bool tryAddDetachedTask(Func &&func, size_t maxQueue)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            if (m_stop || m_taskCount >= maxQueue)
+            {
+                return false;
+            }
+            pushTask_(std::function<void()>(std::forward<Func>(func)));
+        }
+        m_condition.notify_one();
+        return true;
+    }
+
+    // 当前排队的任务数
+    size_t QueueSize()
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        return m_taskCount;
+    }
+
+    // 当前线程数
+    int ThreadCount() const { return m_curThreads; }
+
 private:
     void manager(); // 管理者线程
     void worker();  // 工作线程
 
+    // 环形任务队列操作，调用者需持有 m_queueMutex
+    void pushTask_(std::function<void()> &&task);
+    std::function<void()> popTask_();
+
 private:
     std::thread m_managerThread;        // 管理者线程
     std::vector<std::thread> m_workers; // 工作线程集合
@@ -48,9 +92,13 @@ private:
     std::atomic<int> m_curThreads;  // 当前线程数
     std::atomic<int> m_idleThreads; // 空闲线程数
 
-    std::queue<std::function<void()>> m_tasks; // 任务队列
+    // 任务队列：容量只增不减的环形数组，稳态下入队出队不分配内存
+    std::vector<std::function<void()>> m_tasks;
+    size_t m_taskHead = 0;  // 队头下标
+    size_t m_taskCount = 0; // 队列中的任务数
     std::mutex m_queueMutex;                   // 任务队列互斥锁
     std::condition_variable m_condition;       // 条件变量
+    std::condition_variable m_managerCondition; // 唤醒管理者线程
     const int m_maxThreads;                    // 最大线程数
     const int m_minThreads;                    // 最小线程数
 };
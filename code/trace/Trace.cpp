@@ -0,0 +1,334 @@
+#include "Trace.h"
+#include "../log/Log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace
+{
+    // Tracer::Init 校准之后才改用 rdtsc，未开启追踪时不必付出校准的等待
+    std::atomic<bool> useTsc{false};
+}
+
+uint64_t ReadTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (useTsc.load(std::memory_order_relaxed))
+    {
+        return __rdtsc();
+    }
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// ---------------- RequestTrace ----------------
+
+void RequestTrace::Begin(uint64_t enqueueTsc, uint64_t dequeueTsc)
+{
+    std::fill(std::begin(stamps_), std::end(stamps_), 0);
+    stamps_[ENQUEUE] = enqueueTsc;
+    stamps_[DEQUEUE] = dequeueTsc;
+    writeBlocks_ = 0;
+}
+
+// ---------------- Tracer ----------------
+
+namespace
+{
+    const char *const SPAN_NAMES[] = {"queue", "parse", "db", "file", "write"};
+    // 每个子阶段对应的起止打点
+    const RequestTrace::Point SPAN_POINTS[][2] = {
+        {RequestTrace::ENQUEUE, RequestTrace::DEQUEUE},
+        {RequestTrace::PARSE_BEGIN, RequestTrace::PARSE_END},
+        {RequestTrace::DB_BEGIN, RequestTrace::DB_END},
+        {RequestTrace::FILE_BEGIN, RequestTrace::FILE_END},
+        {RequestTrace::WRITE_BEGIN, RequestTrace::WRITE_END},
+    };
+
+    void AppendJsonString(std::string &out, const char *s)
+    {
+        out += '"';
+        for (; *s; ++s)
+        {
+            unsigned char ch = static_cast<unsigned char>(*s);
+            if (ch == '"' || ch == '\\')
+            {
+                out += '\\';
+                out += static_cast<char>(ch);
+            }
+            else if (ch < 0x20)
+            {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", ch);
+                out += esc;
+            }
+            else
+            {
+                out += static_cast<char>(ch);
+            }
+        }
+        out += '"';
+    }
+}
+
+Tracer *Tracer::Instance()
+{
+    static Tracer instance;
+    return &instance;
+}
+
+Tracer::Tracer()
+{
+    // 校准之前 ReadTsc 返回单调时钟的纳秒数
+    baseTsc_ = ReadTsc();
+    baseUnixNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+}
+
+Tracer::~Tracer()
+{
+    Stop();
+}
+
+void Tracer::Calibrate_()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // 用 20ms 的单调时钟区间换算 tsc 频率
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t c1 = __rdtsc();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    nsPerTick_ = c1 > c0 ? ns / static_cast<double>(c1 - c0) : 1.0;
+    useTsc.store(true, std::memory_order_relaxed);
+#endif
+
+    baseTsc_ = ReadTsc();
+    baseUnixNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+}
+
+bool Tracer::Init(const std::string &path, Format format, uint32_t sampleEvery, uint64_t slowUs)
+{
+    if (path.empty() || enabled_)
+    {
+        return enabled_;
+    }
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("Failed to open trace file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    Calibrate_(); // 在开始接受请求之前切换时钟，不会有跨两种时钟的打点
+    format_ = format;
+    sampleEvery_ = std::max<uint32_t>(sampleEvery, 1);
+    slowTicks_ = static_cast<uint64_t>(slowUs * 1000 / nsPerTick_);
+    firstEvent_ = true;
+    if (format_ == CHROME)
+    {
+        (void)!write(fd_, "[\n", 2);
+    }
+    enabled_ = true;
+    flusher_ = std::thread(&Tracer::FlushLoop_, this);
+    LOG_INFO("tracing to %s (1 in %u, slow > %luus, %.3f ns/tick)", path.c_str(), sampleEvery_, slowUs, nsPerTick_);
+    return true;
+}
+
+void Tracer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!enabled_)
+        {
+            return;
+        }
+        enabled_ = false;
+    }
+    cond_.notify_all();
+    if (flusher_.joinable())
+    {
+        flusher_.join();
+    }
+    if (format_ == CHROME)
+    {
+        (void)!write(fd_, "\n]\n", 3);
+    }
+    close(fd_);
+    fd_ = -1;
+}
+
+void Tracer::Finish(const RequestTrace &trace, int fd, std::string_view method, std::string_view path, int status)
+{
+    if (!enabled_ || !trace.Active())
+    {
+        return;
+    }
+    uint64_t begin = trace.Stamp(RequestTrace::ENQUEUE) ? trace.Stamp(RequestTrace::ENQUEUE)
+                                                        : trace.Stamp(RequestTrace::DEQUEUE);
+    uint64_t total = trace.Stamp(RequestTrace::WRITE_END) - begin;
+
+    // 采样计数按线程各自累加，不在热路径上竞争同一个原子变量
+    thread_local uint32_t counter = 0;
+    bool sampled = (++counter % sampleEvery_) == 0;
+    if (!sampled && total < slowTicks_)
+    {
+        return;
+    }
+
+    Record rec;
+    for (int i = 0; i < RequestTrace::POINT_COUNT; ++i)
+    {
+        rec.stamps[i] = trace.Stamp(static_cast<RequestTrace::Point>(i));
+    }
+    rec.stamps[RequestTrace::ENQUEUE] = begin;
+    rec.writeBlocks = trace.WriteBlocks();
+    rec.fd = fd;
+    rec.status = status;
+    rec.id = seq_.fetch_add(1, std::memory_order_relaxed);
+    snprintf(rec.method, sizeof(rec.method), "%.*s", static_cast<int>(method.size()), method.data());
+    snprintf(rec.path, sizeof(rec.path), "%.*s", static_cast<int>(path.size()), path.data());
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (pending_.size() < MAX_PENDING)
+    {
+        pending_.push_back(rec);
+    }
+}
+
+uint64_t Tracer::ToUnixNs_(uint64_t tsc) const
+{
+    return baseUnixNs_ + static_cast<int64_t>((static_cast<int64_t>(tsc - baseTsc_)) * nsPerTick_);
+}
+
+void Tracer::WriteChrome_(const Record &rec, std::string &out)
+{
+    char buf[256];
+    pid_t pid = getpid();
+    uint64_t begin = rec.stamps[RequestTrace::ENQUEUE];
+    uint64_t end = rec.stamps[RequestTrace::WRITE_END];
+
+    // 整个请求作为父事件，各阶段作为嵌套的子事件；时间单位为微秒
+    out += firstEvent_ ? "" : ",\n";
+    firstEvent_ = false;
+    snprintf(buf, sizeof(buf), "{\"name\":\"%s ", rec.method);
+    out += buf;
+    std::string name;
+    AppendJsonString(name, rec.path);
+    out.append(name, 1, name.size() - 2);
+    snprintf(buf, sizeof(buf),
+             "\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+             "\"args\":{\"status\":%d,\"id\":%lu,\"write_blocks\":%u}}",
+             ToUnixNs_(begin) / 1e3, TscToNs(end - begin) / 1e3, pid, rec.fd, rec.status, rec.id, rec.writeBlocks);
+    out += buf;
+
+    for (size_t i = 0; i < sizeof(SPAN_POINTS) / sizeof(SPAN_POINTS[0]); ++i)
+    {
+        uint64_t s = rec.stamps[SPAN_POINTS[i][0]];
+        uint64_t e = rec.stamps[SPAN_POINTS[i][1]];
+        if (s == 0 || e < s)
+        {
+            continue;
+        }
+        snprintf(buf, sizeof(buf),
+                 ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                 SPAN_NAMES[i], ToUnixNs_(s) / 1e3, TscToNs(e - s) / 1e3, pid, rec.fd);
+        out += buf;
+    }
+}
+
+void Tracer::WriteOtlp_(const Record &rec, std::string &out)
+{
+    char buf[512];
+    char traceId[33];
+    snprintf(traceId, sizeof(traceId), "%016lx%016lx", static_cast<uint64_t>(getpid()), rec.id + 1);
+    uint64_t begin = rec.stamps[RequestTrace::ENQUEUE];
+    uint64_t end = rec.stamps[RequestTrace::WRITE_END];
+
+    out += "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\","
+           "\"value\":{\"stringValue\":\"myWebServer\"}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"myWebServer\"},"
+           "\"spans\":[";
+    std::string path;
+    AppendJsonString(path, rec.path);
+    snprintf(buf, sizeof(buf),
+             "{\"traceId\":\"%s\",\"spanId\":\"%016lx\",\"name\":\"%s\",\"kind\":2,"
+             "\"startTimeUnixNano\":\"%lu\",\"endTimeUnixNano\":\"%lu\",\"attributes\":["
+             "{\"key\":\"http.request.method\",\"value\":{\"stringValue\":\"%s\"}},"
+             "{\"key\":\"http.response.status_code\",\"value\":{\"intValue\":\"%d\"}},"
+             "{\"key\":\"write_blocks\",\"value\":{\"intValue\":\"%u\"}},"
+             "{\"key\":\"url.path\",\"value\":{\"stringValue\":",
+             traceId, (rec.id + 1) << 3, rec.method, ToUnixNs_(begin), ToUnixNs_(end), rec.method, rec.status,
+             rec.writeBlocks);
+    out += buf;
+    out += path;
+    out += "}}]}";
+
+    for (size_t i = 0; i < sizeof(SPAN_POINTS) / sizeof(SPAN_POINTS[0]); ++i)
+    {
+        uint64_t s = rec.stamps[SPAN_POINTS[i][0]];
+        uint64_t e = rec.stamps[SPAN_POINTS[i][1]];
+        if (s == 0 || e < s)
+        {
+            continue;
+        }
+        snprintf(buf, sizeof(buf),
+                 ",{\"traceId\":\"%s\",\"spanId\":\"%016lx\",\"parentSpanId\":\"%016lx\",\"name\":\"%s\","
+                 "\"kind\":1,\"startTimeUnixNano\":\"%lu\",\"endTimeUnixNano\":\"%lu\"}",
+                 traceId, ((rec.id + 1) << 3) + i + 1, (rec.id + 1) << 3, SPAN_NAMES[i], ToUnixNs_(s), ToUnixNs_(e));
+        out += buf;
+    }
+    out += "]}]}]}\n";
+}
+
+void Tracer::FlushLoop_()
+{
+    std::vector<Record> batch;
+    std::string out;
+    bool running = true;
+    while (running)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cond_.wait_for(lock, std::chrono::seconds(1), [this]()
+                           { return !enabled_; });
+            running = enabled_;
+            batch.swap(pending_);
+        }
+
+        out.clear();
+        for (const Record &rec : batch)
+        {
+            if (format_ == CHROME)
+            {
+                WriteChrome_(rec, out);
+            }
+            else
+            {
+                WriteOtlp_(rec, out);
+            }
+        }
+        batch.clear();
+
+        size_t off = 0;
+        while (off < out.size())
+        {
+            ssize_t n = write(fd_, out.data() + off, out.size() - off);
+            if (n <= 0)
+            {
+                break;
+            }
+            off += n;
+        }
+    }
+}
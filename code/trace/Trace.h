@@ -0,0 +1,120 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "TraceFormat.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// 读取时间戳计数器：开启追踪（完成 tsc 校准）后在 x86 上使用 rdtsc，否则为单调时钟的纳秒数
+uint64_t ReadTsc();
+
+/*
+ * 单个请求的阶段时间戳
+ * 每个连接持有一份，请求处理路径上只做 rdtsc 打点；请求结束时再决定是否导出。
+ */
+class RequestTrace
+{
+public:
+    enum Point
+    {
+        ENQUEUE,     // reactor 把读事件投递到线程池
+        DEQUEUE,     // 工作线程开始处理
+        PARSE_BEGIN, // 开始解析
+        PARSE_END,
+        DB_BEGIN, // 数据库访问（LookupPassword / AddUser）
+        DB_END,
+        FILE_BEGIN, // HttpResponse::Init 的 stat/open/mmap
+        FILE_END,
+        WRITE_BEGIN, // 响应准备好，开始写
+        WRITE_END,   // 响应全部写完
+        POINT_COUNT,
+    };
+
+    // 开始一个新请求，沿用读事件投递/出队时记下的时间
+    void Begin(uint64_t enqueueTsc, uint64_t dequeueTsc);
+    void Reset() { Begin(0, 0); }
+    void Mark(Point point) { stamps_[point] = ReadTsc(); }
+    void CountWriteBlock() { ++writeBlocks_; }
+
+    uint64_t Stamp(Point point) const { return stamps_[point]; }
+    uint32_t WriteBlocks() const { return writeBlocks_; }
+    bool Active() const { return stamps_[DEQUEUE] != 0; }
+
+private:
+    uint64_t stamps_[POINT_COUNT] = {};
+    uint32_t writeBlocks_ = 0; // 写时遇到 EAGAIN 的次数（写背压）
+};
+
+/*
+ * 慢请求与采样追踪导出
+ * 采样策略：每 N 个请求导出 1 个，另外总耗时超过阈值的请求总是导出。
+ * 导出的记录由后台线程写入本地文件，格式为 Chrome trace JSON 或 OTLP-JSON（每行一个对象）。
+ */
+class Tracer
+{
+public:
+    using Format = TraceFormat;
+    static constexpr Format CHROME = TraceFormat::CHROME;
+    static constexpr Format OTLP = TraceFormat::OTLP;
+
+    static Tracer *Instance();
+
+    // path 为空表示关闭追踪；开启时才校准 tsc（约 20ms），之前的时间戳按纳秒计
+    bool Init(const std::string &path, Format format, uint32_t sampleEvery, uint64_t slowUs);
+    void Stop();
+    bool Enabled() const { return enabled_; }
+
+    // 请求结束时调用：按采样策略决定是否导出
+    void Finish(const RequestTrace &trace, int fd, std::string_view method, std::string_view path, int status);
+
+    // tsc 与纳秒的换算
+    double TscToNs(uint64_t ticks) const { return ticks * nsPerTick_; }
+
+    ~Tracer();
+
+private:
+    Tracer();
+
+    struct Record
+    {
+        uint64_t stamps[RequestTrace::POINT_COUNT];
+        uint32_t writeBlocks;
+        int fd;
+        int status;
+        uint64_t id;
+        char method[8];
+        char path[96];
+    };
+
+    void Calibrate_();
+    void FlushLoop_();
+    void WriteChrome_(const Record &rec, std::string &out);
+    void WriteOtlp_(const Record &rec, std::string &out);
+    uint64_t ToUnixNs_(uint64_t tsc) const;
+
+    std::atomic<bool> enabled_{false};
+    Format format_ = CHROME;
+    uint32_t sampleEvery_ = 1000;
+    uint64_t slowTicks_ = 0;
+    std::atomic<uint64_t> seq_{0}; // 导出记录编号
+
+    double nsPerTick_ = 1.0;
+    uint64_t baseTsc_ = 0;    // 校准时刻的 tsc
+    uint64_t baseUnixNs_ = 0; // 校准时刻的墙上时间
+
+    std::mutex mtx_; // 保护 pending_，只有被选中导出的请求才会进入
+    std::condition_variable cond_;
+    std::vector<Record> pending_;
+    std::thread flusher_;
+    int fd_ = -1;
+    bool firstEvent_ = true;
+    static constexpr size_t MAX_PENDING = 4096; // 超出时丢弃，避免导出拖慢请求
+};
+
+#endif // TRACE_H
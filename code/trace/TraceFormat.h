@@ -0,0 +1,11 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+// 追踪导出格式（Tracer::Format）
+enum class TraceFormat
+{
+    CHROME, // Chrome trace JSON
+    OTLP,   // OTLP-JSON，每行一个对象
+};
+
+#endif // TRACE_FORMAT_H
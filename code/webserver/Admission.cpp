@@ -0,0 +1,87 @@
+#include "Admission.h"
+#include "OptionParse.h"
+#include "../metrics/Metrics.h"
+#include "../trace/Trace.h"
+#include <cstdio>
+#include <cstdlib>
+
+bool AdmissionOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "target")
+        return OptionParse::Number<uint64_t>(value, targetUs, 1); // 为 0 时每个请求都算超标
+    if (name == "interval")
+        return OptionParse::Number<uint64_t>(value, intervalUs, 1);
+    if (name == "inflight")
+        return OptionParse::Number(value, maxInflight, 0);
+    if (name == "retry")
+        return OptionParse::Number(value, retryAfterSec, 0);
+    if (name == "maxconn")
+        return OptionParse::Number(value, maxConnections, 1);
+    return false;
+}
+
+AdmissionControl::AdmissionControl(const Options &options, int workers)
+    : options_(options), workers_(workers),
+      targetNs_(options.targetUs * 1000), intervalNs_(options.intervalUs * 1000)
+{
+    static const char body[] = "<html><body><h1>Service Unavailable</h1></body></html>";
+    char head[256];
+    snprintf(head, sizeof(head),
+             "HTTP/1.1 503 Service Unavailable\r\n"
+             "Retry-After: %d\r\n"
+             "Connection: close\r\n"
+             "Content-Type: text/html\r\n"
+             "Content-Length: %zu\r\n\r\n",
+             options_.retryAfterSec, sizeof(body) - 1);
+    response503_ = head;
+    response503_ += body;
+}
+
+bool AdmissionControl::Admit()
+{
+    int inflight = inflight_.load(std::memory_order_relaxed);
+    if (options_.maxInflight > 0 && inflight >= options_.maxInflight)
+    {
+        return false;
+    }
+    if (dropping_.load(std::memory_order_relaxed))
+    {
+        // 积压的任务已基本处理完，不会再有出队来结束过载状态，这里直接恢复
+        if (inflight >= workers_)
+        {
+            return false;
+        }
+        dropping_.store(false, std::memory_order_relaxed);
+        firstAboveNs_.store(0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void AdmissionControl::OnDequeue(uint64_t enqueueTsc)
+{
+    uint64_t sojourn = static_cast<uint64_t>(Tracer::Instance()->TscToNs(ReadTsc() - enqueueTsc));
+    uint64_t now = Metrics::NowNs();
+
+    // 多个工作线程并发更新，竞争只会让判定早或晚一个任务，不影响结果
+    if (sojourn < targetNs_)
+    {
+        firstAboveNs_.store(0, std::memory_order_relaxed);
+        dropping_.store(false, std::memory_order_relaxed);
+        return;
+    }
+    uint64_t firstAbove = firstAboveNs_.load(std::memory_order_relaxed);
+    if (firstAbove == 0)
+    {
+        firstAboveNs_.store(now + intervalNs_, std::memory_order_relaxed);
+    }
+    else if (now >= firstAbove && !dropping_.load(std::memory_order_relaxed))
+    {
+        dropping_.store(true, std::memory_order_relaxed);
+    }
+}
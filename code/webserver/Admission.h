@@ -0,0 +1,51 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include "AdmissionOptions.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+ * 准入控制
+ * 两个条件任一满足就在 reactor 中直接回 503，请求不进入线程池：
+ *   1. 在途请求（已投递、尚未处理完的读任务）达到上限；
+ *   2. 线程池排队时间持续超标（CoDel）：一个 interval 内每个出队任务的等待时间都高于 target，
+ *      说明队列里积压的是稳定存在的"坏队列"，而不是突发。排队时间回落到 target 以下、
+ *      或积压的任务已处理完时恢复接收。
+ */
+class AdmissionControl
+{
+public:
+    using Options = AdmissionOptions;
+
+    AdmissionControl(const Options &options, int workers);
+
+    // reactor 投递读任务前调用：返回 false 时应直接拒绝
+    bool Admit();
+
+    // 读任务投递/出队/结束
+    void OnEnqueue() { inflight_.fetch_add(1, std::memory_order_relaxed); }
+    void OnDequeue(uint64_t enqueueTsc);
+    void OnDone() { inflight_.fetch_sub(1, std::memory_order_relaxed); }
+
+    // 预先生成的完整 503 响应（Connection: close）
+    const std::string &Response503() const { return response503_; }
+
+    int Inflight() const { return inflight_.load(std::memory_order_relaxed); }
+    bool Overloaded() const { return dropping_.load(std::memory_order_relaxed); }
+
+private:
+    Options options_;
+    int workers_;
+    uint64_t targetNs_;
+    uint64_t intervalNs_;
+
+    std::atomic<int> inflight_{0};
+    std::atomic<uint64_t> firstAboveNs_{0}; // 排队时间开始超标后、判定过载的时刻，0 表示未超标
+    std::atomic<bool> dropping_{false};
+
+    std::string response503_;
+};
+
+#endif // ADMISSION_H
@@ -0,0 +1,20 @@
+#ifndef ADMISSION_OPTIONS_H
+#define ADMISSION_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+
+// 准入控制参数（AdmissionControl::Options）
+struct AdmissionOptions
+{
+    uint64_t targetUs = 5000;     // 可接受的排队时间
+    uint64_t intervalUs = 100000; // 超标持续多久才开始拒绝
+    int maxInflight = 1024;       // 在途请求上限，0 表示不限制
+    int retryAfterSec = 1;        // 503 响应中的 Retry-After
+    int maxConnections = 20000;   // 连接数上限，超出时回 503 后关闭
+
+    // 解析 "name=value" 形式的单个选项，例如 "target=2000"、"inflight=0"
+    bool Parse(const std::string &option);
+};
+
+#endif // ADMISSION_OPTIONS_H
@@ -0,0 +1,74 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+#include "../log/LogLevel.h"
+#include "../trace/TraceFormat.h"
+#include "SocketOpt.h"
+#include "AdmissionOptions.h"
+#include "RateLimiterOptions.h"
+#include "TlsOptions.h"
+#include "../http/FileCacheOptions.h"
+#include "../http/SessionOptions.h"
+#include "../pool/RegisterBatcherOptions.h"
+#include "../pool/PasswordHasherOptions.h"
+
+// 只读从库（与主库使用相同的用户、密码、库名和连接池大小）
+struct DbReplica
+{
+    std::string name;
+    std::string host;
+    int port = 3306;
+};
+
+// 服务器运行参数
+struct ServerConfig
+{
+    int port = 8080;   // 监听端口
+    int threadNum = 8; // 工作线程数
+    int workers = 0;   // 工作进程数（SO_REUSEPORT 各自监听），0 表示单进程
+    SocketOptions sock; // TCP 参数
+    AdmissionOptions admission;   // 准入控制（连接数、排队时间与在途请求数）
+    RateLimiterOptions rateLimit; // 按客户端 IP 限流
+    TlsOptions tls;               // 监听端口上的 TLS，未配置证书时为明文
+
+    // 数据库连接参数
+    std::string dbHost = "localhost";
+    int dbPort = 3306;
+    std::string dbUser = "root";
+    std::string dbPwd = "6";
+    std::string dbName = "webserver";
+    int sqlConnNum = 6; // 连接池大小（每个端点）
+    std::vector<DbReplica> dbReplicas; // 登录查询等只读请求优先发往这些从库
+    bool dbStub = false; // 使用内存中的用户表代替 MySQL（压测用）
+
+    bool dbLane = true;       // 登录/注册请求在单独的线程池中访问数据库
+    int dbLaneThreads = 0;    // 数据库通道线程数，0 表示与连接池大小相同
+    size_t dbLaneQueue = 256; // 数据库通道排队上限，超出时回 503
+    RegisterBatcherOptions groupCommit; // 注册请求合并为批量事务
+    SessionOptions session;             // 登录后下发的签名会话 Cookie
+    PasswordHasherOptions kdf;          // 口令哈希（bcrypt）的计算线程池
+
+    std::string metricsPath = "/metrics"; // 指标导出路径，为空时关闭
+
+    std::string upgradeSock;    // 热升级时交接监听套接字的 Unix 套接字路径，为空时关闭
+    int drainTimeoutMs = 10000; // 停止接受新连接后等待现有连接结束的最长时间
+
+    bool embeddedAssets = true;              // 静态文件从编译进程序的资源包提供
+    std::string resourceDir = "../resources"; // 不使用资源包时从该目录读取
+    FileCacheOptions warm;                    // 启动预热：磁盘文件缓存，或预读内嵌资源块
+
+    std::string logDir = "./log";       // 日志目录，为空时只输出到 stderr
+    LogLevel logLevel = LogLevel::INFO; // 运行期日志级别（编译期级别见 LOG_MIN_LEVEL）
+    bool accessLog = true;              // 是否记录访问日志
+    size_t logFileBytes = 64 << 20;     // 单个日志文件大小上限
+    int logFiles = 5;                   // 滚动保留的文件数
+
+    std::string traceFile;                         // 追踪导出文件，为空时关闭
+    TraceFormat traceFormat = TraceFormat::CHROME; // 导出格式
+    uint32_t traceSampleEvery = 1000;              // 每 N 个请求采样一个
+    uint64_t traceSlowUs = 100000;                 // 超过该耗时（微秒）的请求总是导出
+};
+
+#endif // CONFIG_H
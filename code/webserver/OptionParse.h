@@ -0,0 +1,74 @@
+#ifndef OPTION_PARSE_H
+#define OPTION_PARSE_H
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+ * 命令行 "name=value" 选项的解析（各模块 Options::Parse 共用）
+ * 数值用 std::from_chars 解析：整个值都必须是合法数字且落在给定范围内，否则返回 false 且不修改目标，
+ * 例如 "target=abc"、"batch=-1"、"cost=10x" 都会被拒绝，而不是静默地变成 0 或被截断。
+ */
+namespace OptionParse
+{
+    // 按第一个 '=' 拆分；没有 '=' 或值为空时返回 false
+    inline bool Split(std::string_view option, std::string_view &name, std::string_view &value)
+    {
+        size_t eq = option.find('=');
+        if (eq == std::string_view::npos || eq + 1 == option.size())
+        {
+            return false;
+        }
+        name = option.substr(0, eq);
+        value = option.substr(eq + 1);
+        return true;
+    }
+
+    // 解析 [lo, hi] 之内的整数或浮点数
+    template <typename T>
+    bool Number(std::string_view value, T &out, T lo = std::numeric_limits<T>::lowest(), T hi = std::numeric_limits<T>::max())
+    {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "use Flag() for bool");
+        T parsed{};
+        const char *end = value.data() + value.size();
+        auto [ptr, ec] = std::from_chars(value.data(), end, parsed);
+        if (ec != std::errc() || ptr != end || parsed < lo || parsed > hi)
+        {
+            return false;
+        }
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            if (!std::isfinite(parsed))
+            {
+                return false; // from_chars 接受 "inf"、"nan"
+            }
+        }
+        out = parsed;
+        return true;
+    }
+
+    // 开关：0 为关，其他整数为开
+    inline bool Flag(std::string_view value, bool &out)
+    {
+        long long parsed = 0;
+        if (!Number(value, parsed))
+        {
+            return false;
+        }
+        out = parsed != 0;
+        return true;
+    }
+
+    // 字符串原样保存
+    inline bool String(std::string_view value, std::string &out)
+    {
+        out.assign(value.data(), value.size());
+        return true;
+    }
+}
+
+#endif // OPTION_PARSE_H
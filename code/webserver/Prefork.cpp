@@ -0,0 +1,372 @@
+#include "Prefork.h"
+#include "server.h"
+#include <condition_variable>
+#include <new>
+#include <openssl/rand.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+namespace
+{
+    constexpr int64_t PUBLISH_MS = 1000;       // 工作进程发布计数的间隔
+    constexpr int64_t MIN_UPTIME_MS = 1000;    // 运行不到这么久就退出算作快速崩溃
+    constexpr int64_t MAX_BACKOFF_MS = 10000;  // 连续快速崩溃时重新拉起的最大间隔
+
+    // 在 "dir/trace.json" 的扩展名之前插入 "-<index>"
+    std::string WithIndex(const std::string &path, int index)
+    {
+        size_t slash = path.rfind('/');
+        size_t dot = path.rfind('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1)
+        {
+            dot = path.size();
+        }
+        return path.substr(0, dot) + "-" + std::to_string(index) + path.substr(dot);
+    }
+}
+
+Prefork::Prefork(const ServerConfig &config)
+    : config_(config), count_(std::max(config.workers, 1)), shared_(nullptr), sharedBytes_(0), signalFd_(-1),
+      masterPid_(getpid()), stopping_(false), workers_(count_)
+{
+    // 共享内存在 fork 之前映射，所有工作进程继承同一块
+    sharedBytes_ = sizeof(Shared) + (count_ - 1) * sizeof(Slot);
+    void *mem = mmap(nullptr, sharedBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        LOG_ERROR("cannot map %zu bytes of shared memory for worker stats: %s", sharedBytes_, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    shared_ = new (mem) Shared();
+    for (int i = 1; i < count_; ++i)
+    {
+        new (&shared_->slots[i]) Slot();
+    }
+
+    // 未配置会话密钥文件时由主进程生成一次，否则各工作进程签发的 Cookie 互不通用
+    if (config_.session.enabled && config_.session.keyFile.empty() && config_.session.secret.empty())
+    {
+        unsigned char secret[32];
+        if (RAND_bytes(secret, sizeof(secret)) == 1)
+        {
+            config_.session.secret.assign(reinterpret_cast<char *>(secret), sizeof(secret));
+        }
+    }
+
+    // 每个工作进程自己绑定端口；热升级交接的是单个监听套接字，多进程模式下不支持
+    config_.sock.reusePort = true;
+    if (!config_.upgradeSock.empty())
+    {
+        LOG_WARN("zero-downtime upgrade is not supported with %d workers, ignoring %s", count_,
+                 config_.upgradeSock.c_str());
+        config_.upgradeSock.clear();
+    }
+
+    // 各工作进程的日志写到 logDir/worker-<i>，Log::Init 只创建一级目录
+    if (!config_.logDir.empty())
+    {
+        mkdir(config_.logDir.c_str(), 0755);
+    }
+
+    // 在 fork 之前屏蔽，工作进程继承屏蔽字，启动阶段收到的 SIGTERM 留到它的 signalfd 上处理
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    signalFd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+Prefork::~Prefork()
+{
+    if (signalFd_ >= 0)
+        close(signalFd_);
+    if (shared_)
+        munmap(shared_, sharedBytes_);
+}
+
+int64_t Prefork::NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int Prefork::Run()
+{
+    LOG_INFO("master %d starting %d workers on port %d", masterPid_, count_, config_.port);
+    for (int i = 0; i < count_; ++i)
+    {
+        workers_[i].pid = Spawn_(i);
+        workers_[i].startedMs = NowMs();
+    }
+
+    while (true)
+    {
+        int64_t now = NowMs();
+        Reap_(now);
+        Aggregate_();
+
+        bool alive = false;
+        for (const Worker &w : workers_)
+            alive = alive || w.pid > 0;
+        if (stopping_ && !alive)
+        {
+            break;
+        }
+
+        // 到期的槽位重新拉起
+        for (int i = 0; !stopping_ && i < count_; ++i)
+        {
+            Worker &w = workers_[i];
+            if (w.pid <= 0 && now >= w.respawnAtMs)
+            {
+                w.pid = Spawn_(i);
+                w.startedMs = now;
+                if (w.pid > 0)
+                {
+                    shared_->slots[i].restarts.fetch_add(1, std::memory_order_relaxed);
+                    shared_->restarts.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 子进程退出和停止信号经 signalfd 唤醒，其余时间按发布间隔汇总
+        pollfd pfd{signalFd_, POLLIN, 0};
+        poll(&pfd, 1, PUBLISH_MS);
+        if (HandleSignals_())
+        {
+            stopping_ = true;
+        }
+    }
+
+    Aggregate_();
+    LOG_INFO("all workers exited: %lu connections, %lu requests, %lu bytes sent, %lu errors, %u restarts",
+             (unsigned long)shared_->totals[CONNECTIONS].load(), (unsigned long)shared_->totals[REQUESTS].load(),
+             (unsigned long)shared_->totals[BYTES_SENT].load(), (unsigned long)shared_->totals[ERRORS].load(),
+             shared_->restarts.load());
+    return 0;
+}
+
+pid_t Prefork::Spawn_(int index)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        LOG_ERROR("fork worker %d failed: %s", index, strerror(errno));
+        workers_[index].respawnAtMs = NowMs() + MAX_BACKOFF_MS;
+        return -1;
+    }
+    if (pid == 0)
+    {
+        RunWorker_(index);
+    }
+    shared_->slots[index].pid.store(pid, std::memory_order_relaxed);
+    LOG_INFO("worker %d started (pid %d)", index, pid);
+    return pid;
+}
+
+void Prefork::RunWorker_(int index)
+{
+    // 自成进程组，终端的 Ctrl-C 只发给主进程，由它统一转发；主进程意外退出时收到 SIGTERM 并排空
+    close(signalFd_);
+    setpgid(0, 0);
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != masterPid_)
+    {
+        _exit(EXIT_FAILURE); // prctl 之前主进程已经退出
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+
+    ServerConfig config = config_;
+    if (!config.logDir.empty())
+        config.logDir += "/worker-" + std::to_string(index);
+    if (!config.traceFile.empty())
+        config.traceFile = WithIndex(config.traceFile, index);
+
+    {
+        WebServer server(config);
+        LOG_INFO("worker %d (pid %d) of master %d", index, getpid(), masterPid_);
+        AddClusterGauges_();
+
+        // 发布线程在 WebServer 构造之后创建，继承它对 SIGTERM/SIGINT 的屏蔽
+        std::mutex mtx;
+        std::condition_variable cond;
+        bool done = false;
+        std::thread publisher([&]()
+                              {
+                                  std::unique_lock<std::mutex> lock(mtx);
+                                  while (!cond.wait_for(lock, std::chrono::milliseconds(PUBLISH_MS), [&]()
+                                                        { return done; }))
+                                  {
+                                      Publish_(index);
+                                  } });
+        server.start();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            done = true;
+        }
+        cond.notify_one();
+        publisher.join();
+        Publish_(index);
+        for (const char *name : {"webserver_cluster_workers_alive", "webserver_cluster_worker_restarts",
+                                 "webserver_cluster_connections", "webserver_cluster_requests",
+                                 "webserver_cluster_bytes_sent", "webserver_cluster_errors",
+                                 "webserver_cluster_active_connections"})
+        {
+            Metrics::Instance()->RemoveGauge(name);
+        }
+    }
+    exit(EXIT_SUCCESS);
+}
+
+void Prefork::Publish_(int index)
+{
+    Metrics::Totals totals = Metrics::Instance()->Sum();
+    Slot &slot = shared_->slots[index];
+    slot.counters[CONNECTIONS].store(totals.connections, std::memory_order_relaxed);
+    slot.counters[REQUESTS].store(totals.requests, std::memory_order_relaxed);
+    slot.counters[BYTES_SENT].store(totals.bytesSent, std::memory_order_relaxed);
+    slot.counters[ERRORS].store(totals.errors, std::memory_order_relaxed);
+    slot.active.store(HttpConn::UserCount(), std::memory_order_relaxed);
+}
+
+void Prefork::Reap_(int64_t nowMs)
+{
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        auto it = std::find_if(workers_.begin(), workers_.end(), [pid](const Worker &w)
+                               { return w.pid == pid; });
+        if (it == workers_.end())
+        {
+            continue;
+        }
+        int index = static_cast<int>(it - workers_.begin());
+        Worker &w = *it;
+        w.pid = -1;
+
+        // 最后一次发布的计数并入 retired，槽位清零后留给新进程
+        Slot &slot = shared_->slots[index];
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+        {
+            shared_->retired[c].fetch_add(slot.counters[c].exchange(0, std::memory_order_relaxed),
+                                          std::memory_order_relaxed);
+        }
+        slot.pid.store(0, std::memory_order_relaxed);
+        slot.active.store(0, std::memory_order_relaxed);
+
+        if (stopping_)
+        {
+            LOG_INFO("worker %d (pid %d) exited", index, pid);
+            continue;
+        }
+        // 刚启动就退出（端口被占、配置错误）时逐次加大间隔，避免 fork 风暴
+        int64_t uptime = nowMs - w.startedMs;
+        w.backoffMs = uptime < MIN_UPTIME_MS ? std::min<int64_t>(std::max<int64_t>(w.backoffMs * 2, 100), MAX_BACKOFF_MS) : 0;
+        w.respawnAtMs = nowMs + w.backoffMs;
+        if (WIFSIGNALED(status))
+        {
+            LOG_ERROR("worker %d (pid %d) killed by signal %d after %ld ms, restarting in %ld ms", index, pid,
+                      WTERMSIG(status), (long)uptime, (long)w.backoffMs);
+        }
+        else
+        {
+            LOG_WARN("worker %d (pid %d) exited with status %d after %ld ms, restarting in %ld ms", index, pid,
+                     WEXITSTATUS(status), (long)uptime, (long)w.backoffMs);
+        }
+    }
+}
+
+void Prefork::Aggregate_()
+{
+    uint64_t totals[COUNTER_COUNT];
+    uint64_t active = 0;
+    uint32_t alive = 0;
+    for (int c = 0; c < COUNTER_COUNT; ++c)
+    {
+        totals[c] = shared_->retired[c].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < count_; ++i)
+    {
+        Slot &slot = shared_->slots[i];
+        if (slot.pid.load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        ++alive;
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+        {
+            totals[c] += slot.counters[c].load(std::memory_order_relaxed);
+        }
+        active += slot.active.load(std::memory_order_relaxed);
+    }
+    for (int c = 0; c < COUNTER_COUNT; ++c)
+    {
+        shared_->totals[c].store(totals[c], std::memory_order_relaxed);
+    }
+    shared_->active.store(active, std::memory_order_relaxed);
+    shared_->alive.store(alive, std::memory_order_relaxed);
+}
+
+void Prefork::Signal_(int sig)
+{
+    for (const Worker &w : workers_)
+    {
+        if (w.pid > 0)
+            kill(w.pid, sig);
+    }
+}
+
+bool Prefork::HandleSignals_()
+{
+    bool stop = false;
+    signalfd_siginfo info;
+    while (read(signalFd_, &info, sizeof(info)) == sizeof(info))
+    {
+        if (info.ssi_signo == SIGCHLD)
+        {
+            continue; // 下一轮 Reap_ 回收
+        }
+        // 工作进程第一次收到 SIGTERM 时排空，第二次立即退出，与单进程时相同
+        LOG_INFO("%s received, forwarding SIGTERM to workers", info.ssi_signo == SIGTERM ? "SIGTERM" : "SIGINT");
+        Signal_(SIGTERM);
+        stop = true;
+    }
+    return stop;
+}
+
+void Prefork::AddClusterGauges_()
+{
+    Shared *shared = shared_;
+    Metrics::Instance()->AddGauge("webserver_cluster_workers_alive", "Worker processes running under the master.",
+                                  [shared]()
+                                  { return shared->alive.load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_worker_restarts", "Workers restarted by the master after exiting.",
+                                  [shared]()
+                                  { return shared->restarts.load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_connections", "Connections accepted by all workers, exited ones included.",
+                                  [shared]()
+                                  { return shared->totals[CONNECTIONS].load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_requests", "Requests served by all workers, exited ones included.",
+                                  [shared]()
+                                  { return shared->totals[REQUESTS].load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_bytes_sent", "Bytes sent by all workers, exited ones included.",
+                                  [shared]()
+                                  { return shared->totals[BYTES_SENT].load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_errors", "5xx responses from all workers, exited ones included.",
+                                  [shared]()
+                                  { return shared->totals[ERRORS].load(std::memory_order_relaxed); });
+    Metrics::Instance()->AddGauge("webserver_cluster_active_connections", "Open connections across all workers.",
+                                  [shared]()
+                                  { return shared->active.load(std::memory_order_relaxed); });
+}
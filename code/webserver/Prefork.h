@@ -0,0 +1,93 @@
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+#include "Config.h"
+
+/*
+ * 多进程模式：一个主进程 + N 个工作进程
+ * 每个工作进程是一个完整的 WebServer（自己的 reactor、线程池和分配器），各自以 SO_REUSEPORT
+ * 绑定同一端口，由内核分配新连接；一个工作进程崩溃只丢失它自己的连接。
+ * 主进程不处理请求，只负责监督：工作进程退出后按退避间隔重新拉起，收到 SIGTERM/SIGINT 时转发给
+ * 所有工作进程并等待它们排空退出。
+ * 工作进程每秒把自己的计数发布到 fork 之前映射的共享内存，主进程汇总后写回，
+ * 任意一个工作进程的指标页都能看到整个集群的总数。
+ * 注意：数据库连接池、日志、追踪文件和内存中的桩用户表都是每个进程一份。
+ */
+class Prefork
+{
+public:
+    explicit Prefork(const ServerConfig &config);
+    ~Prefork();
+
+    Prefork(const Prefork &) = delete;
+    Prefork &operator=(const Prefork &) = delete;
+
+    // 主进程：拉起并监督工作进程，全部退出后返回进程退出码
+    int Run();
+
+private:
+    // 各计数在共享内存中的下标
+    enum Counter
+    {
+        CONNECTIONS,
+        REQUESTS,
+        BYTES_SENT,
+        ERRORS,
+        COUNTER_COUNT,
+    };
+
+    // 一个工作进程的槽位，只有该进程写计数，主进程在它退出后才读走并清零
+    struct alignas(64) Slot
+    {
+        std::atomic<int32_t> pid{0};
+        std::atomic<uint32_t> restarts{0}; // 该槽位被重新拉起的次数
+        std::atomic<uint64_t> active{0};   // 当前打开的连接数
+        std::atomic<uint64_t> counters[COUNTER_COUNT]{};
+    };
+
+    struct Shared
+    {
+        std::atomic<uint64_t> retired[COUNTER_COUNT]{}; // 已退出的工作进程留下的计数
+        std::atomic<uint64_t> totals[COUNTER_COUNT]{};  // 主进程汇总的集群总数
+        std::atomic<uint64_t> active{0};
+        std::atomic<uint32_t> alive{0};
+        std::atomic<uint32_t> restarts{0};
+        Slot slots[1]; // 实际长度为工作进程数
+    };
+
+    // 工作进程的监督状态（只在主进程中使用）
+    struct Worker
+    {
+        pid_t pid = -1;
+        int64_t startedMs = 0;
+        int64_t respawnAtMs = 0; // 退出后到这个时间才重新拉起
+        int64_t backoffMs = 0;   // 连续快速崩溃时翻倍
+    };
+
+    pid_t Spawn_(int index);
+    [[noreturn]] void RunWorker_(int index);
+    void Publish_(int index);      // 工作进程：把本进程的计数写入槽位
+    void Reap_(int64_t nowMs);     // 主进程：回收退出的工作进程，计数并入 retired
+    void Aggregate_();             // 主进程：汇总各槽位
+    void Signal_(int sig);         // 主进程：向所有存活的工作进程发送信号
+    bool HandleSignals_();         // 主进程：读 signalfd，收到 SIGTERM/SIGINT 时返回 true
+    void AddClusterGauges_();      // 工作进程：登记读取共享内存的集群指标
+
+    static int64_t NowMs();
+
+    ServerConfig config_;
+    int count_;             // 工作进程数
+    Shared *shared_;        // fork 之前映射的共享内存
+    size_t sharedBytes_;
+    int signalFd_;          // 主进程的 SIGTERM/SIGINT/SIGCHLD
+    pid_t masterPid_;
+    bool stopping_;         // 已开始退出，不再重新拉起
+    std::vector<Worker> workers_;
+};
+
+#endif // PREFORK_H
@@ -0,0 +1,202 @@
+#include "RateLimiter.h"
+#include "OptionParse.h"
+#include "../metrics/Metrics.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdlib>
+
+namespace
+{
+    uint64_t Mix(uint64_t x)
+    {
+        // splitmix64 的终结函数
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    size_t RoundUpPow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+}
+
+bool RateLimiterOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    bool ok;
+    if (name == "on")
+        ok = OptionParse::Flag(value, enabled);
+    else if (name == "connrate")
+        ok = OptionParse::Number(value, budgets[CONNECT].rate, 0.0);
+    else if (name == "connburst")
+        ok = OptionParse::Number(value, budgets[CONNECT].burst, 0.0);
+    else if (name == "staticrate")
+        ok = OptionParse::Number(value, budgets[STATIC].rate, 0.0);
+    else if (name == "staticburst")
+        ok = OptionParse::Number(value, budgets[STATIC].burst, 0.0);
+    else if (name == "dbrate")
+        ok = OptionParse::Number(value, budgets[DB].rate, 0.0);
+    else if (name == "dbburst")
+        ok = OptionParse::Number(value, budgets[DB].burst, 0.0);
+    else if (name == "prefix")
+        ok = OptionParse::Number(value, prefixFactor, 0.0);
+    else if (name == "slots")
+        ok = OptionParse::Number<size_t>(value, slots, 1);
+    else
+        return false;
+    // 设置任一预算即视为开启
+    enabled = enabled || (ok && name != "on");
+    return ok;
+}
+
+RateLimiter::RateLimiter(const Options &options)
+    : options_(options), startNs_(Metrics::NowNs())
+{
+    for (int k = 0; k < KIND_COUNT; ++k)
+    {
+        prefixBudgets_[k] = {options_.budgets[k].rate * options_.prefixFactor,
+                             options_.budgets[k].burst * options_.prefixFactor};
+    }
+    size_t slots = RoundUpPow2(std::max<size_t>(options_.slots, PROBE_LIMIT));
+    slots_.reset(new Slot[slots]);
+    slotMask_ = slots - 1;
+
+    size_t width = RoundUpPow2(std::max<size_t>(options_.sketchWidth, 64));
+    sketch_.reset(new std::atomic<uint32_t>[width * SKETCH_DEPTH]());
+    sketchMask_ = width - 1;
+
+    static const char body[] = "<html><body><h1>Too Many Requests</h1></body></html>";
+    response429_ = "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\nConnection: close\r\n"
+                   "Content-Type: text/html\r\nContent-Length: " +
+                   std::to_string(sizeof(body) - 1) + "\r\n\r\n" + body;
+}
+
+uint32_t RateLimiter::NowMs_() const
+{
+    return static_cast<uint32_t>((Metrics::NowNs() - startNs_) / 1000000);
+}
+
+bool RateLimiter::Allow(uint32_t ip, Kind kind)
+{
+    if (!options_.enabled)
+    {
+        return true;
+    }
+    uint32_t now = NowMs_();
+    uint64_t tag = static_cast<uint64_t>(kind + 1) << 40; // 保证 key 非 0
+    uint64_t ipKey = tag | ntohl(ip);
+    uint64_t prefixKey = tag | (1ULL << 32) | (ntohl(ip) & 0xffffff00u);
+
+    // 先扣单个 IP，通过后再扣网段，避免被拒绝的请求消耗网段预算
+    return AllowKey_(ipKey, options_.budgets[kind], now) &&
+           AllowKey_(prefixKey, prefixBudgets_[kind], now);
+}
+
+bool RateLimiter::AllowKey_(uint64_t key, const Budget &budget, uint32_t nowMs)
+{
+    uint64_t h = Mix(key);
+    for (int i = 0; i < PROBE_LIMIT; ++i)
+    {
+        Slot &slot = slots_[(h + i) & slotMask_];
+        if (slot.key.load(std::memory_order_acquire) == key)
+        {
+            return Take_(slot, budget, nowMs);
+        }
+    }
+
+    // 冷 key：窗口内的近似计数没超过桶容量就直接放行
+    uint32_t count = SketchAdd_(key, nowMs);
+    if (count <= budget.burst)
+    {
+        return true;
+    }
+
+    // 变热了：分配一个精确令牌桶。空闲到桶早已回满的表项可以回收
+    uint64_t idleMs = static_cast<uint64_t>(budget.burst / std::max(budget.rate, 1e-3) * 1000) + options_.windowMs;
+    for (int i = 0; i < PROBE_LIMIT; ++i)
+    {
+        Slot &slot = slots_[(h + i) & slotMask_];
+        uint64_t old = slot.key.load(std::memory_order_acquire);
+        bool stale = old != 0 &&
+                     static_cast<uint32_t>(nowMs - static_cast<uint32_t>(slot.state.load(std::memory_order_relaxed) >> 32)) > idleMs;
+        if ((old == 0 || stale) && slot.key.compare_exchange_strong(old, key, std::memory_order_acq_rel))
+        {
+            // 刚在本窗口内用完了一整桶，从空桶开始
+            slot.state.store(static_cast<uint64_t>(nowMs) << 32, std::memory_order_release);
+            if (old == 0)
+            {
+                hotKeys_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return false;
+        }
+    }
+
+    // 表里没有空位：只按 sketch 计数近似限流
+    return count <= budget.burst + budget.rate * options_.windowMs / 1000.0;
+}
+
+bool RateLimiter::Take_(Slot &slot, const Budget &budget, uint32_t nowMs)
+{
+    const uint64_t capacity = static_cast<uint64_t>(budget.burst * 1000);
+    uint64_t state = slot.state.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t last = static_cast<uint32_t>(state >> 32);
+        uint64_t tokens = state & 0xffffffffu; // 千分之一令牌
+        // 速率单位"令牌/秒"恰好等于"千分之一令牌/毫秒"
+        uint64_t add = static_cast<uint64_t>(static_cast<uint32_t>(nowMs - last) * budget.rate);
+        if (add > 0 || tokens >= capacity)
+        {
+            tokens = std::min(capacity, tokens + add);
+            last = nowMs; // 补充量不足一个单位时不推进时间，避免小速率下令牌永远补不上
+        }
+
+        bool allowed = tokens >= 1000;
+        if (allowed)
+        {
+            tokens -= 1000;
+        }
+        uint64_t next = (static_cast<uint64_t>(last) << 32) | std::min<uint64_t>(tokens, 0xffffffffu);
+        if (slot.state.compare_exchange_weak(state, next, std::memory_order_acq_rel))
+        {
+            return allowed;
+        }
+    }
+}
+
+uint32_t RateLimiter::SketchAdd_(uint64_t key, uint32_t nowMs)
+{
+    // 进入新窗口时由抢到的线程清零，其余线程照常计数（清零期间的少量计数丢失可以接受）
+    uint32_t window = nowMs / options_.windowMs;
+    uint32_t current = sketchWindow_.load(std::memory_order_relaxed);
+    if (current != window && sketchWindow_.compare_exchange_strong(current, window, std::memory_order_relaxed))
+    {
+        for (size_t i = 0; i < (sketchMask_ + 1) * SKETCH_DEPTH; ++i)
+        {
+            sketch_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t h = Mix(key ^ 0x9e3779b97f4a7c15ULL);
+    uint32_t h1 = static_cast<uint32_t>(h);
+    uint32_t h2 = static_cast<uint32_t>(h >> 32) | 1;
+    uint32_t minCount = UINT32_MAX;
+    for (int d = 0; d < SKETCH_DEPTH; ++d)
+    {
+        size_t idx = d * (sketchMask_ + 1) + ((h1 + d * h2) & sketchMask_);
+        minCount = std::min(minCount, sketch_[idx].fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+    return minCount;
+}
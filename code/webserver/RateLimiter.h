@@ -0,0 +1,72 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include "RateLimiterOptions.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+ * 按客户端 IP 与 /24 网段的令牌桶限流
+ * 令牌桶放在固定大小的无锁开放寻址表里，内存有上限。所有 key 先经过 count-min sketch
+ * 按时间窗口计数：窗口内请求数未超过桶容量的冷 key 直接放行，不占表项；超过后才分配
+ * 精确的令牌桶。表满时退化为只用 sketch 的近似计数（每窗口容量 + 速率 × 窗口长度）。
+ * 目前服务器只监听 IPv4，因此网段粒度为 /24。
+ */
+class RateLimiter
+{
+public:
+    using Options = RateLimiterOptions;
+    using Kind = Options::Kind;
+    using Budget = Options::Budget;
+    static constexpr Kind CONNECT = Options::CONNECT;
+    static constexpr Kind STATIC = Options::STATIC;
+    static constexpr Kind DB = Options::DB;
+    static constexpr int KIND_COUNT = Options::KIND_COUNT;
+
+    explicit RateLimiter(const Options &options);
+
+    // ip 为网络字节序的 IPv4 地址；同时扣减 IP 与所在网段的预算
+    bool Allow(uint32_t ip, Kind kind);
+
+    bool Enabled() const { return options_.enabled; }
+
+    // 预先生成的完整 429 响应（Connection: close），用于拒绝新连接
+    const std::string &Response429() const { return response429_; }
+
+    // 已分配精确令牌桶的表项数
+    size_t HotKeys() const { return hotKeys_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int SKETCH_DEPTH = 4;
+    static constexpr int PROBE_LIMIT = 8;
+
+    // 表项：key 为 0 表示空闲；state 高 32 位为毫秒时间戳，低 32 位为千分之一令牌数
+    struct alignas(16) Slot
+    {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> state{0};
+    };
+
+    bool AllowKey_(uint64_t key, const Budget &budget, uint32_t nowMs);
+    bool Take_(Slot &slot, const Budget &budget, uint32_t nowMs);
+    uint32_t SketchAdd_(uint64_t key, uint32_t nowMs);
+    uint32_t NowMs_() const;
+
+    Options options_;
+    Budget prefixBudgets_[KIND_COUNT];
+    uint64_t startNs_;
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t slotMask_;
+    std::atomic<size_t> hotKeys_{0};
+
+    std::unique_ptr<std::atomic<uint32_t>[]> sketch_; // SKETCH_DEPTH 行
+    size_t sketchMask_;
+    std::atomic<uint32_t> sketchWindow_{0}; // 当前计数窗口编号
+
+    std::string response429_;
+};
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,40 @@
+#ifndef RATE_LIMITER_OPTIONS_H
+#define RATE_LIMITER_OPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 限流参数（RateLimiter::Options），按请求类别分别设置令牌桶
+struct RateLimiterOptions
+{
+    enum Kind
+    {
+        CONNECT, // 建立连接
+        STATIC,  // 静态文件请求
+        DB,      // 需要访问数据库的请求（登录/注册）
+        KIND_COUNT,
+    };
+
+    struct Budget
+    {
+        double rate;  // 每秒补充的令牌数
+        double burst; // 桶容量
+    };
+
+    bool enabled = false;
+    Budget budgets[KIND_COUNT] = {
+        {50, 100},   // CONNECT
+        {500, 1000}, // STATIC
+        {5, 10},     // DB
+    };
+    double prefixFactor = 8;  // /24 网段的预算为单个 IP 的倍数
+    size_t slots = 1 << 16;   // 令牌桶表项数（取 2 的幂）
+    size_t sketchWidth = 4096; // count-min sketch 每行计数器数（取 2 的幂）
+    uint32_t windowMs = 1000; // sketch 计数窗口
+
+    // 解析 "name=value" 形式的单个选项，例如 "dbrate=2"、"on=1"
+    bool Parse(const std::string &option);
+};
+
+#endif // RATE_LIMITER_OPTIONS_H
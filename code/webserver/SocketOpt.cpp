@@ -0,0 +1,75 @@
+#include "SocketOpt.h"
+#include "OptionParse.h"
+#include "../log/Log.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace
+{
+    void SetInt(int fd, int level, int name, int value, const char *what)
+    {
+        if (setsockopt(fd, level, name, &value, sizeof(value)) < 0)
+        {
+            LOG_WARN("setsockopt %s=%d on fd %d failed: %s", what, value, fd, strerror(errno));
+        }
+    }
+}
+
+bool SocketOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "nodelay")
+        return OptionParse::Flag(value, noDelay);
+    if (name == "cork")
+        return OptionParse::Flag(value, cork);
+    if (name == "defer")
+        return OptionParse::Number(value, deferAcceptSec, 0);
+    if (name == "fastopen")
+        return OptionParse::Number(value, fastOpenQueue, 0);
+    if (name == "sndbuf")
+        return OptionParse::Number(value, sndBuf, 0);
+    if (name == "rcvbuf")
+        return OptionParse::Number(value, rcvBuf, 0);
+    if (name == "backlog")
+        return OptionParse::Number(value, backlog, 1);
+    if (name == "zerocopy")
+        return OptionParse::Number(value, zeroCopy, 0);
+    if (name == "reuseport")
+        return OptionParse::Flag(value, reusePort);
+    return false;
+}
+
+void SocketOptions::ApplyListen(int fd) const
+{
+    // 接收缓冲区要在 listen 前设置，窗口扩大因子在握手时就确定了
+    if (sndBuf > 0)
+        SetInt(fd, SOL_SOCKET, SO_SNDBUF, sndBuf, "SO_SNDBUF");
+    if (rcvBuf > 0)
+        SetInt(fd, SOL_SOCKET, SO_RCVBUF, rcvBuf, "SO_RCVBUF");
+    if (deferAcceptSec > 0)
+        SetInt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, deferAcceptSec, "TCP_DEFER_ACCEPT");
+    if (fastOpenQueue > 0)
+        SetInt(fd, IPPROTO_TCP, TCP_FASTOPEN, fastOpenQueue, "TCP_FASTOPEN");
+    if (reusePort)
+        SetInt(fd, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT"); // bind 之前设置才生效
+
+    LOG_INFO("socket options: nodelay=%d cork=%d defer=%d fastopen=%d sndbuf=%d rcvbuf=%d backlog=%d zerocopy=%d reuseport=%d",
+             noDelay, cork, deferAcceptSec, fastOpenQueue, sndBuf, rcvBuf, backlog, zeroCopy, reusePort);
+}
+
+void SocketOptions::ApplyConn(int fd) const
+{
+    if (noDelay)
+        SetInt(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if (zeroCopy > 0)
+        SetInt(fd, SOL_SOCKET, SO_ZEROCOPY, 1, "SO_ZEROCOPY");
+}
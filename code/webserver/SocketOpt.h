@@ -0,0 +1,33 @@
+#ifndef SOCKET_OPT_H
+#define SOCKET_OPT_H
+
+#include <string>
+
+/*
+ * TCP 参数
+ * 监听套接字上的选项（缓冲区大小、DEFER_ACCEPT、FASTOPEN）在 listen 前设置，由 accept 出的连接继承；
+ * NODELAY 在每个连接上单独设置。每一项都可以单独开关，便于压测对比。
+ */
+struct SocketOptions
+{
+    bool noDelay = true;    // TCP_NODELAY：关闭 Nagle，小响应不再等待 ACK
+    bool cork = false;      // TCP_CORK：写响应期间塞住连接，头部和文件体合并成满段后再发
+    int deferAcceptSec = 0; // TCP_DEFER_ACCEPT：连接上有数据后才唤醒 accept，0 表示关闭
+    int fastOpenQueue = 0;  // TCP_FASTOPEN：等待完成的 TFO 请求队列长度，0 表示关闭
+    int sndBuf = 0;         // SO_SNDBUF 字节数，0 表示使用内核默认值（自动调节）
+    int rcvBuf = 0;         // SO_RCVBUF 字节数，0 表示使用内核默认值（自动调节）
+    int backlog = 128;      // listen 队列长度
+    int zeroCopy = 0;       // 响应体达到该字节数时以 MSG_ZEROCOPY 发送，0 表示关闭
+    bool reusePort = false; // SO_REUSEPORT：多个进程各自绑定同一端口，由内核分配新连接
+
+    // 解析 "name=value" 形式的单个选项，例如 "nodelay=0"、"fastopen=256"
+    bool Parse(const std::string &option);
+
+    // 设置到监听套接字上，须在 listen 之前调用
+    void ApplyListen(int fd) const;
+
+    // 设置到新连接上
+    void ApplyConn(int fd) const;
+};
+
+#endif // SOCKET_OPT_H
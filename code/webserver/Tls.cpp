@@ -0,0 +1,146 @@
+#include "Tls.h"
+#include "OptionParse.h"
+#include "../log/Log.h"
+#include <cstdlib>
+#include <cstring>
+#include <openssl/err.h>
+
+namespace
+{
+    // 取出并清空当前线程的 OpenSSL 错误队列，返回最早的一条
+    std::string LastError()
+    {
+        char buf[256] = "unknown error";
+        unsigned long err = ERR_get_error();
+        if (err != 0)
+        {
+            ERR_error_string_n(err, buf, sizeof(buf));
+        }
+        ERR_clear_error();
+        return buf;
+    }
+
+    // ALPN 协议列表（长度前缀格式）
+    constexpr unsigned char ALPN_H2[] = "\x02h2";
+    constexpr unsigned char ALPN_HTTP11[] = "\x08http/1.1";
+}
+
+bool TlsOptions::Parse(const std::string &option)
+{
+    std::string_view name, value;
+    if (!OptionParse::Split(option, name, value))
+    {
+        return false;
+    }
+
+    if (name == "cert")
+        return OptionParse::String(value, cert);
+    if (name == "key")
+        return OptionParse::String(value, key);
+    if (name == "tickets")
+        return OptionParse::Flag(value, tickets);
+    if (name == "cache")
+        return OptionParse::Number(value, cacheSize, 0L);
+    if (name == "timeout")
+        return OptionParse::Number(value, timeoutSec, 1L);
+    if (name == "ktls")
+        return OptionParse::Flag(value, ktls);
+    if (name == "h2")
+        return OptionParse::Flag(value, h2);
+    return false;
+}
+
+TlsContext::TlsContext(const Options &options) : options_(options)
+{
+    if (options_.key.empty())
+    {
+        options_.key = options_.cert;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx == nullptr)
+    {
+        LOG_ERROR("SSL_CTX_new failed: %s", LastError().c_str());
+        return;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, options_.cert.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, options_.key.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1)
+    {
+        LOG_ERROR("loading TLS certificate %s / key %s failed: %s", options_.cert.c_str(), options_.key.c_str(),
+                  LastError().c_str());
+        SSL_CTX_free(ctx);
+        return;
+    }
+
+    // 套接字非阻塞：允许部分写出，重试时 iov 指针可能已经前移
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                              SSL_MODE_RELEASE_BUFFERS);
+
+    uint64_t opts = SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE;
+    if (options_.ktls)
+    {
+        opts |= SSL_OP_ENABLE_KTLS;
+    }
+    if (!options_.tickets)
+    {
+        opts |= SSL_OP_NO_TICKET; // TLS 1.3 下改为发放指向服务端缓存的有状态票据
+    }
+    SSL_CTX_set_options(ctx, opts);
+
+    // 会话复用：服务端缓存 + 票据，票据密钥在进程内随机生成
+    static const unsigned char sidContext[] = "webserver";
+    SSL_CTX_set_session_id_context(ctx, sidContext, sizeof(sidContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, options_.cacheSize);
+    SSL_CTX_set_timeout(ctx, options_.timeoutSec);
+    SSL_CTX_set_num_tickets(ctx, 1); // 默认 2 张；浏览器每次只用一张
+
+    SSL_CTX_set_alpn_select_cb(ctx, &TlsContext::SelectAlpn_, this);
+
+    ctx_ = ctx;
+    LOG_INFO("TLS enabled: cert=%s tickets=%d cache=%ld timeout=%ld ktls=%d h2=%d", options_.cert.c_str(),
+             options_.tickets, options_.cacheSize, options_.timeoutSec, options_.ktls, options_.h2);
+}
+
+TlsContext::~TlsContext()
+{
+    if (ctx_ != nullptr)
+    {
+        SSL_CTX_free(ctx_);
+    }
+}
+
+SSL *TlsContext::NewSsl(int fd) const
+{
+    SSL *ssl = SSL_new(ctx_);
+    if (ssl == nullptr || SSL_set_fd(ssl, fd) != 1)
+    {
+        LOG_WARN("creating TLS session for fd %d failed: %s", fd, LastError().c_str());
+        SSL_free(ssl);
+        return nullptr;
+    }
+    SSL_set_accept_state(ssl);
+    return ssl;
+}
+
+int TlsContext::SelectAlpn_(SSL *, const unsigned char **out, unsigned char *outLen,
+                            const unsigned char *in, unsigned int inLen, void *arg)
+{
+    const TlsContext *self = static_cast<const TlsContext *>(arg);
+    unsigned char *selected = nullptr;
+    if (self->options_.h2 &&
+        SSL_select_next_proto(&selected, outLen, ALPN_H2, sizeof(ALPN_H2) - 1, in, inLen) == OPENSSL_NPN_NEGOTIATED)
+    {
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+    if (SSL_select_next_proto(&selected, outLen, ALPN_HTTP11, sizeof(ALPN_HTTP11) - 1, in, inLen) == OPENSSL_NPN_NEGOTIATED)
+    {
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+    return SSL_TLSEXT_ERR_NOACK; // 没有共同协议时不带 ALPN 继续，按 HTTP/1.1 处理
+}
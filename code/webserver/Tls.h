@@ -0,0 +1,41 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include "TlsOptions.h"
+#include <string>
+#include <openssl/ssl.h>
+
+/*
+ * 监听端口上的 TLS 终结（OpenSSL）
+ * 所有连接共用一个 SSL_CTX：服务端会话缓存与会话票据让回访的客户端跳过完整握手（省去证书签名），
+ * ALPN 协商出 h2 时连接直接以 HTTP/2 运行。握手完成后尝试把记录层交给内核（kTLS），
+ * 发送方向成功时响应仍用 writev 直接写套接字，由内核加密，大文件不必在用户态再拷贝一遍。
+ * 内核没有 tls 模块或套件不支持时退回 SSL_read/SSL_write。
+ */
+class TlsContext
+{
+public:
+    using Options = TlsOptions;
+
+    explicit TlsContext(const Options &options);
+    ~TlsContext();
+
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+
+    // 证书与私钥是否加载成功
+    bool Ok() const { return ctx_ != nullptr; }
+
+    // 为已接受的连接创建服务端 SSL 对象，失败时返回 nullptr
+    SSL *NewSsl(int fd) const;
+
+private:
+    // ALPN 回调：客户端提供 h2 时优先选择，其次 http/1.1
+    static int SelectAlpn_(SSL *ssl, const unsigned char **out, unsigned char *outLen,
+                           const unsigned char *in, unsigned int inLen, void *arg);
+
+    Options options_;
+    SSL_CTX *ctx_ = nullptr;
+};
+
+#endif // TLS_H
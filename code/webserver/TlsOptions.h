@@ -0,0 +1,23 @@
+#ifndef TLS_OPTIONS_H
+#define TLS_OPTIONS_H
+
+#include <string>
+
+// 监听端口上的 TLS 参数（TlsContext::Options）
+struct TlsOptions
+{
+    std::string cert;          // 证书链文件（PEM），为空时不启用 TLS
+    std::string key;           // 私钥文件（PEM），为空时与 cert 相同
+    bool tickets = true;       // 发放无状态会话票据；关闭时只用服务端会话缓存
+    long cacheSize = 20480;    // 服务端会话缓存条目数
+    long timeoutSec = 7200;    // 会话（票据）有效期
+    bool ktls = true;          // 握手后尝试启用内核 TLS
+    bool h2 = true;            // 通过 ALPN 提供 h2
+
+    // 解析 "name=value" 形式的单个选项，例如 "cert=server.pem"、"ktls=0"
+    bool Parse(const std::string &option);
+
+    bool Enabled() const { return !cert.empty(); }
+};
+
+#endif // TLS_OPTIONS_H
@@ -0,0 +1,158 @@
+#include "Upgrade.h"
+#include "../log/Log.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr uint32_t MAGIC = 0x77737570; // "wsup"
+    constexpr char ACK = 1;
+
+    // 随监听套接字一起发送，新进程据此确认拿到的是自己要监听的端口
+    struct Hello
+    {
+        uint32_t magic;
+        uint32_t port;
+    };
+
+    bool MakeAddr(const std::string &path, sockaddr_un &addr)
+    {
+        addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        {
+            LOG_ERROR("upgrade socket path '%s' is empty or too long", path.c_str());
+            return false;
+        }
+        memcpy(addr.sun_path, path.data(), path.size());
+        return true;
+    }
+}
+
+int Upgrade::Receive(const std::string &path, int port, int *conn)
+{
+    sockaddr_un addr;
+    if (!MakeAddr(path, addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd); // 没有旧进程（或只剩失效的 path），正常启动
+        return -1;
+    }
+    timeval timeout{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    Hello hello{};
+    iovec iov{&hello, sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    cmsghdr *cmsg = n == sizeof(hello) ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+        LOG_WARN("upgrade: no listening socket received from %s", path.c_str());
+        close(fd);
+        return -1;
+    }
+    int listenFd;
+    memcpy(&listenFd, CMSG_DATA(cmsg), sizeof(listenFd));
+    if (hello.magic != MAGIC || static_cast<int>(hello.port) != port)
+    {
+        LOG_WARN("upgrade: running process listens on port %u, not %d", hello.port, port);
+        close(listenFd);
+        close(fd);
+        return -1;
+    }
+    *conn = fd;
+    return listenFd;
+}
+
+void Upgrade::Ack(int conn)
+{
+    if (send(conn, &ACK, 1, MSG_NOSIGNAL) != 1)
+    {
+        LOG_WARN("upgrade: cannot acknowledge handoff: %s", strerror(errno));
+    }
+    close(conn);
+}
+
+int Upgrade::Listen(const std::string &path)
+{
+    sockaddr_un addr;
+    if (!MakeAddr(path, addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path.c_str()); // 旧进程交接后不再使用这个 path
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 1) < 0)
+    {
+        LOG_ERROR("upgrade: cannot listen on %s: %s", path.c_str(), strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int Upgrade::Offer(int upgradeFd, int listenFd, int port)
+{
+    int conn = accept4(upgradeFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn < 0)
+        return -1;
+
+    // 只把监听套接字交给同一用户启动的进程
+    ucred cred{};
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || cred.uid != geteuid())
+    {
+        LOG_WARN("upgrade: rejected connection from uid %u", cred.uid);
+        close(conn);
+        return -1;
+    }
+
+    Hello hello{MAGIC, static_cast<uint32_t>(port)};
+    iovec iov{&hello, sizeof(hello)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &listenFd, sizeof(int));
+
+    if (sendmsg(conn, &msg, MSG_NOSIGNAL) != sizeof(hello))
+    {
+        LOG_WARN("upgrade: cannot send listening socket: %s", strerror(errno));
+        close(conn);
+        return -1;
+    }
+    LOG_INFO("upgrade: listening socket sent to pid %d, waiting for it to take over", cred.pid);
+    return conn;
+}
+
+int Upgrade::ReadAck(int conn)
+{
+    char c = 0;
+    ssize_t n = recv(conn, &c, 1, 0);
+    if (n == 1 && c == ACK)
+        return 1;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    return -1;
+}
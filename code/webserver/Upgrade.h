@@ -0,0 +1,32 @@
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+#include <string>
+
+/*
+ * 热升级：新进程经 Unix 套接字（SCM_RIGHTS）从旧进程接过监听套接字
+ *   1. 运行中的进程在 path 上等待升级连接；
+ *   2. 新进程完成预热后连接 path，收到监听套接字，注册到自己的 epoll 后回复确认；
+ *   3. 旧进程收到确认后停止 accept、排空现有连接并退出，新进程接管 path 等待下一次升级。
+ * 监听套接字自始至终保持打开，backlog 中的连接由新进程接受，升级期间没有连接被拒绝。
+ */
+namespace Upgrade
+{
+    // 新进程：从 path 上的旧进程取回监听 port 的套接字；没有旧进程时返回 -1。
+    // 成功时 *conn 为与旧进程的连接，接管完成后以 Ack 确认
+    int Receive(const std::string &path, int port, int *conn);
+
+    // 新进程：监听套接字已就绪，通知旧进程停止 accept
+    void Ack(int conn);
+
+    // 在 path 上等待升级连接（非阻塞），已有的 path 会被替换；失败返回 -1
+    int Listen(const std::string &path);
+
+    // 旧进程：接受一个升级连接并把 listenFd 发送过去，返回等待确认的连接（非阻塞），失败返回 -1
+    int Offer(int upgradeFd, int listenFd, int port);
+
+    // 旧进程：读取确认；返回 1 表示新进程已接管，0 表示还没收到，-1 表示新进程中途退出
+    int ReadAck(int conn);
+}
+
+#endif // UPGRADE_H
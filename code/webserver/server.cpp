@@ -1,29 +1,282 @@
 #include "server.h"
+#include "Admission.h"
+#include "RateLimiter.h"
+#include "Tls.h"
+#include "Upgrade.h"
+#include "../http/FileCache.h"
+#include "../http/Session.h"
+#include "../pool/RegisterBatcher.h"
+#include "../pool/PasswordHasher.h"
+#include <sys/signalfd.h>
 
 // 构造函数：初始化成员变量
 WebServer::WebServer(int port, int threadNum)
-    : port_(port), isClose_(false)
+    : WebServer([port, threadNum]()
+                {
+                    ServerConfig config;
+                    config.port = port;
+                    config.threadNum = threadNum;
+                    return config; }())
 {
+}
+
+WebServer::WebServer(const ServerConfig &config)
+    : config_(config), port_(config.port), listenFd_(-1), isClose_(false), signalFd_(-1), upgradeFd_(-1), upgradeConn_(-1),
+      draining_(false)
+{
+    // 对端关闭后继续写会触发 SIGPIPE，默认动作是终止进程
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGTERM/SIGINT 经 signalfd 在事件循环中处理；在创建任何线程之前屏蔽，之后的线程都继承屏蔽字
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    signalFd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    // 初始化异步日志
+    if (!config_.logDir.empty())
+    {
+        Log::Instance()->Init(config_.logDir, config_.logLevel, config_.accessLog,
+                              config_.logFileBytes, config_.logFiles);
+    }
+
+    // 初始化请求追踪
+    if (!config_.traceFile.empty())
+    {
+        Tracer::Instance()->Init(config_.traceFile, config_.traceFormat, config_.traceSampleEvery,
+                                 config_.traceSlowUs);
+    }
+
     // 初始化数据库连接池
-    SqlConnPool::Instance()->Init("localhost", 3306, "root", "6", "webserver", 6);
+    if (config_.dbStub)
+    {
+        HttpRequest::UseStubDb(true);
+        LOG_INFO("using in-memory stub user table instead of MySQL");
+    }
+    else
+    {
+        SqlConnPool::Instance()->Init(config_.dbHost.c_str(), config_.dbPort, config_.dbUser.c_str(),
+                                      config_.dbPwd.c_str(), config_.dbName.c_str(), config_.sqlConnNum);
+        for (const DbReplica &replica : config_.dbReplicas)
+        {
+            SqlConnPool::Instance()->AddReplica(replica.name, replica.host.c_str(), replica.port,
+                                                config_.dbUser.c_str(), config_.dbPwd.c_str(),
+                                                config_.dbName.c_str(), config_.sqlConnNum);
+        }
+    }
+
+    if (config_.groupCommit.enabled)
+    {
+        RegisterBatcher::Flush flush = config_.dbStub ? RegisterBatcher::Flush(HttpRequest::StubRegisterBatch)
+                                                      : RegisterBatcher::Flush(RegisterBatcher::MySqlFlush);
+        registerBatcher_ = std::make_unique<RegisterBatcher>(config_.groupCommit, std::move(flush));
+        HttpRequest::SetRegisterBatcher(registerBatcher_.get());
+    }
+
+    if (config_.session.enabled)
+    {
+        sessionTokens_ = std::make_unique<SessionTokens>(config_.session);
+        HttpRequest::SetSessionTokens(sessionTokens_.get());
+    }
 
     // 初始化 epoll
     epoller_ = std::make_unique<Epoll>();
+    if (signalFd_ >= 0)
+    {
+        epoller_->AddFd(signalFd_, EPOLLIN);
+    }
 
     // 初始化线程池
-    threadpool_ = std::make_unique<ThreadPool>();
+    threadpool_ = std::make_unique<ThreadPool>(config_.threadNum,
+                                               std::max<int>(config_.threadNum, std::thread::hardware_concurrency()));
+
+    // 数据库通道：线程数与连接池大小一致，多出的线程只会阻塞在 GetConn 上
+    if (config_.dbLane)
+    {
+        // 默认每个数据库连接对应一个线程，从库的连接也算在内
+        int endpoints = config_.dbStub ? 1 : 1 + static_cast<int>(config_.dbReplicas.size());
+        int laneThreads = config_.dbLaneThreads > 0 ? config_.dbLaneThreads : config_.sqlConnNum * endpoints;
+        // 等待批量提交的注册不占用数据库连接，通道线程要足够凑满一批
+        if (config_.dbLaneThreads <= 0 && config_.groupCommit.enabled)
+            laneThreads = std::max<int>(laneThreads, config_.groupCommit.maxBatch);
+        dbLane_ = std::make_unique<ThreadPool>(laneThreads, laneThreads);
+        HttpConn::SetDbLane(true);
+    }
 
-    // 初始化监听套接字
+    // 口令哈希：固定数量的计算线程，排队有上限，按客户端轮流执行
+    PasswordHasher::SetCost(config_.kdf.cost);
+    if (config_.kdf.enabled)
+    {
+        hasher_ = std::make_unique<PasswordHasher>(config_.kdf);
+        HttpConn::SetKdfPool(true);
+    }
+
+    // 协程处理函数的阻塞调用（数据库查询）优先交给数据库通道
+    coReactor_ = std::make_unique<CoReactor>(*epoller_, dbLane_ ? *dbLane_ : *threadpool_);
+
+    admission_ = std::make_unique<AdmissionControl>(config_.admission, config_.threadNum);
+    rateLimiter_ = std::make_unique<RateLimiter>(config_.rateLimit);
+    if (config_.tls.Enabled())
+    {
+        tls_ = std::make_unique<TlsContext>(config_.tls);
+        if (!tls_->Ok())
+        {
+            exit(EXIT_FAILURE); // 配置了证书却无法加载时不退回明文
+        }
+        HttpConn::SetTls(tls_.get());
+    }
+    HttpConn::SetRateLimiter(rateLimiter_->Enabled() ? rateLimiter_.get() : nullptr);
+
+    // 注册导出时求值的指标
+    HttpConn::SetMetricsPath(config_.metricsPath);
+    HttpConn::SetSrcDir(config_.resourceDir);
+    HttpConn::InitIdleTable();
+    HttpResponse::UseEmbedded(config_.embeddedAssets);
+    if (HttpResponse::Embedded())
+    {
+        LOG_INFO("serving %zu embedded assets (%zu bytes)", AssetBundle::Count(), AssetBundle::Bytes());
+    }
+    else
+    {
+        LOG_INFO("serving static files from %s", config_.resourceDir.c_str());
+    }
+    HttpConn::SetCork(config_.sock.cork);
+    HttpConn::SetZeroCopyThreshold(config_.sock.zeroCopy);
+    Metrics::Instance()->AddGauge("webserver_active_connections", "Open client connections.",
+                                  []()
+                                  { return HttpConn::UserCount(); });
+    Metrics::Instance()->AddGauge("webserver_conn_states_in_use", "Request states held by connections with a request in progress.",
+                                  []()
+                                  { return ConnStatePool::Instance()->InUse(); });
+    Metrics::Instance()->AddGauge("webserver_conn_states_idle", "Request states cached for reuse.",
+                                  []()
+                                  { return ConnStatePool::Instance()->Idle(); });
+    Metrics::Instance()->AddGauge("webserver_connection_memory_bytes",
+                                  "Estimated user-space bytes per open connection, request states included.",
+                                  []()
+                                  {
+                                      // 连接表节点 + 正在使用与缓存的请求状态，均摊到每个连接
+                                      double conns = std::max(HttpConn::UserCount(), 1);
+                                      double states = ConnStatePool::Instance()->InUse() + ConnStatePool::Instance()->Idle();
+                                      return sizeof(HttpConn) + 2 * sizeof(void *) + states * ConnStatePool::StateBytes() / conns; });
+    Metrics::Instance()->AddGauge("webserver_threadpool_queue_depth", "Tasks waiting in the thread pool.",
+                                  [this]()
+                                  { return threadpool_->QueueSize(); });
+    Metrics::Instance()->AddGauge("webserver_threadpool_threads", "Worker threads in the thread pool.",
+                                  [this]()
+                                  { return threadpool_->ThreadCount(); });
+    if (dbLane_)
+    {
+        Metrics::Instance()->AddGauge("webserver_db_lane_queue_depth", "Requests waiting for the database lane.",
+                                      [this]()
+                                      { return dbLane_->QueueSize(); });
+    }
+    if (hasher_)
+    {
+        Metrics::Instance()->AddGauge("webserver_password_hash_queue_depth", "Password hashing jobs waiting for a compute thread.",
+                                      [this]()
+                                      { return hasher_->QueueSize(); });
+    }
+    Metrics::Instance()->AddGauge("webserver_inflight_requests", "Read tasks dispatched and not yet finished.",
+                                  [this]()
+                                  { return admission_->Inflight(); });
+    Metrics::Instance()->AddGauge("webserver_overloaded", "1 while queue delay is above target and requests are shed.",
+                                  [this]()
+                                  { return admission_->Overloaded() ? 1 : 0; });
+    Metrics::Instance()->AddGauge("webserver_rate_limit_hot_keys", "Rate limiter table slots holding an exact token bucket.",
+                                  [this]()
+                                  { return rateLimiter_->HotKeys(); });
+    Metrics::Instance()->AddGauge("webserver_log_dropped_records", "Log records dropped because a queue was full.",
+                                  []()
+                                  { return Log::Instance()->Dropped(); });
+
+    // 资源就绪之后才打开监听套接字，部署后的第一批请求不走冷路径
+    Warm_();
     InitSocket_();
 }
 
 // 析构函数：释放资源
 WebServer::~WebServer()
 {
+    Metrics::Instance()->RemoveGauge("webserver_threadpool_queue_depth");
+    Metrics::Instance()->RemoveGauge("webserver_threadpool_threads");
+    Metrics::Instance()->RemoveGauge("webserver_inflight_requests");
+    Metrics::Instance()->RemoveGauge("webserver_db_lane_queue_depth");
+    Metrics::Instance()->RemoveGauge("webserver_overloaded");
+    Metrics::Instance()->RemoveGauge("webserver_rate_limit_hot_keys");
+    HttpConn::SetRateLimiter(nullptr);
+    HttpConn::SetTls(nullptr);
     if (listenFd_ >= 0)
         close(listenFd_);
+    if (upgradeConn_ >= 0)
+        close(upgradeConn_);
+    if (upgradeFd_ >= 0)
+    {
+        close(upgradeFd_);
+        unlink(config_.upgradeSock.c_str()); // 交接之后 path 属于新进程，不会走到这里
+    }
     isClose_ = true;
-    SqlConnPool::Instance()->ClosePool();
+    // 先停掉线程池（执行完已入队的任务），之后不再有任务访问连接表、准入控制等成员；
+    // 快速通道的任务可能把请求转入数据库通道，所以它先停。挂起中的协程随调度器丢弃
+    threadpool_.reset();
+    // 登录在通道中查库后转入哈希线程池，注册在哈希线程池算完后转入通道：
+    // 先让哈希线程池做完已排队的任务并停止接收，之后通道里的任务再提交过来会直接得到 503
+    if (hasher_)
+        hasher_->Stop();
+    dbLane_.reset();
+    Metrics::Instance()->RemoveGauge("webserver_password_hash_queue_depth");
+    hasher_.reset();
+    HttpRequest::SetRegisterBatcher(nullptr);
+    registerBatcher_.reset(); // 提交完等待中的注册后才关闭连接池
+    HttpRequest::SetSessionTokens(nullptr);
+    sessionTokens_.reset();
+    coReactor_.reset();
+    users_.clear(); // 先释放各连接的 SSL 对象，再释放它们引用的 SSL_CTX
+    tls_.reset();
+    HttpResponse::SetFileCache(nullptr);
+    Metrics::Instance()->RemoveGauge("webserver_file_cache_files");
+    Metrics::Instance()->RemoveGauge("webserver_file_cache_bytes");
+    fileCache_.reset(); // 响应体可能指向缓存，连接释放之后才解除映射
+    Tracer::Instance()->Stop();
+    if (!config_.dbStub)
+    {
+        SqlConnPool::Instance()->ClosePool();
+    }
+    if (signalFd_ >= 0)
+        close(signalFd_);
+    LOG_INFO("server stopped");
+    Log::Instance()->Stop(); // 退出前把各线程队列中的日志写完
+}
+
+void WebServer::Warm_()
+{
+    if (!config_.warm.enabled)
+    {
+        return;
+    }
+    if (HttpResponse::Embedded())
+    {
+        // 资源包已带有 ETag 与 gzip 版本，只需预读只读段
+        size_t locked = AssetBundle::Prefault(config_.warm.lockBytes);
+        LOG_INFO("prefaulted %zu bytes of embedded assets (%zu locked)", AssetBundle::Bytes(), locked);
+        return;
+    }
+
+    fileCache_ = std::make_unique<FileCache>(config_.warm);
+    fileCache_->Start(config_.resourceDir);
+    HttpResponse::SetFileCache(fileCache_.get());
+    Metrics::Instance()->AddGauge("webserver_file_cache_files", "Static files served from the warm-up cache.",
+                                  [this]()
+                                  { return fileCache_->Count(); });
+    Metrics::Instance()->AddGauge("webserver_file_cache_bytes", "Bytes held by the warm-up cache, gzip variants included.",
+                                  [this]()
+                                  { return fileCache_->Bytes(); });
+    if (!fileCache_->Wait(config_.warm.deadlineMs))
+    {
+        LOG_WARN("static file warm-up not finished after %d ms, listening anyway", config_.warm.deadlineMs);
+    }
 }
 
 // 启动服务器
@@ -31,7 +284,11 @@ void WebServer::start()
 {
     while (!isClose_)
     {
-        int eventCount = epoller_->Wait(0);
+        // 阻塞等待到下一个协程定时器，工作线程投递的回调通过 eventfd 唤醒；排空期间定期检查是否结束
+        int timeoutMs = coReactor_->NextTimeoutMs();
+        if (draining_ && (timeoutMs < 0 || timeoutMs > 100))
+            timeoutMs = 100;
+        int eventCount = epoller_->Wait(timeoutMs);
         for (int i = 0; i < eventCount; ++i)
         {
             int fd = epoller_->GetEventFd(i);
@@ -41,58 +298,222 @@ void WebServer::start()
             {
                 HandleListen_(); // 处理新连接
             }
+            else if (fd == signalFd_)
+            {
+                HandleSignal_();
+            }
+            else if (fd == upgradeFd_)
+            {
+                HandleUpgrade_();
+            }
+            else if (fd == upgradeConn_)
+            {
+                HandleUpgradeAck_();
+            }
+            else if (fd == coReactor_->WakeFd())
+            {
+                continue; // 投递的回调在本轮事件之后统一执行
+            }
+            else if (coReactor_->Owns(fd))
+            {
+                coReactor_->OnEvent(fd, events); // 恢复等待该连接读写的协程
+            }
+            else if (tls_ && users_[fd].IsHandshaking())
+            {
+                HandleHandshake_(fd); // 握手在 reactor 上推进，不占用工作线程
+            }
+            else if (events & EPOLLERR)
+            {
+                // 零拷贝完成通知通过错误队列以 EPOLLERR 上报
+                threadpool_->addDetachedTask([this, fd, events]()
+                                             { HandleError_(fd, events); });
+            }
             else if (events & EPOLLIN)
             {
-                // HandleRead_(fd); // 处理读事件
-                threadpool_->addTask([this, fd]()
-                                     { HandleRead_(fd); });
+                DispatchRead_(fd); // 处理读事件
             }
             else if (events & EPOLLOUT)
             {
                 // HandleWrite_(fd); // 处理写事件
-                threadpool_->addTask([this, fd]()
-                                     { HandleWrite_(fd); });
+                threadpool_->addDetachedTask([this, fd]()
+                                             { HandleWrite_(fd); });
             }
             else
             {
                 CloseConn_(users_[fd]); // 关闭连接
             }
         }
+        coReactor_->Poll();
+
+        if (draining_)
+        {
+            int left = HttpConn::UserCount();
+            if (left == 0)
+            {
+                LOG_INFO("all connections drained");
+                isClose_ = true;
+            }
+            else if (std::chrono::steady_clock::now() >= drainDeadline_)
+            {
+                LOG_WARN("drain deadline reached, closing %d remaining connections", left);
+                isClose_ = true;
+            }
+        }
     }
 }
 
 // 初始化服务器套接字
 void WebServer::InitSocket_()
 {
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0)
+    // 热升级：已有进程在运行时接过它的监听套接字，不重新 bind，backlog 中的连接也一并接管
+    int upgradeConn = -1;
+    if (!config_.upgradeSock.empty())
     {
-        exit(EXIT_FAILURE);
+        listenFd_ = Upgrade::Receive(config_.upgradeSock, port_, &upgradeConn);
     }
 
-    // 设置端口复用
-    int optval = 1;
-    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
-
-    if (bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    if (listenFd_ >= 0)
     {
-        exit(EXIT_FAILURE);
+        config_.sock.ApplyListen(listenFd_);
+        listen(listenFd_, config_.sock.backlog); // 按本进程的配置更新队列长度
+        LOG_INFO("took over listening socket on port %d from the running process", port_);
     }
-
-    if (listen(listenFd_, 128) < 0)
+    else
     {
-        exit(EXIT_FAILURE);
+        listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0)
+        {
+            LOG_ERROR("socket() failed: %s", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        // 设置端口复用
+        int optval = 1;
+        setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+        config_.sock.ApplyListen(listenFd_);
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port_);
+
+        if (bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            LOG_ERROR("bind() port %d failed: %s", port_, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        if (listen(listenFd_, config_.sock.backlog) < 0)
+        {
+            LOG_ERROR("listen() failed: %s", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        LOG_INFO("listening on port %d", port_);
     }
 
     // 将监听套接字添加到 epoll
     epoller_->AddFd(listenFd_, EPOLLIN | EPOLLET);
     fcntl(listenFd_, F_SETFL, fcntl(listenFd_, F_GETFL) | O_NONBLOCK); // 设置非阻塞
 
+    if (upgradeConn >= 0)
+    {
+        Upgrade::Ack(upgradeConn); // 本进程已在 accept，旧进程可以停止
+    }
+    if (!config_.upgradeSock.empty())
+    {
+        upgradeFd_ = Upgrade::Listen(config_.upgradeSock);
+        if (upgradeFd_ >= 0)
+        {
+            epoller_->AddFd(upgradeFd_, EPOLLIN);
+        }
+    }
+}
+
+// 新进程连上了升级套接字：发出监听套接字，收到确认之前照常 accept
+void WebServer::HandleUpgrade_()
+{
+    if (upgradeConn_ >= 0 || draining_)
+    {
+        int conn = accept(upgradeFd_, nullptr, nullptr); // 同一时间只交接给一个进程
+        if (conn >= 0)
+            close(conn);
+        return;
+    }
+    upgradeConn_ = Upgrade::Offer(upgradeFd_, listenFd_, port_);
+    if (upgradeConn_ >= 0)
+    {
+        epoller_->AddFd(upgradeConn_, EPOLLIN);
+    }
+}
+
+void WebServer::HandleUpgradeAck_()
+{
+    int ret = Upgrade::ReadAck(upgradeConn_);
+    if (ret == 0)
+    {
+        return;
+    }
+    epoller_->DelFd(upgradeConn_);
+    close(upgradeConn_);
+    upgradeConn_ = -1;
+    if (ret < 0)
+    {
+        LOG_WARN("upgrade: new process exited before taking over, still serving");
+        return;
+    }
+
+    // 升级套接字的 path 已由新进程重新绑定，这里只关闭不删除
+    epoller_->DelFd(upgradeFd_);
+    close(upgradeFd_);
+    upgradeFd_ = -1;
+    BeginDrain_("handed over to the new process");
+}
+
+void WebServer::HandleSignal_()
+{
+    signalfd_siginfo info;
+    while (read(signalFd_, &info, sizeof(info)) == sizeof(info))
+    {
+        const char *name = info.ssi_signo == SIGTERM ? "SIGTERM" : "SIGINT";
+        if (!draining_)
+        {
+            BeginDrain_(name);
+        }
+        else
+        {
+            LOG_WARN("%s received again while draining, exiting now", name);
+            isClose_ = true;
+        }
+    }
+}
+
+// 停止 accept；之后的响应都带 Connection: close，HTTP/2 连接发送 GOAWAY，
+// 空闲的长连接关闭读方向，由正常的读路径读到 EOF 后关闭
+void WebServer::BeginDrain_(const char *reason)
+{
+    if (draining_)
+    {
+        return;
+    }
+    draining_ = true;
+    drainDeadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.drainTimeoutMs);
+    HttpRequest::SetDraining(true);
+    if (listenFd_ >= 0)
+    {
+        epoller_->DelFd(listenFd_);
+        close(listenFd_);
+        listenFd_ = -1;
+    }
+
+    std::vector<int> idle;
+    HttpConn::CollectIdle(idle);
+    for (int fd : idle)
+    {
+        shutdown(fd, SHUT_RD);
+    }
+    LOG_INFO("draining %d connections (%s), %zu idle, deadline %d ms", HttpConn::UserCount(), reason, idle.size(),
+             config_.drainTimeoutMs);
 }
 
 // 处理新连接
@@ -115,40 +536,162 @@ void WebServer::HandleListen_()
             return;
         }
 
-        if (users_.size() >= 20000)
-        { // 最大连接数
+        if (static_cast<int>(users_.size()) >= config_.admission.maxConnections)
+        { // 最大连接数：告知客户端稍后重试，而不是无声地断开（TLS 握手前无法回响应，只能断开）
+            const std::string &resp = admission_->Response503();
+            if (!tls_)
+                send(clientFd, resp.data(), resp.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
             close(clientFd);
-            return;
+            CounterAdd(Metrics::Local().shed);
+            continue;
+        }
+
+        if (!rateLimiter_->Allow(clientAddr.sin_addr.s_addr, RateLimiter::CONNECT))
+        { // 单个客户端（或网段）建立连接过快
+            const std::string &resp = rateLimiter_->Response429();
+            if (!tls_)
+                send(clientFd, resp.data(), resp.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(clientFd);
+            CounterAdd(Metrics::Local().rateLimited);
+            continue;
         }
 
         // 添加新连接
+        CounterAdd(Metrics::Local().connections);
+        config_.sock.ApplyConn(clientFd);
         users_[clientFd].init(clientFd, clientAddr);
         epoller_->AddFd(clientFd, EPOLLIN | EPOLLET | EPOLLONESHOT);
         fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
     }
 }
 
+// 推进 TLS 握手：按 OpenSSL 需要的方向重新注册事件，完成后按普通读事件处理
+void WebServer::HandleHandshake_(int fd)
+{
+    HttpConn &client = users_[fd];
+    switch (client.Handshake())
+    {
+    case HttpConn::HANDSHAKE_READ:
+        epoller_->ModFd(fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
+        break;
+    case HttpConn::HANDSHAKE_WRITE:
+        epoller_->ModFd(fd, EPOLLOUT | EPOLLET | EPOLLONESHOT);
+        break;
+    case HttpConn::HANDSHAKE_DONE:
+        // 客户端的第一个请求可能与 Finished 一起到达，已被 OpenSSL 读入缓冲，不会再触发边沿事件
+        DispatchRead_(fd);
+        break;
+    default:
+        CloseConn_(client);
+        break;
+    }
+}
+
+// 读事件经准入控制后交给线程池；过载时直接拒绝
+void WebServer::DispatchRead_(int fd)
+{
+    if (!admission_->Admit())
+    {
+        Shed_(fd);
+        return;
+    }
+    uint64_t enqueueTsc = ReadTsc();
+    admission_->OnEnqueue();
+    threadpool_->addDetachedTask([this, fd, enqueueTsc]()
+                                 {
+                                     admission_->OnDequeue(enqueueTsc);
+                                     HandleRead_(fd, enqueueTsc);
+                                     admission_->OnDone(); });
+}
+
 // 处理读事件
-void WebServer::HandleRead_(int fd)
+void WebServer::HandleRead_(int fd, uint64_t enqueueTsc)
 {
     int ret = -1;
     int err = 0;
+    users_[fd].MarkQueued(enqueueTsc);
     ret = users_[fd].read(&err);
-    if (ret <= 0 && err != EAGAIN)
+    if (ret <= 0 && err != EAGAIN && !users_[fd].HasInput())
     {
         CloseConn_(users_[fd]);
         return;
     }
-    if (users_[fd].process())
+    // 读到 EOF 之前已收到的请求照常处理（客户端半关闭、排空时关闭了读方向），下一次读事件再关闭
+    Process_(fd);
+}
+
+// 处理已读入的请求并按结果重新注册事件；需要访问数据库或计算口令哈希的请求转交对应的线程池
+void WebServer::Process_(int fd)
+{
+    Continue_(fd, users_[fd].process());
+}
+
+// 按 process()（或推迟步骤的 processDb/processKdf）的结果重新注册事件或转交下一步
+void WebServer::Continue_(int fd, bool ready)
+{
+    HttpConn &client = users_[fd];
+    if (ready)
     {
         epoller_->ModFd(fd, EPOLLOUT | EPOLLET | EPOLLONESHOT);
     }
+    else if (client.PendingAsync())
+    {
+        // 协程只在 reactor 线程上运行；EPOLLONESHOT 保证此时没有其他线程处理该连接
+        coReactor_->Post([this, fd]()
+                         { Spawn(RunAsync_(fd)); });
+    }
+    else if (client.PendingDb() || client.PendingKdf())
+    {
+        Defer_(fd);
+    }
     else
     {
         epoller_->ModFd(fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
     }
 }
 
+// 把请求推迟的下一步交给对应的线程池，完成后再决定是写响应还是进入下一步（登录：查库后校验口令；
+// 注册：计算哈希后写库）。EPOLLONESHOT 保证各步骤完成并重新注册之前没有其他线程处理该连接
+void WebServer::Defer_(int fd)
+{
+    HttpConn &client = users_[fd];
+    if (client.PendingKdf())
+    {
+        bool queued = hasher_->TrySubmit(client.GetAddr().sin_addr.s_addr, [this, fd]()
+                                         { Continue_(fd, users_[fd].processKdf(true)); });
+        if (!queued)
+        {
+            // 口令哈希排队已满（或该 IP 排队过多）：立即回 503
+            Continue_(fd, client.processKdf(false));
+        }
+    }
+    else
+    {
+        bool queued = dbLane_->tryAddDetachedTask([this, fd]()
+                                                  { Continue_(fd, users_[fd].processDb(true)); },
+                                                  config_.dbLaneQueue);
+        if (!queued)
+        {
+            // 数据库通道已满：立即回 503，不让慢查询拖住静态请求的工作线程
+            Continue_(fd, client.processDb(false));
+        }
+    }
+}
+
+// 运行协程处理函数；响应写完后交回写事件处理，由 HandleWrite_ 决定保持还是关闭连接
+Task<void> WebServer::RunAsync_(int fd)
+{
+    HttpConn &client = users_[fd];
+    if (co_await client.RunAsync(*coReactor_))
+    {
+        epoller_->ModFd(fd, EPOLLOUT | EPOLLET | EPOLLONESHOT);
+    }
+    else
+    {
+        CloseConn_(client);
+    }
+}
+
 // 处理写事件
 void WebServer::HandleWrite_(int fd)
 {
@@ -163,11 +706,9 @@ void WebServer::HandleWrite_(int fd)
     {
         if (users_[fd].IsKeepAlive())
         {
-            if (users_[fd].process())
-            {
-                users_[fd].SetWriting(false);
-                epoller_->ModFd(fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
-            }
+            // 响应已写完：重置请求状态，缓冲区里已有下一个请求就继续处理，否则等待新数据
+            users_[fd].SetWriting(false);
+            Process_(fd);
             return;
         }
         else
@@ -193,9 +734,67 @@ void WebServer::HandleWrite_(int fd)
     CloseConn_(users_[fd]);
 }
 
+// 过载时在 reactor 中直接拒绝：丢弃已到达的请求数据，写出预先生成的 503 后关闭
+void WebServer::Shed_(int fd)
+{
+    // 接收缓冲区里留有未读数据时 close 会发 RST，客户端可能因此读不到 503
+    char scratch[4096];
+    for (int i = 0; i < 16 && recv(fd, scratch, sizeof(scratch), MSG_DONTWAIT) > 0; ++i)
+    {
+    }
+    // TLS 连接上丢弃的是密文，503 仍经由 SSL 加密写出
+    users_[fd].SendNow(admission_->Response503());
+    CounterAdd(Metrics::Local().shed);
+    CloseConn_(users_[fd]);
+}
+
+// 处理错误事件：先取走零拷贝完成通知，再按原有事件继续处理
+void WebServer::HandleError_(int fd, uint32_t events)
+{
+    HttpConn &client = users_[fd];
+    client.DrainZeroCopy();
+
+    int soError = 0;
+    socklen_t len = sizeof(soError);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &len);
+    if (soError != 0 || (client.IsLingering() && !client.ZeroCopyPending()))
+    {
+        client.SetLingering();
+        CloseConn_(client);
+        return;
+    }
+
+    if (client.IsLingering())
+    {
+        epoller_->ModFd(fd, EPOLLET | EPOLLONESHOT); // 只等待错误队列与挂断
+    }
+    else if (events & EPOLLIN)
+    {
+        // 重新注册后由 reactor 按普通读事件经 DispatchRead_ 投递，同样经过准入控制和限流
+        epoller_->ModFd(fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
+    }
+    else if (events & EPOLLOUT)
+    {
+        HandleWrite_(fd);
+    }
+    else
+    {
+        epoller_->ModFd(fd, (client.ToWriteBytes() > 0 ? EPOLLOUT : EPOLLIN) | EPOLLET | EPOLLONESHOT);
+    }
+}
+
 // 关闭连接
 void WebServer::CloseConn_(HttpConn &client)
 {
+    // 还有零拷贝发送未被确认时先只关闭写端，等内核用完响应体再真正关闭
+    if (client.ZeroCopyPending() && !client.IsLingering())
+    {
+        client.SetLingering();
+        shutdown(client.GetFd(), SHUT_WR);
+        epoller_->ModFd(client.GetFd(), EPOLLET | EPOLLONESHOT);
+        return;
+    }
+
     epoller_->DelFd(client.GetFd());
     client.Close();
     users_.erase(client.GetFd());
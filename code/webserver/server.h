@@ -9,36 +9,80 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <iostream>
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+#include <chrono>
 
 #include "Epoll.h"
+#include "Config.h"
 #include "../pool/SqlConnRAII.h"
 #include "../pool/SqlConnPool.h"
 #include "../buffer/Buffer.h"
 #include "../http/HttpConn.h"
 #include "../pool/ThreadPool.h"
+#include "../coro/CoReactor.h"
+
+// 只以指针持有的模块在 server.cpp 中包含，修改它们的头文件不必重新编译 main.cpp
+class AdmissionControl;
+class RateLimiter;
+class TlsContext;
+class FileCache;
+class RegisterBatcher;
+class PasswordHasher;
+class SessionTokens;
 
 class WebServer
 {
 public:
     WebServer(int port = 8080, int threadNum = 8);
+    explicit WebServer(const ServerConfig &config);
     ~WebServer();
 
     void start();
 
 private:
+    void Warm_();                      // 启动预热，完成或超过期限后才开始监听
     void InitSocket_();                // 初始化服务器套接字
     void HandleListen_();              // 处理监听事件
-    void HandleRead_(int fd);          // 处理读事件
+    void HandleUpgrade_();             // 把监听套接字交给新进程
+    void HandleUpgradeAck_();          // 新进程确认接管后开始排空
+    void BeginDrain_(const char *reason); // 停止接受新连接，等待现有连接结束
+    void HandleSignal_();              // SIGTERM/SIGINT：第一次排空后退出，第二次立即退出
+    void HandleHandshake_(int fd);     // 在 reactor 中推进 TLS 握手
+    void DispatchRead_(int fd);        // 经准入控制把读事件投递到线程池
+    void HandleRead_(int fd, uint64_t enqueueTsc); // 处理读事件
     void HandleWrite_(int fd);         // 处理写事件
+    void HandleError_(int fd, uint32_t events); // 处理错误队列（零拷贝完成通知）
+    void Shed_(int fd);                         // 在 reactor 中直接回 503 并关闭连接
+    void Process_(int fd);                      // 处理请求并重新注册事件
+    void Continue_(int fd, bool ready);         // 按处理结果重新注册事件或转交下一步
+    void Defer_(int fd);                        // 把请求的数据库或口令哈希步骤交给对应的线程池
+    Task<void> RunAsync_(int fd);               // 在 reactor 上运行协程处理函数
     void CloseConn_(HttpConn &client); // 关闭连接
 
-    int port_;     // 监听端口
-    int listenFd_; // 监听文件描述符
-    bool isClose_; // 是否关闭服务器
+    ServerConfig config_; // 运行参数
+    int port_;            // 监听端口
+    int listenFd_;        // 监听文件描述符
+    bool isClose_;        // 是否关闭服务器
+    int signalFd_;        // 接收 SIGTERM/SIGINT 的 signalfd
+    int upgradeFd_;       // 等待热升级的 Unix 套接字
+    int upgradeConn_;     // 已发出监听套接字、等待确认的新进程连接
+    bool draining_;       // 正在排空连接
+    std::chrono::steady_clock::time_point drainDeadline_;
 
     std::unique_ptr<Epoll> epoller_;          // epoll 管理器
     std::unordered_map<int, HttpConn> users_; // 客户端连接管理
-    std::unique_ptr<ThreadPool> threadpool_;
+    std::unique_ptr<ThreadPool> threadpool_;      // 快速通道：读、解析、静态文件
+    std::unique_ptr<ThreadPool> dbLane_;          // 数据库通道：登录/注册
+    std::unique_ptr<RegisterBatcher> registerBatcher_; // 注册的批量提交，关闭时为空
+    std::unique_ptr<PasswordHasher> hasher_;           // 口令哈希线程池，关闭时为空
+    std::unique_ptr<SessionTokens> sessionTokens_;     // 会话令牌，关闭时为空
+    std::unique_ptr<AdmissionControl> admission_; // 准入控制
+    std::unique_ptr<RateLimiter> rateLimiter_;    // 按 IP 限流
+    std::unique_ptr<CoReactor> coReactor_;        // 协程处理函数的调度器
+    std::unique_ptr<TlsContext> tls_;             // TLS 终结，明文监听时为空
+    std::unique_ptr<FileCache> fileCache_;        // 磁盘静态文件的预热缓存，使用资源包时为空
 };
 
 #endif // WEBSERVER_H